@@ -14,7 +14,7 @@ BuildRoot:	%{_tmppath}/%{name}-%{version}-%{release}-root-%(%{__id_u} -n)
 
 BuildRequires: boost-devel, boost-iostreams, boost-thread, boost-system
 BuildRequires: libmhash-devel, libtool-ltdl-devel, libuuid-devel, libcgroup-devel
-BuildRequires: msgpack-devel, libarchive-devel, binutils-devel
+BuildRequires: msgpack-devel, libarchive-devel, binutils-devel, zlib-devel
 
 %if %{defined rhel} && 0%{?rhel} < 7
 BuildRequires: cmake28
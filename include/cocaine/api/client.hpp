@@ -0,0 +1,563 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_CLIENT_API_HPP
+#define COCAINE_CLIENT_API_HPP
+
+#include "cocaine/common.hpp"
+#include "cocaine/locked_ptr.hpp"
+
+#include "cocaine/rpc/dispatch.hpp"
+#include "cocaine/rpc/session.hpp"
+#include "cocaine/rpc/upstream.hpp"
+
+#include <atomic>
+
+#include <asio/deadline_timer.hpp>
+#include <asio/ip/tcp.hpp>
+
+namespace cocaine { namespace api {
+
+// Connections to services, shared by all the clients. Services are resolved via the Locator, and
+// resolved endpoints are cached for a while. There's at most one session per remote endpoint, which
+// pipelines all the invocations sent to it.
+
+class connector_t:
+    public std::enable_shared_from_this<connector_t>
+{
+    COCAINE_DECLARE_NONCOPYABLE(connector_t)
+
+    // Resolved services are cached for this many seconds.
+    static const unsigned int kCacheTimeout = 60;
+
+    struct service_t {
+        std::vector<asio::ip::tcp::endpoint> endpoints;
+        unsigned int version;
+
+        // When to resolve the service again.
+        boost::posix_time::ptime expiration;
+    };
+
+    struct uplink_t {
+        std::shared_ptr<session_t> session;
+
+        // Handlers waiting for the connection to be established.
+        std::vector<std::function<void(const std::error_code&, const std::shared_ptr<session_t>&)>> pending;
+    };
+
+    class uplink_sink_t;
+
+    context_t& m_context;
+    asio::io_service& m_asio;
+
+    const std::unique_ptr<logging::log_t> m_log;
+
+    synchronized<std::map<std::string, service_t>> m_services;
+    synchronized<std::map<asio::ip::tcp::endpoint, uplink_t>> m_uplinks;
+
+public:
+    typedef std::function<void(const std::error_code&, const std::shared_ptr<session_t>&)> handler_type;
+
+    // Connections and deadline timers are handled by the given reactor.
+    connector_t(context_t& context, asio::io_service& asio);
+   ~connector_t();
+
+    auto
+    asio() -> asio::io_service&;
+
+    // Resolves the service and connects to it, unless there's already a session to one of its
+    // endpoints. The handler is called with the session or with an error.
+    void
+    connect(const std::string& name, int version, handler_type handle);
+
+    // Binds the name to the given endpoints, bypassing the Locator. Pinned services never expire,
+    // which is useful to reach a specific node rather than any instance of the service.
+    void
+    pin(const std::string& name, int version, const std::vector<asio::ip::tcp::endpoint>& endpoints);
+
+    // Removes the session from the pool, e.g. after it has been disconnected. The next connect()
+    // establishes a new session.
+    void
+    drop(const std::shared_ptr<session_t>& session);
+
+private:
+    void
+    link(const std::string& name, const std::vector<asio::ip::tcp::endpoint>& endpoints,
+         handler_type handle);
+};
+
+namespace aux {
+
+// Completion guard shared by the reply dispatch and the deadline timer, so that the invocation
+// handler is called exactly once, whichever comes first.
+
+class reply_guard_t {
+    std::atomic<bool> m_completed;
+
+    struct channel_t {
+        io::upstream_ptr_t upstream;
+        bool revoked;
+    };
+
+    // Channel of the invocation, once it has been sent.
+    synchronized<channel_t> m_channel;
+
+public:
+    reply_guard_t():
+        m_completed(false)
+    { }
+
+    // Optional deadline timer, cancelled on completion.
+    std::shared_ptr<asio::deadline_timer> timer;
+
+    bool
+    complete() {
+        if(m_completed.exchange(true)) {
+            return false;
+        }
+
+        if(const auto ptr = timer) {
+            // NOTE: Timers are not thread-safe, so the timer is cancelled in its own reactor thread.
+            ptr->get_io_service().post([ptr] { ptr->cancel(); });
+        }
+
+        return true;
+    }
+
+    bool
+    completed() const {
+        return m_completed;
+    }
+
+    // Binds the channel of the invocation. Returns false if the channel has been revoked already, in
+    // which case the new one is revoked right away and there's no point in sending the invocation.
+    bool
+    bind(const io::upstream_ptr_t& upstream) {
+        {
+            auto channel = m_channel.synchronize();
+
+            if(!channel->revoked) {
+                channel->upstream = upstream;
+                return true;
+            }
+        }
+
+        upstream->revoke();
+
+        return false;
+    }
+
+    // Revokes the channel of the invocation, so that the reply dispatch doesn't stay in the session's
+    // channel table until the remote peer replies, if ever.
+    void
+    revoke() {
+        io::upstream_ptr_t upstream;
+
+        {
+            auto channel = m_channel.synchronize();
+
+            channel->revoked = true;
+            upstream = std::move(channel->upstream);
+        }
+
+        if(upstream) {
+            upstream->revoke();
+        }
+    }
+};
+
+// Value delivery. Single values are passed as is, multiple values are passed as a tuple.
+
+template<class T>
+struct value_of {
+    typedef std::function<void(const std::error_code&, const T&)> handler_type;
+
+    template<class... Args>
+    static
+    void
+    deliver(const handler_type& handle, Args&&... args) {
+        handle(std::error_code(), T(std::forward<Args>(args)...));
+    }
+
+    static
+    void
+    abort(const handler_type& handle, const std::error_code& ec) {
+        handle(ec, T());
+    }
+};
+
+template<>
+struct value_of<void> {
+    typedef std::function<void(const std::error_code&)> handler_type;
+
+    static
+    void
+    deliver(const handler_type& handle) {
+        handle(std::error_code());
+    }
+
+    static
+    void
+    abort(const handler_type& handle, const std::error_code& ec) {
+        handle(ec);
+    }
+};
+
+template<class T>
+struct chunk_of {
+    typedef std::function<void(const T&)> handler_type;
+
+    template<class... Args>
+    static
+    void
+    deliver(const handler_type& handle, Args&&... args) {
+        handle(T(std::forward<Args>(args)...));
+    }
+};
+
+template<>
+struct chunk_of<void> {
+    typedef std::function<void()> handler_type;
+
+    static
+    void
+    deliver(const handler_type& handle) {
+        handle();
+    }
+};
+
+template<class Tag>
+class reply;
+
+// Replies for option_of<T...> upstreams. The handler gets either the value or the error code. On
+// errors, the value is default-constructed.
+
+template<class T>
+class reply<io::primitive_tag<T>>:
+    public dispatch<io::primitive_tag<T>>
+{
+    typedef io::primitive<T> protocol;
+    typedef value_of<typename io::aux::result_of_impl<io::primitive_tag<T>>::type> value_type;
+
+public:
+    typedef typename value_type::handler_type handler_type;
+
+private:
+    struct on_value {
+        reply *const parent;
+
+        template<class... Args>
+        void
+        operator()(Args&&... args) const {
+            if(parent->guard->complete()) {
+                value_type::deliver(parent->handle, std::forward<Args>(args)...);
+            }
+        }
+    };
+
+    struct on_error {
+        reply *const parent;
+
+        template<class... Args>
+        void
+        operator()(const std::error_code& ec, Args&&...) const {
+            parent->abort(ec);
+        }
+    };
+
+    const handler_type handle;
+
+public:
+    const std::shared_ptr<reply_guard_t> guard;
+
+    reply(const std::string& name, handler_type handle_):
+        dispatch<io::primitive_tag<T>>(name),
+        handle(std::move(handle_)),
+        guard(std::make_shared<reply_guard_t>())
+    {
+        this->template on<typename protocol::value>(
+            std::make_shared<io::blocking_slot<typename protocol::value, io::mute_slot_tag>>(on_value{this}));
+        this->template on<typename protocol::error>(
+            std::make_shared<io::blocking_slot<typename protocol::error, io::mute_slot_tag>>(on_error{this}));
+    }
+
+    void
+    abort(const std::error_code& ec) const {
+        if(guard->complete()) {
+            value_type::abort(handle, ec);
+        }
+    }
+
+    virtual
+    void
+    discard(const std::error_code& ec) const {
+        abort(ec ? ec : error::revoked_channel);
+    }
+};
+
+// Replies for stream_of<T...> upstreams. The chunk handler is called for every chunk, and then the
+// close handler is called once, with an error code if the stream has failed.
+
+template<class T>
+class reply<io::streaming_tag<T>>:
+    public dispatch<io::streaming_tag<T>>
+{
+    typedef io::streaming<T> protocol;
+    typedef chunk_of<typename io::aux::result_of_impl<io::streaming_tag<T>>::type> chunk_type;
+
+public:
+    struct handler_type {
+        typename chunk_type::handler_type chunk;
+        std::function<void(const std::error_code&)> close;
+    };
+
+private:
+    struct on_chunk {
+        reply *const parent;
+
+        template<class... Args>
+        void
+        operator()(Args&&... args) const {
+            if(!parent->guard->completed()) {
+                chunk_type::deliver(parent->handle.chunk, std::forward<Args>(args)...);
+            }
+        }
+    };
+
+    struct on_error {
+        reply *const parent;
+
+        template<class... Args>
+        void
+        operator()(const std::error_code& ec, Args&&...) const {
+            parent->abort(ec);
+        }
+    };
+
+    struct on_choke {
+        reply *const parent;
+
+        void
+        operator()() const {
+            parent->abort(std::error_code());
+        }
+    };
+
+    const handler_type handle;
+
+public:
+    const std::shared_ptr<reply_guard_t> guard;
+
+    reply(const std::string& name, handler_type handle_):
+        dispatch<io::streaming_tag<T>>(name),
+        handle(std::move(handle_)),
+        guard(std::make_shared<reply_guard_t>())
+    {
+        this->template on<typename protocol::chunk>(
+            std::make_shared<io::blocking_slot<typename protocol::chunk, io::mute_slot_tag>>(on_chunk{this}));
+        this->template on<typename protocol::error>(
+            std::make_shared<io::blocking_slot<typename protocol::error, io::mute_slot_tag>>(on_error{this}));
+        this->template on<typename protocol::choke>(
+            std::make_shared<io::blocking_slot<typename protocol::choke, io::mute_slot_tag>>(on_choke{this}));
+    }
+
+    void
+    abort(const std::error_code& ec) const {
+        if(guard->complete()) {
+            handle.close(ec);
+        }
+    }
+
+    virtual
+    void
+    discard(const std::error_code& ec) const {
+        abort(ec ? ec : error::revoked_channel);
+    }
+};
+
+template<class Event>
+struct reply_of {
+    typedef reply<typename io::event_traits<Event>::upstream_type> type;
+};
+
+// Sends the invocation once connected. Retries once with a new session, if the pooled one has been
+// disconnected in the meantime.
+
+template<class Event, class Payload>
+class invocation_t:
+    public std::enable_shared_from_this<invocation_t<Event, Payload>>
+{
+    typedef typename reply_of<Event>::type reply_type;
+
+    struct send_action_t {
+        const io::upstream_ptr_t& upstream;
+
+        template<class... Args>
+        void
+        operator()(Args&&... args) const {
+            upstream->send<Event>(std::forward<Args>(args)...);
+        }
+    };
+
+    const std::shared_ptr<connector_t> connector;
+    const std::string name;
+
+    const std::shared_ptr<const reply_type> reply;
+    const Payload payload;
+
+    bool retried;
+
+public:
+    invocation_t(const std::shared_ptr<connector_t>& connector_, const std::string& name_,
+                 const std::shared_ptr<const reply_type>& reply_, Payload&& payload_):
+        connector(connector_),
+        name(name_),
+        reply(reply_),
+        payload(std::move(payload_)),
+        retried(false)
+    { }
+
+    void
+    operator()() {
+        connector->connect(name, io::protocol<typename Event::tag>::version::value, std::bind(
+            &invocation_t::finalize,
+            this->shared_from_this(),
+            std::placeholders::_1,
+            std::placeholders::_2
+        ));
+    }
+
+private:
+    void
+    finalize(const std::error_code& ec, const std::shared_ptr<session_t>& session) {
+        if(ec) {
+            return reply->abort(ec);
+        }
+
+        if(reply->guard->completed()) {
+            // Deadline has expired while connecting.
+            return;
+        }
+
+        try {
+            const auto upstream = session->fork(reply);
+
+            if(!reply->guard->bind(upstream)) {
+                return;
+            }
+
+            tuple::invoke(payload, send_action_t{upstream});
+        } catch(const std::system_error& e) {
+            if(e.code() == error::not_connected && !retried) {
+                retried = true;
+                connector->drop(session);
+                return operator()();
+            }
+
+            reply->abort(e.code());
+        }
+    }
+};
+
+} // namespace aux
+
+// Typed service client. All the clients sharing a connector pipeline their invocations over the same
+// sessions. Invocations are asynchronous, and replies are delivered to the handlers in the threads
+// handling the sessions.
+
+template<class Tag>
+class client {
+    const std::shared_ptr<connector_t> m_connector;
+    const std::string m_name;
+
+public:
+    template<class Event>
+    struct handler {
+        typedef typename aux::reply_of<Event>::type::handler_type type;
+    };
+
+    client(const std::shared_ptr<connector_t>& connector, const std::string& name):
+        m_connector(connector),
+        m_name(name)
+    { }
+
+    template<class Event, class... Args>
+    void
+    invoke(typename handler<Event>::type handle, Args&&... args) {
+        invoke_impl<Event>(make_reply<Event>(std::move(handle)), std::forward<Args>(args)...);
+    }
+
+    // Same as above, but fails the invocation with error::deadline_expired if it's not completed
+    // within the specified timeout, including the time spent on resolving and connecting.
+    template<class Event, class... Args>
+    void
+    invoke_for(const boost::posix_time::time_duration& timeout, typename handler<Event>::type handle,
+               Args&&... args)
+    {
+        typedef typename aux::reply_of<Event>::type reply_type;
+
+        const auto reply = make_reply<Event>(std::move(handle));
+        const auto timer = std::make_shared<asio::deadline_timer>(m_connector->asio(), timeout);
+
+        reply->guard->timer = timer;
+
+        timer->async_wait([reply](const std::error_code& ec) {
+            if(ec == asio::error::operation_aborted) {
+                return;
+            }
+
+            reply->abort(error::deadline_expired);
+            reply->guard->revoke();
+        });
+
+        invoke_impl<Event>(std::shared_ptr<const reply_type>(reply), std::forward<Args>(args)...);
+    }
+
+private:
+    template<class Event>
+    auto
+    make_reply(typename handler<Event>::type&& handle) const
+        -> std::shared_ptr<typename aux::reply_of<Event>::type>
+    {
+        static_assert(
+            std::is_same<typename Event::tag, Tag>::value,
+            "message protocol is not compatible with this client"
+        );
+
+        return std::make_shared<typename aux::reply_of<Event>::type>(m_name + ":client", std::move(handle));
+    }
+
+    template<class Event, class... Args>
+    void
+    invoke_impl(const std::shared_ptr<const typename aux::reply_of<Event>::type>& reply, Args&&... args) {
+        typedef std::tuple<typename std::decay<Args>::type...> payload_type;
+
+        std::make_shared<aux::invocation_t<Event, payload_type>>(
+            m_connector,
+            m_name,
+            reply,
+            payload_type(std::forward<Args>(args)...)
+        )->operator()();
+    }
+};
+
+}} // namespace cocaine::api
+
+#endif
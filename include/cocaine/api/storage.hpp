@@ -58,6 +58,14 @@ struct storage_t {
     std::vector<std::string>
     find(const std::string& collection, const std::vector<std::string>& tags) = 0;
 
+    // Lists up to the limit of keys starting with the prefix, which follow the given key in the
+    // lexicographical order. Zero limit means no limit. Backends which can't list keys in order
+    // don't have to support it.
+    virtual
+    std::vector<std::string>
+    list(const std::string& collection, const std::string& prefix, const std::string& start_after,
+         size_t limit);
+
     // Helper methods
 
     template<class T>
@@ -75,6 +83,13 @@ protected:
     }
 };
 
+inline
+std::vector<std::string>
+storage_t::list(const std::string&, const std::string&, const std::string&, size_t) {
+    throw std::system_error(std::make_error_code(std::errc::operation_not_supported),
+        "key listing is not supported by the storage");
+}
+
 template<class T>
 T
 storage_t::get(const std::string& collection, const std::string& key) {
@@ -41,12 +41,14 @@ namespace cocaine {
 // Context
 
 class actor_t;
+class balancer_t;
 class execution_unit_t;
 
 class context_t {
     COCAINE_DECLARE_NONCOPYABLE(context_t)
 
     typedef std::deque<std::pair<std::string, std::unique_ptr<actor_t>>> service_list_t;
+    typedef std::pair<std::shared_ptr<asio::io_service>, std::unique_ptr<io::chamber_t>> executor_t;
 
     // TODO: There was an idea to use the Repository to enable pluggable sinks and whatever else for
     // for the Blackhole, when all the common stuff is extracted to a separate library.
@@ -59,6 +61,16 @@ class context_t {
     // A pool of execution units - threads responsible for doing all the service invocations.
     std::vector<std::unique_ptr<execution_unit_t>> m_pool;
 
+    // Dedicated pools for the services which shouldn't share execution units with the others.
+    std::map<std::string, std::vector<std::unique_ptr<execution_unit_t>>> m_pools;
+
+    // Moves busy sessions between the execution units. Only started if enabled in the config.
+    std::unique_ptr<balancer_t> m_balancer;
+
+    // Reactors shared by the services started at bootstrap, if enabled in the config. Each of them
+    // is run by a single thread, so handlers of every service running on it are still serialized.
+    std::vector<executor_t> m_executors;
+
     // Services are stored as a vector of pairs to preserve the initialization order. Synchronized,
     // because services are allowed to start and stop other services during their lifetime.
     synchronized<service_list_t> m_services;
@@ -88,12 +100,19 @@ public:
     void
     insert(const std::string& name, std::unique_ptr<actor_t> service);
 
+    // NOTE: Services running on the shared executors can't be removed, because other services keep
+    // running there, so there's no point at which their handlers are guaranteed to be done.
     auto
     remove(const std::string& name) -> std::unique_ptr<actor_t>;
 
     auto
     locate(const std::string& name) const -> boost::optional<const actor_t&>;
 
+    // Allocator statistics for every execution unit and service thread, keyed by the thread's name.
+    // Empty, unless built with jemalloc.
+    auto
+    memory_usage() const -> std::map<std::string, std::map<std::string, uint64_t>>;
+
     // Signals API
 
     void
@@ -103,15 +122,30 @@ public:
 
     // Network I/O
 
+    // Whether the reactor is one of the shared service executors, which are run by the context and
+    // therefore must not be stopped by the services running on them.
+    bool
+    is_shared(const asio::io_service& asio) const;
+
     auto
     engine() -> execution_unit_t&;
 
+    // Least loaded execution unit of the pool assigned to the service, or of the shared pool if the
+    // service doesn't have a dedicated one.
+    auto
+    engine(const std::string& service) -> execution_unit_t&;
+
 private:
     void
     bootstrap();
 
     void
     terminate();
+
+    // Stops and removes the service. Services running on the shared executors are only removed if
+    // forced to, i.e. during termination, where the service objects outlive the executors.
+    auto
+    withdraw(const std::string& name, bool force) -> std::unique_ptr<actor_t>;
 };
 
 template<class Category, class... Args>
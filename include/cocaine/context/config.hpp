@@ -57,6 +57,10 @@ public:
         // I/O thread pool size.
         size_t pool;
 
+        // Number of threads shared by the services for their own reactors. Zero means that every
+        // service runs its reactor in a dedicated thread.
+        size_t executors;
+
         struct {
             // Pinned ports for static service port allocation.
             std::map<std::string, port_t> pinned;
@@ -64,6 +68,67 @@ public:
             // Port range to populate the dynamic port pool for service port allocation.
             std::tuple<port_t, port_t> shared;
         } ports;
+
+        struct {
+            // Services which compress their connections, if the remote peer supports it. Cluster
+            // links are compressed when the locator service is listed here.
+            std::set<std::string> services;
+
+            // Messages smaller than this are never compressed.
+            size_t threshold;
+        } compression;
+
+        struct {
+            // Capacity of the remote peers' HPACK dynamic tables for the headers sent by this node,
+            // in bytes. Smaller tables save memory on both sides, but make repeated headers larger.
+            size_t capacity;
+        } headers;
+
+        struct {
+            // Maximum size of incoming compressed and version 2 frames in bytes, compressed frames are
+            // also limited by the size of the messages they inflate to. These frames tell their size
+            // upfront, so the limit keeps remote peers from making sessions allocate arbitrary amounts
+            // of memory. Sessions sending larger frames are detached. Plain version 1 frames aren't
+            // limited, so large storage writes and app payloads work as before.
+            size_t limit;
+
+            // Frame format version used by outgoing connections, e.g. cluster links. Version 2 must
+            // be supported by the remote nodes. Incoming connections follow their remote peers.
+            size_t version;
+        } frames;
+
+        struct {
+            // Sessions of the same execution unit take turns by deficit round-robin. Every turn, the
+            // session is granted the given number of bytes on top of what's left from its previous
+            // turns, and handles messages while they fit, but no more than the given number of them.
+            // So a session sending large messages waits as many turns as its messages need, instead
+            // of getting the same share of the execution unit as one sending small messages. Larger
+            // message quanta save reactor round trips at the cost of interleaving.
+            size_t messages;
+            size_t bytes;
+        } quantum;
+
+        struct {
+            // Interval between rebalancing rounds in seconds, during which the busiest session of the
+            // most loaded execution unit is moved to the least loaded one. Zero disables rebalancing.
+            size_t interval;
+
+            // Minimum utilization difference between the execution units to trigger a migration.
+            double threshold;
+        } rebalance;
+
+        struct {
+            // Sessions which haven't sent or received any messages for this many seconds are detached.
+            // Zero disables idle timeouts. Outgoing sessions never time out.
+            size_t timeout;
+
+            // Idle timeouts for specific services, overriding the default one.
+            std::map<std::string, size_t> services;
+
+            // Remote peers which have been silent for this many seconds are pinged, and are detached
+            // if they don't reply within the same interval. Zero disables heartbeats.
+            size_t heartbeat;
+        } keepalive;
     } network;
 
     struct logging_t {
@@ -91,6 +156,14 @@ public:
     component_map_t services;
     component_map_t storages;
 
+    struct {
+        // Sizes of the dedicated execution unit pools, keyed by pool name.
+        std::map<std::string, size_t> pools;
+
+        // Services which attach their sessions to a dedicated pool instead of the shared one.
+        std::map<std::string, std::string> services;
+    } engines;
+
 #ifdef COCAINE_ALLOW_RAFT
     bool create_raft_cluster;
 #endif
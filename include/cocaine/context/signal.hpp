@@ -21,6 +21,8 @@
 #ifndef COCAINE_CONTEXT_SIGNAL_HPP
 #define COCAINE_CONTEXT_SIGNAL_HPP
 
+#include "cocaine/idl/context.hpp"
+
 #include "cocaine/rpc/dispatch.hpp"
 #include "cocaine/rpc/frozen.hpp"
 
@@ -32,16 +34,70 @@ namespace cocaine {
 
 template<class Tag> class retroactive_signal;
 
-namespace aux {
+namespace io {
+
+// Signal history compaction. Every fired event is stored in the signal history under some key, and
+// replaces an older event stored under the same key. Retracting events erase the older event and
+// are not stored at all. By default, only the latest occurrence of each event type is kept.
 
 template<class Event>
+struct signal_traits {
+    typedef std::pair<uint64_t, std::string> key_type;
+    typedef typename basic_slot<Event>::tuple_type tuple_type;
+
+    static const bool retracting = false;
+
+    static inline
+    key_type
+    key(const tuple_type& COCAINE_UNUSED_(args)) {
+        return key_type(event_traits<Event>::id, std::string());
+    }
+};
+
+// Service events are compacted per service name, so that late subscribers are only notified about
+// services which are still alive, no matter how many times they were exposed and removed before.
+
+template<>
+struct signal_traits<context::service::exposed> {
+    typedef std::pair<uint64_t, std::string> key_type;
+    typedef basic_slot<context::service::exposed>::tuple_type tuple_type;
+
+    static const bool retracting = false;
+
+    static inline
+    key_type
+    key(const tuple_type& args) {
+        return key_type(event_traits<context::service::exposed>::id, std::get<0>(args));
+    }
+};
+
+template<>
+struct signal_traits<context::service::removed> {
+    typedef std::pair<uint64_t, std::string> key_type;
+    typedef basic_slot<context::service::removed>::tuple_type tuple_type;
+
+    static const bool retracting = true;
+
+    static inline
+    key_type
+    key(const tuple_type& args) {
+        // NOTE: Shares the key space with the exposure events to retract them.
+        return key_type(event_traits<context::service::exposed>::id, std::get<0>(args));
+    }
+};
+
+} // namespace io
+
+namespace aux {
+
+template<class Event, class Variant>
 struct async_visitor:
     public boost::static_visitor<void>
 {
     typedef typename io::basic_slot<Event>::tuple_type tuple_type;
 
-    async_visitor(const tuple_type& args_, asio::io_service& asio_):
-        args(args_),
+    async_visitor(const std::shared_ptr<Variant>& event_, asio::io_service& asio_):
+        event(event_),
         asio(asio_)
     { }
 
@@ -53,14 +109,18 @@ struct async_visitor:
 
     result_type
     operator()(const std::shared_ptr<io::basic_slot<Event>>& slot) const {
-        auto args = this->args;
+        auto event = this->event;
+
+        asio.post([=] {
+            const auto& frozen = boost::get<io::frozen<Event>>(*event);
 
-        asio.post([=]() mutable {
-            (*slot)(std::move(args), upstream<void>());
+            // NOTE: The frozen event is shared between all the subscribers and the signal history,
+            // which are handled in different threads, so every delivery gets its own copy.
+            (*slot)(tuple_type(frozen.tuple), upstream<void>());
         });
     }
 
-    const tuple_type& args;
+    const std::shared_ptr<Variant>& event;
     asio::io_service& asio;
 };
 
@@ -68,16 +128,21 @@ template<class Tag>
 struct event_visitor:
     public boost::static_visitor<void>
 {
-    event_visitor(const std::shared_ptr<const dispatch<Tag>>& slot_, asio::io_service& asio_):
+    typedef typename io::make_frozen_over<Tag>::type variant_type;
+
+    event_visitor(const std::shared_ptr<const dispatch<Tag>>& slot_,
+                  const std::shared_ptr<variant_type>& event_, asio::io_service& asio_)
+    :
         slot(slot_),
+        event(event_),
         asio(asio_)
     { }
 
     template<class Event>
     result_type
-    operator()(const io::frozen<Event>& event) const {
+    operator()(const io::frozen<Event>& COCAINE_UNUSED_(frozen)) const {
         try {
-            slot->process(io::event_traits<Event>::id, async_visitor<Event>(event.tuple, asio));
+            slot->process(io::event_traits<Event>::id, async_visitor<Event, variant_type>(event, asio));
         } catch(const std::system_error& e) {
             if(e.code() != error::slot_not_found) throw;
         }
@@ -85,6 +150,7 @@ struct event_visitor:
 
 private:
     const std::shared_ptr<const dispatch<Tag>>& slot;
+    const std::shared_ptr<variant_type>& event;
     asio::io_service& asio;
 };
 
@@ -93,6 +159,7 @@ private:
 template<class Tag>
 class retroactive_signal {
     typedef typename io::make_frozen_over<Tag>::type variant_type;
+    typedef std::list<std::shared_ptr<variant_type>> history_type;
 
     struct subscriber_t {
         std::weak_ptr<const dispatch<Tag>> slot;
@@ -101,7 +168,11 @@ class retroactive_signal {
 
     std::mutex mutex;
 
-    std::list<variant_type> history;
+    // Compacted signal history in the firing order, see io::signal_traits<Event> for details. It's
+    // indexed by the compaction key for fast event replacement.
+    history_type history;
+    std::map<std::pair<uint64_t, std::string>, typename history_type::iterator> index;
+
     std::list<subscriber_t> subscribers;
 
 public:
@@ -109,10 +180,9 @@ public:
     listen(const std::shared_ptr<const dispatch<Tag>>& slot, asio::io_service& asio) {
         std::lock_guard<std::mutex> guard(mutex);
 
-        auto visitor = aux::event_visitor<Tag>(slot, asio);
-
         for(auto it = history.begin(); it != history.end(); ++it) {
-            boost::apply_visitor(visitor, *it);
+            auto visitor = aux::event_visitor<Tag>(slot, *it, asio);
+            boost::apply_visitor(visitor, **it);
         }
 
         subscribers.emplace_back(subscriber_t{slot, asio});
@@ -121,9 +191,28 @@ public:
     template<class Event, class... Args>
     void
     invoke(Args&&... args) {
+        typedef io::signal_traits<Event> traits;
+
         std::lock_guard<std::mutex> guard(mutex);
 
-        auto variant = variant_type(io::make_frozen<Event>(std::forward<Args>(args)...));
+        const auto event = std::make_shared<variant_type>(
+            io::make_frozen<Event>(std::forward<Args>(args)...)
+        );
+
+        const auto key = traits::key(boost::get<io::frozen<Event>>(*event).tuple);
+
+        // NOTE: The history is updated before the event is delivered, so that retracting events are
+        // not referenced by the history at all and might be moved into the last subscriber.
+        auto lb = index.find(key);
+
+        if(lb != index.end()) {
+            history.erase(lb->second);
+            index.erase(lb);
+        }
+
+        if(!traits::retracting) {
+            index.insert({key, history.insert(history.end(), event)});
+        }
 
         for(auto it = subscribers.begin(); it != subscribers.end();) {
             auto slot = it->slot.lock();
@@ -132,12 +221,10 @@ public:
                 it = subscribers.erase(it); continue;
             }
 
-            boost::apply_visitor(aux::event_visitor<Tag>(slot, it->asio), variant);
+            boost::apply_visitor(aux::event_visitor<Tag>(slot, event, it->asio), *event);
 
             ++it;
         }
-
-        history.emplace_back(std::move(variant));
     }
 };
 
@@ -21,6 +21,7 @@
 #ifndef COCAINE_DEFAULTS_HPP
 #define COCAINE_DEFAULTS_HPP
 
+#include <cstddef>
 #include <string>
 
 namespace cocaine {
@@ -32,6 +33,17 @@ struct defaults {
 
     // Defaults for networking.
     static const std::string endpoint;
+    static const size_t compression_threshold;
+    static const size_t header_table_capacity;
+    static const size_t frame_size_limit;
+    static const size_t frame_version;
+    static const size_t quantum_messages;
+    static const size_t quantum_bytes;
+    static const size_t rebalance_interval;
+    static const double rebalance_threshold;
+    static const size_t idle_timeout;
+    static const size_t heartbeat_interval;
+    static const size_t service_executors;
 
     // Defaults for logging service.
     static const std::string log_verbosity;
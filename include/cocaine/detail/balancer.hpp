@@ -0,0 +1,63 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_BALANCER_HPP
+#define COCAINE_BALANCER_HPP
+
+#include "cocaine/common.hpp"
+
+#include <asio/deadline_timer.hpp>
+
+namespace cocaine {
+
+class execution_unit_t;
+
+// Periodically moves busy sessions from the most loaded execution unit to the least loaded one, so
+// that long-lived heavy connections don't create permanent hotspots.
+
+class balancer_t {
+    COCAINE_DECLARE_NONCOPYABLE(balancer_t)
+
+    class rebalance_action_t;
+
+    const std::vector<std::unique_ptr<execution_unit_t>>& m_pool;
+
+    const std::unique_ptr<logging::log_t> m_log;
+
+    // Minimum utilization difference between the execution units to trigger a migration.
+    const double m_threshold;
+
+    // I/O
+
+    std::shared_ptr<asio::io_service> m_asio;
+    std::unique_ptr<io::chamber_t> m_chamber;
+
+    std::unique_ptr<asio::deadline_timer> m_cron;
+
+public:
+    // NOTE: The pool must not change during the balancer's lifetime.
+    balancer_t(context_t& context, const std::vector<std::unique_ptr<execution_unit_t>>& pool);
+
+   ~balancer_t();
+};
+
+} // namespace cocaine
+
+#endif
@@ -30,6 +30,7 @@
 #include <asio/deadline_timer.hpp>
 #include <asio/io_service.hpp>
 
+#include <boost/optional/optional.hpp>
 #include <boost/thread/thread.hpp>
 
 namespace cocaine { namespace io {
@@ -46,6 +47,10 @@ class chamber_t {
     // Takes resource usage snapshots every kCollectInterval seconds.
     asio::deadline_timer cron;
 
+    // Dedicated allocator arena for all the allocations made by the chamber's thread, so that memory
+    // usage can be attributed to engines and services. Only available with jemalloc.
+    boost::optional<unsigned int> arena;
+
     // This thread will run the reactor's event loop until terminated.
     std::unique_ptr<boost::thread> thread;
 
@@ -68,6 +73,10 @@ public:
 
     std::string
     thread_id() const;
+
+    // Allocated, active and resident bytes of the chamber's arena. Empty without jemalloc.
+    auto
+    memory_usage() const -> std::map<std::string, uint64_t>;
 };
 
 }} // namespace cocaine::io
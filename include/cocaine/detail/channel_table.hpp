@@ -0,0 +1,190 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_CHANNEL_TABLE_HPP
+#define COCAINE_CHANNEL_TABLE_HPP
+
+#include "cocaine/common.hpp"
+
+#include <boost/optional/optional.hpp>
+
+#include <vector>
+
+namespace cocaine { namespace io {
+
+// Virtual channels of a session. Open addressing with linear probing: channel ids are mostly
+// sequential, so they are used as hashes as is and are spread evenly over the slots. Deletion shifts
+// the following channels back, so lookups don't need any tombstones.
+//
+// Not synchronized: the table is owned by the session thread, so that incoming messages are routed
+// without any locking.
+
+class channel_table_t {
+    COCAINE_DECLARE_NONCOPYABLE(channel_table_t)
+
+    static const size_t kInitialCapacity = 16;
+
+public:
+    struct channel_t {
+        // Zero for unused slots, channel ids start from one.
+        uint64_t       id;
+        dispatch_ptr_t dispatch;
+        upstream_ptr_t upstream;
+    };
+
+    typedef std::vector<channel_t> slot_vector_t;
+
+    channel_table_t():
+        count(0)
+    {
+        slots.resize(kInitialCapacity);
+    }
+
+    // NOTE: The pointer is invalidated by any modification of the table.
+    channel_t*
+    find(uint64_t channel_id) {
+        const auto slot = locate(channel_id);
+
+        return slot == npos ? nullptr : &slots[slot];
+    }
+
+    // NOTE: Invalidates pointers to other channels. The channel must not be in the table yet.
+    channel_t&
+    insert(uint64_t channel_id, const dispatch_ptr_t& dispatch, const upstream_ptr_t& upstream) {
+        return emplace(channel_t{channel_id, dispatch, upstream});
+    }
+
+    // Replaces the dispatch of the channel. Returns false if there's no such channel.
+    bool
+    update(uint64_t channel_id, const dispatch_ptr_t& dispatch) {
+        const auto slot = locate(channel_id);
+
+        if(slot == npos) {
+            return false;
+        }
+
+        slots[slot].dispatch = dispatch;
+
+        return true;
+    }
+
+    auto
+    erase(uint64_t channel_id) -> boost::optional<channel_t> {
+        size_t i = locate(channel_id);
+
+        if(i == npos) {
+            return boost::none;
+        }
+
+        channel_t result = std::move(slots[i]);
+        const size_t mask = slots.size() - 1;
+
+        // Shift the following channels back into the gap, unless they are already in their home
+        // slots or between their home slots and the gap.
+        for(size_t j = (i + 1) & mask; slots[j].id; j = (j + 1) & mask) {
+            const size_t home = slots[j].id & mask;
+
+            if(i <= j ? (home <= i || home > j) : (home <= i && home > j)) {
+                slots[i] = std::move(slots[j]);
+                i = j;
+            }
+        }
+
+        slots[i] = channel_t{0, nullptr, nullptr};
+        count--;
+
+        return result;
+    }
+
+    // Moves all the channels out of the table.
+    auto
+    release() -> slot_vector_t {
+        slot_vector_t result(kInitialCapacity);
+
+        std::swap(result, slots);
+        count = 0;
+
+        return result;
+    }
+
+    // All the slots, including the unused ones.
+    auto
+    channels() const -> const slot_vector_t& {
+        return slots;
+    }
+
+    size_t
+    size() const {
+        return count;
+    }
+
+private:
+    static const size_t npos = static_cast<size_t>(-1);
+
+    size_t
+    locate(uint64_t channel_id) const {
+        const size_t mask = slots.size() - 1;
+
+        for(size_t i = channel_id & mask; slots[i].id; i = (i + 1) & mask) {
+            if(slots[i].id == channel_id) return i;
+        }
+
+        return npos;
+    }
+
+    channel_t&
+    emplace(channel_t&& channel) {
+        if((count + 1) * 2 > slots.size()) {
+            rehash(slots.size() * 2);
+        }
+
+        const size_t mask = slots.size() - 1;
+
+        size_t i = channel.id & mask;
+
+        while(slots[i].id) {
+            i = (i + 1) & mask;
+        }
+
+        slots[i] = std::move(channel);
+        count++;
+
+        return slots[i];
+    }
+
+    void
+    rehash(size_t capacity) {
+        slot_vector_t previous(capacity);
+
+        std::swap(previous, slots);
+        count = 0;
+
+        for(auto it = previous.begin(); it != previous.end(); ++it) {
+            if(it->id) emplace(std::move(*it));
+        }
+    }
+
+    slot_vector_t slots;
+    size_t count;
+};
+
+}} // namespace cocaine::io
+
+#endif
@@ -25,6 +25,8 @@
 
 #include "cocaine/idl/context.hpp"
 
+#include "cocaine/timing_wheel.hpp"
+
 #include <asio/deadline_timer.hpp>
 
 #include <asio/ip/tcp.hpp>
@@ -60,8 +62,8 @@ class multicast_t:
     asio::ip::udp::socket m_socket;
     asio::deadline_timer m_timer;
 
-    // Announce expiration timeouts.
-    std::map<std::string, std::unique_ptr<asio::deadline_timer>> m_expirations;
+    // Announce expiration timeouts, one per remote node.
+    std::map<std::string, std::unique_ptr<io::wheel_timer_t>> m_expirations;
 
     // Signal to handle context ready event
     std::shared_ptr<dispatch<io::context_tag>> m_signals;
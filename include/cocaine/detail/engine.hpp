@@ -22,6 +22,7 @@
 #define COCAINE_ENGINE_HPP
 
 #include "cocaine/common.hpp"
+#include "cocaine/locked_ptr.hpp"
 
 #include <asio/deadline_timer.hpp>
 
@@ -41,14 +42,38 @@ class execution_unit_t {
 
     std::map<int, std::shared_ptr<session_t>> m_sessions;
 
+    // Number of messages handled by every session as of the last rebalancing round.
+    std::map<int, uint64_t> m_traffic;
+
     // I/O
 
     std::shared_ptr<asio::io_service> m_asio;
     std::unique_ptr<io::chamber_t> m_chamber;
 
+    // Whether the unit accepts sessions moved from other units. Closed when the unit is stopped, and
+    // shared with migration handlers of other units, which might outlive it.
+    const std::shared_ptr<synchronized<bool>> m_gate;
+
     // Initialized here because of the dependency on the io::chamber_t's thread ID.
     const std::unique_ptr<logging::log_t> m_log;
 
+    // Capacity of the remote peers' header tables for the headers sent by the sessions.
+    const size_t m_table_capacity;
+
+    // Maximum size of incoming frames for the sessions, and the frame format version for outgoing
+    // sessions.
+    const size_t m_frame_limit;
+    const size_t m_frame_version;
+
+    // Maximum number of messages and bytes handled for every session in one event loop turn.
+    const size_t m_quantum_messages;
+    const size_t m_quantum_bytes;
+
+    // Idle timeouts and the heartbeat interval for incoming sessions, in seconds.
+    const size_t m_idle_timeout;
+    const std::map<std::string, size_t> m_idle_timeouts;
+    const size_t m_heartbeat;
+
     static const unsigned int kCollectionInterval = 60;
 
     // Collects detached sessions every kCollectionInterval seconds. Normally, session slots will be
@@ -61,12 +86,22 @@ public:
 
    ~execution_unit_t();
 
+    // Compression threshold is passed to the session, zero disables the transport compression.
     template<class Socket>
     std::shared_ptr<session<typename Socket::protocol_type>>
-    attach(std::unique_ptr<Socket> ptr, const io::dispatch_ptr_t& dispatch);
+    attach(std::unique_ptr<Socket> ptr, const io::dispatch_ptr_t& dispatch, size_t compression);
+
+    // Moves the session which has handled the most messages since the previous call, among the ones
+    // with nothing left to write at the moment, to the target execution unit. Requests from previous
+    // calls which are still pending are dropped.
+    void
+    rebalance(execution_unit_t& target);
 
     double
     utilization() const;
+
+    auto
+    memory_usage() const -> std::map<std::string, uint64_t>;
 };
 
 } // namespace cocaine
@@ -0,0 +1,120 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_LIVENESS_HPP
+#define COCAINE_LIVENESS_HPP
+
+#include "cocaine/common.hpp"
+#include "cocaine/errors.hpp"
+#include "cocaine/timing_wheel.hpp"
+
+namespace cocaine { namespace io {
+
+// Idle timeout and heartbeat state of a session. The session is checked every period via the timer,
+// and is detached if it has been idle or its remote peer has been silent for too long.
+// NOTE: Not thread-safe, owned by the session thread.
+
+struct liveness_t {
+    // Both intervals are in milliseconds, the session is checked every period.
+    const uint64_t timeout;
+    const uint64_t heartbeat;
+    const uint64_t period;
+
+    std::unique_ptr<wheel_timer_t> timer;
+
+    // Whether the remote peer has advertised heartbeat support, and whether it has been pinged.
+    bool supported;
+    bool pinged;
+
+    // Number of control messages sent and received, which don't count as session activity.
+    uint64_t control;
+
+    // Message counters as of the previous check, and for how long they haven't changed.
+    uint64_t activity;
+    uint64_t received;
+    uint64_t idle;
+    uint64_t silent;
+
+    liveness_t(uint64_t timeout_, uint64_t heartbeat_, uint64_t period_,
+               std::unique_ptr<wheel_timer_t> timer_):
+        timeout(timeout_),
+        heartbeat(heartbeat_),
+        period(period_),
+        timer(std::move(timer_)),
+        supported(false),
+        pinged(false),
+        control(0),
+        activity(0),
+        received(0),
+        idle(0),
+        silent(0)
+    { }
+
+    // Accounts for another period with the given message counters and number of open channels.
+    // Returns the error to detach the session with, if it has been idle or silent for too long.
+    auto
+    check(uint64_t handled, uint64_t written, size_t channels) -> std::error_code {
+        const uint64_t total = handled + written - control;
+
+        // NOTE: Sessions with open channels are never idle, even if there's no traffic for a while,
+        // e.g. while the service is still working on a slow request.
+        if(total != activity || channels) {
+            activity = total;
+            idle = 0;
+        } else {
+            idle += period;
+        }
+
+        if(handled != received) {
+            received = handled;
+            silent = 0;
+            pinged = false;
+        } else {
+            silent += period;
+        }
+
+        if(timeout && idle >= timeout) {
+            return error::idle_timeout;
+        }
+
+        if(pinged && silent >= heartbeat * 2) {
+            return error::heartbeat_timeout;
+        }
+
+        return std::error_code();
+    }
+
+    // Whether the remote peer has to be pinged now. The ping is accounted as a control message.
+    bool
+    ping() {
+        if(!heartbeat || !supported || pinged || silent < heartbeat) {
+            return false;
+        }
+
+        control++;
+        pinged = true;
+
+        return true;
+    }
+};
+
+}} // namespace cocaine::io
+
+#endif
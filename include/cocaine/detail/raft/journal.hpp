@@ -0,0 +1,140 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_RAFT_JOURNAL_HPP
+#define COCAINE_RAFT_JOURNAL_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cocaine { namespace raft {
+
+struct entry_t {
+    uint64_t term;
+
+    // Opaque state machine command. Empty commands are appended by new leaders to commit the
+    // entries of the previous terms.
+    std::string command;
+};
+
+// Persistent Raft state: the current term and vote, the log and the latest snapshot of the state
+// machine, which replaces the log prefix it covers. Entries are indexed from one, zero means
+// nothing.
+//
+// Everything is kept in memory and, unless the path is empty, written to the files in that
+// directory before the corresponding method returns, so that the node can restart without violating
+// the Raft safety guarantees. Not thread-safe.
+
+class journal_t {
+    const std::string m_path;
+
+    uint64_t m_term;
+    std::string m_vote;
+
+    uint64_t m_snapshot_index;
+    uint64_t m_snapshot_term;
+    std::string m_snapshot;
+
+    // Entries following the snapshot.
+    std::vector<entry_t> m_entries;
+
+    // Log file descriptor, entries are appended to the log file as they come.
+    int m_log;
+
+public:
+    explicit
+    journal_t(const std::string& path);
+
+   ~journal_t();
+
+    // Term and vote
+
+    uint64_t
+    term() const {
+        return m_term;
+    }
+
+    const std::string&
+    vote() const {
+        return m_vote;
+    }
+
+    void
+    assign(uint64_t term, const std::string& vote);
+
+    // Log
+
+    uint64_t
+    first() const {
+        return m_snapshot_index + 1;
+    }
+
+    uint64_t
+    last() const {
+        return m_snapshot_index + m_entries.size();
+    }
+
+    // Term of the entry at the index, which must be either covered by the snapshot or be in the
+    // log.
+    uint64_t
+    term(uint64_t index) const;
+
+    const entry_t&
+    at(uint64_t index) const;
+
+    void
+    append(const std::vector<entry_t>& entries);
+
+    // Removes the entry at the index and all the following ones.
+    void
+    truncate(uint64_t index);
+
+    // Snapshot
+
+    uint64_t
+    snapshot_index() const {
+        return m_snapshot_index;
+    }
+
+    uint64_t
+    snapshot_term() const {
+        return m_snapshot_term;
+    }
+
+    const std::string&
+    snapshot() const {
+        return m_snapshot;
+    }
+
+    // Replaces the log prefix up to the index with the snapshot. The remaining entries are kept
+    // only if the log has an entry at the index with the same term, otherwise the whole log is
+    // discarded.
+    void
+    compact(uint64_t index, uint64_t term, std::string snapshot);
+
+private:
+    void
+    rewrite();
+};
+
+}} // namespace cocaine::raft
+
+#endif
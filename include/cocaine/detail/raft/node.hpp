@@ -0,0 +1,282 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_RAFT_NODE_HPP
+#define COCAINE_RAFT_NODE_HPP
+
+#include "cocaine/detail/raft/journal.hpp"
+
+#include <map>
+#include <random>
+#include <set>
+
+namespace cocaine { namespace raft {
+
+// Messages
+
+struct vote_request_t {
+    uint64_t term;
+    std::string candidate;
+    uint64_t last_index;
+    uint64_t last_term;
+};
+
+struct vote_reply_t {
+    uint64_t term;
+    bool granted;
+};
+
+struct append_request_t {
+    uint64_t term;
+    std::string leader;
+    uint64_t prev_index;
+    uint64_t prev_term;
+    std::vector<entry_t> entries;
+    uint64_t commit;
+};
+
+struct append_reply_t {
+    uint64_t term;
+    bool success;
+
+    // Index of the last entry matching the leader's log on success. On failure, the index of the
+    // last entry in the follower's log, so that the leader doesn't have to probe the entries one by
+    // one.
+    uint64_t last_index;
+};
+
+struct install_request_t {
+    uint64_t term;
+    std::string leader;
+    uint64_t index;
+    uint64_t last_term;
+    std::string snapshot;
+};
+
+struct install_reply_t {
+    uint64_t term;
+};
+
+// Outgoing requests. Replies are passed back to the node via its on_*_reply() methods. Requests
+// might be lost, duplicated or reordered, the node doesn't rely on them being delivered.
+
+struct transport_t {
+    virtual
+   ~transport_t() {
+        // Empty.
+    }
+
+    virtual
+    void
+    vote(const std::string& peer, const vote_request_t& request) = 0;
+
+    virtual
+    void
+    append(const std::string& peer, const append_request_t& request) = 0;
+
+    virtual
+    void
+    install(const std::string& peer, const install_request_t& request) = 0;
+};
+
+// Replicated state machine. Committed commands are applied in the log order, exactly once between
+// restores. Empty commands carry no data and should be ignored, but they are still applied, so that
+// proposals which have been replaced by them can be detected.
+
+struct machine_t {
+    virtual
+   ~machine_t() {
+        // Empty.
+    }
+
+    virtual
+    void
+    apply(uint64_t index, uint64_t term, const std::string& command) = 0;
+
+    virtual
+    std::string
+    snapshot() const = 0;
+
+    virtual
+    void
+    restore(uint64_t index, const std::string& snapshot) = 0;
+};
+
+// Raft consensus node. It doesn't do any I/O by itself, time is driven by tick() calls and messages
+// are passed in and out explicitly, so that it can be run in any reactor, or none at all. Not
+// thread- safe, all the methods must be called from the same thread.
+
+class node_t {
+public:
+    enum class role_t { follower, candidate, leader };
+
+    struct options_t {
+        // Followers which haven't heard from the leader for a random time between one and two of
+        // these intervals start an election. Milliseconds.
+        uint64_t election;
+
+        // Interval between the leader's heartbeats. Milliseconds.
+        uint64_t heartbeat;
+
+        // Maximum number of entries in one append request.
+        size_t batch;
+
+        // Number of applied entries after which the log is compacted into a snapshot.
+        size_t compaction;
+    };
+
+private:
+    struct peer_t {
+        // Index of the next entry to send, and of the last entry known to be replicated.
+        uint64_t next;
+        uint64_t match;
+
+        // Index of the snapshot sent to the peer, if any.
+        uint64_t installing;
+    };
+
+    const std::string m_id;
+    const options_t m_options;
+
+    journal_t& m_journal;
+    machine_t& m_machine;
+    transport_t& m_transport;
+
+    role_t m_role;
+    std::string m_leader;
+
+    uint64_t m_commit;
+    uint64_t m_applied;
+
+    std::map<std::string, peer_t> m_peers;
+
+    // Votes granted to this node in the current term, while it's a candidate.
+    std::set<std::string> m_votes;
+
+    // Time since the last heartbeat sent or received, and the current election timeout.
+    uint64_t m_elapsed;
+    uint64_t m_timeout;
+
+    std::mt19937_64 m_random;
+
+public:
+    // The peers must not include this node. The machine is restored from the journal's snapshot and
+    // nothing else is applied until the commit index is learned from the leader.
+    node_t(const std::string& id, const std::vector<std::string>& peers, const options_t& options,
+           journal_t& journal, machine_t& machine, transport_t& transport);
+
+    // Observers
+
+    const std::string&
+    id() const {
+        return m_id;
+    }
+
+    role_t
+    role() const {
+        return m_role;
+    }
+
+    uint64_t
+    term() const {
+        return m_journal.term();
+    }
+
+    // Current leader, if known.
+    const std::string&
+    leader() const {
+        return m_leader;
+    }
+
+    uint64_t
+    commit() const {
+        return m_commit;
+    }
+
+    uint64_t
+    applied() const {
+        return m_applied;
+    }
+
+    // Modifiers
+
+    void
+    tick(uint64_t elapsed);
+
+    // Appends the command to the log, if this node is the leader. Returns the index of the new
+    // entry, or zero if this node is not the leader. The command is committed once it's applied
+    // with the same index and term, a different term there means that it has been lost.
+    uint64_t
+    propose(const std::string& command);
+
+    // Message handlers
+
+    vote_reply_t
+    on_vote(const vote_request_t& request);
+
+    append_reply_t
+    on_append(const append_request_t& request);
+
+    install_reply_t
+    on_install(const install_request_t& request);
+
+    void
+    on_vote_reply(const std::string& peer, const vote_reply_t& reply);
+
+    void
+    on_append_reply(const std::string& peer, const append_reply_t& reply);
+
+    void
+    on_install_reply(const std::string& peer, const install_reply_t& reply);
+
+private:
+    size_t
+    quorum() const {
+        return (m_peers.size() + 1) / 2 + 1;
+    }
+
+    void
+    step_down(uint64_t term);
+
+    void
+    campaign();
+
+    void
+    lead();
+
+    void
+    replicate();
+
+    void
+    replicate(const std::string& name, peer_t& peer);
+
+    void
+    advance();
+
+    void
+    apply();
+
+    void
+    reset();
+};
+
+}} // namespace cocaine::raft
+
+#endif
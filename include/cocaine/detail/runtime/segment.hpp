@@ -0,0 +1,140 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_BOOTSTRAP_SEGMENT_HPP
+#define COCAINE_BOOTSTRAP_SEGMENT_HPP
+
+#include "cocaine/common.hpp"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace cocaine { namespace logging {
+
+// Binary log segments are preallocated files of a fixed size, named after their sequence numbers.
+// Each segment starts with a header, followed by the records, each prefixed with its size and the
+// commit flag, aligned to 8 bytes. The rest of the segment is zeroed. Records are opaque to the
+// segments, the logging sink writes msgpack maps.
+//
+// Space reserved by a writer which has died before storing the record size stays zeroed as well.
+// Readers can't tell it apart from a reservation still being filled in, so they stop at the first
+// zeroed header, unless the segment is sealed, i.e. no writer can touch it anymore. Only then the
+// zeroed words are skipped until the next record header.
+
+namespace segment {
+
+struct header_t {
+    char magic[8];
+    uint32_t version;
+
+    // Number of records dropped while the segment has been the current one, e.g. because they were
+    // too large or because the next segment couldn't be created. Updated atomically.
+    uint32_t dropped;
+
+    // Set once the segment has been closed by its writer, or found by the next run of the writer
+    // after a crash.
+    uint32_t sealed;
+    uint32_t padding;
+};
+
+struct record_t {
+    uint32_t size;
+
+    // Set once the record has been copied completely. Records of crashed writers stay zeroed.
+    uint32_t committed;
+};
+
+extern const char kMagic[8];
+
+const uint32_t kVersion = 1;
+
+// Calls the handler for every committed record in the segment file, in the order of reservation.
+// Returns the number of records dropped by the writer while the segment has been the current one.
+uint32_t
+read(const std::string& path, const std::function<void(const char*, size_t)>& handler);
+
+} // namespace segment
+
+// Writes records into memory-mapped segments in the directory. Writers reserve space in the current
+// segment with an atomic increment and copy the records in parallel. Only switching to a new
+// segment, which happens when the current one is full, is serialized. The oldest segments are
+// removed, so that there are at most the specified number of them.
+
+class segment_writer_t {
+    COCAINE_DECLARE_NONCOPYABLE(segment_writer_t)
+
+    struct segment_t;
+
+    const std::string m_path;
+    const size_t m_size;
+    const size_t m_limit;
+
+    std::atomic<segment_t*> m_current;
+
+    // Records which haven't fit into the segments, or have been written while the next segment
+    // couldn't be created.
+    std::atomic<uint64_t> m_dropped;
+
+    // Segment switching synchronization.
+    std::mutex m_mutex;
+
+    uint64_t m_sequence;
+
+    // Segments are never deleted until the writer is, because writers might still be holding them.
+    // Their mappings are released once there are no writers left, and then they are reused for the
+    // next segments, so there are only as many of them as segments in use at the same time.
+    std::deque<std::unique_ptr<segment_t>> m_segments;
+    std::deque<segment_t*> m_retired;
+    std::vector<segment_t*> m_spare;
+
+    // Segment files on disk, oldest first.
+    std::deque<std::string> m_files;
+
+public:
+    segment_writer_t(const std::string& path, size_t size, size_t limit);
+   ~segment_writer_t();
+
+    // Returns false if the record has been dropped.
+    bool
+    write(const char* data, size_t size);
+
+    uint64_t
+    dropped() const {
+        return m_dropped;
+    }
+
+private:
+    // Accounts for the dropped record in the writer and in the segment, which must be held.
+    void
+    drop(segment_t* segment);
+
+    bool
+    rotate(segment_t* segment);
+
+    segment_t*
+    create(uint64_t sequence);
+};
+
+}} // namespace cocaine::logging
+
+#endif
@@ -50,6 +50,7 @@ typedef result_of<io::locator::resolve>::type resolve;
 typedef result_of<io::locator::connect>::type connect;
 typedef result_of<io::locator::cluster>::type cluster;
 typedef result_of<io::locator::routing>::type routing;
+typedef result_of<io::locator::memory>::type memory;
 
 } // namespace results
 
@@ -167,6 +168,9 @@ private:
     auto
     on_cluster() const -> results::cluster;
 
+    auto
+    on_memory() const -> results::memory;
+
     auto
     on_routing(const std::string& ruid, bool replace = false) -> streamed<results::routing>;
 
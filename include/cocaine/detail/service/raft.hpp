@@ -0,0 +1,73 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_RAFT_SERVICE_HPP
+#define COCAINE_RAFT_SERVICE_HPP
+
+#include "cocaine/api/service.hpp"
+
+#include "cocaine/idl/raft.hpp"
+#include "cocaine/rpc/dispatch.hpp"
+#include "cocaine/rpc/slot/deferred.hpp"
+
+namespace cocaine { namespace storage {
+
+class raft_t;
+
+} // namespace storage
+
+namespace service {
+
+// Network face of the Raft storage backend, which peers send their requests to. It also keeps the
+// backend running, so it should be configured on every node using the backend, on a pinned port
+// matching the peer endpoints in the backend configuration.
+
+class raft_t:
+    public api::service_t,
+    public dispatch<io::raft_tag>
+{
+    const std::shared_ptr<storage::raft_t> m_storage;
+
+public:
+    raft_t(context_t& context, asio::io_service& asio, const std::string& name, const dynamic_t& args);
+
+    virtual
+    auto
+    prototype() const -> const io::basic_dispatch_t&;
+
+private:
+    deferred<std::tuple<uint64_t, bool>>
+    on_vote(uint64_t term, const std::string& candidate, uint64_t last_index, uint64_t last_term);
+
+    deferred<std::tuple<uint64_t, bool, uint64_t>>
+    on_append(uint64_t term, const std::string& leader, uint64_t prev_index, uint64_t prev_term,
+              const std::vector<std::tuple<uint64_t, std::string>>& entries, uint64_t commit);
+
+    deferred<uint64_t>
+    on_install(uint64_t term, const std::string& leader, uint64_t index, uint64_t last_term,
+               const std::string& snapshot);
+
+    deferred<std::tuple<uint64_t, uint64_t>>
+    on_propose(const std::string& command);
+};
+
+}} // namespace cocaine::service
+
+#endif
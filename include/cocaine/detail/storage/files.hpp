@@ -23,6 +23,8 @@
 
 #include "cocaine/api/storage.hpp"
 
+#include <set>
+
 #include <boost/filesystem/path.hpp>
 
 namespace cocaine { namespace storage {
@@ -38,6 +40,17 @@ class files_t:
 
     const boost::filesystem::path m_parent_path;
 
+    struct index_t {
+        // Collection directory modification time in nanoseconds at the moment the index has been
+        // built or updated, so that the files changed behind the storage's back are picked up. Zero
+        // means that the index can't be trusted and has to be rebuilt on the next listing.
+        uint64_t mtime;
+        std::set<std::string> keys;
+    };
+
+    // Sorted key indices for the collections which have been listed at least once.
+    std::map<std::string, index_t> m_indices;
+
 public:
     files_t(context_t& context, const std::string& name, const dynamic_t& args);
 
@@ -60,6 +73,18 @@ public:
     virtual
     std::vector<std::string>
     find(const std::string& collection, const std::vector<std::string>& tags);
+
+    virtual
+    std::vector<std::string>
+    list(const std::string& collection, const std::string& prefix, const std::string& start_after,
+         size_t limit);
+
+private:
+    // Updates the collection index, if there's one, after the key has been written or removed. The
+    // index is dropped instead if the collection has been modified by someone else since the index
+    // has been built, i.e. if its modification time before the change doesn't match.
+    void
+    update(const std::string& collection, const std::string& key, bool exists, uint64_t mtime);
 };
 
 }} // namespace cocaine::storage
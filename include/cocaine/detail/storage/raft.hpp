@@ -0,0 +1,120 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_RAFT_STORAGE_HPP
+#define COCAINE_RAFT_STORAGE_HPP
+
+#include "cocaine/api/storage.hpp"
+
+#include "cocaine/detail/raft/node.hpp"
+
+#include <chrono>
+#include <future>
+
+#include <asio/deadline_timer.hpp>
+#include <asio/io_service.hpp>
+
+namespace cocaine { namespace storage {
+
+// Storage replicated among a fixed set of nodes with Raft. Writes are committed by the majority of
+// the nodes before they return, and followers forward them to the leader. Reads are served locally
+// from memory, so they might be slightly stale on followers.
+//
+// Writes to the collection named by the "refresh" argument ("groups" by default) are pushed to the
+// local Locator, so that routing groups are refreshed on all the nodes automatically.
+
+class raft_t:
+    public api::storage_t
+{
+    class machine_t;
+    class transport_t;
+
+    const std::unique_ptr<logging::log_t> m_log;
+
+    // Raft reactor. The node, the journal and the transport are only accessed from its thread.
+    const std::shared_ptr<asio::io_service> m_asio;
+
+    asio::deadline_timer m_timer;
+
+    // Node time is advanced by the time actually elapsed since then, as timers might fire late.
+    std::chrono::steady_clock::time_point m_ticked;
+
+    const std::shared_ptr<api::connector_t> m_connector;
+
+    // Writes which haven't been committed within this many milliseconds fail.
+    const uint64_t m_timeout;
+
+    std::unique_ptr<raft::journal_t> m_journal;
+    std::unique_ptr<machine_t> m_machine;
+    std::unique_ptr<transport_t> m_transport;
+    std::unique_ptr<raft::node_t> m_node;
+
+    std::unique_ptr<io::chamber_t> m_chamber;
+
+public:
+    raft_t(context_t& context, const std::string& name, const dynamic_t& args);
+
+    virtual
+   ~raft_t();
+
+    virtual
+    std::string
+    read(const std::string& collection, const std::string& key);
+
+    virtual
+    void
+    write(const std::string& collection, const std::string& key, const std::string& blob,
+          const std::vector<std::string>& tags);
+
+    virtual
+    void
+    remove(const std::string& collection, const std::string& key);
+
+    virtual
+    std::vector<std::string>
+    find(const std::string& collection, const std::vector<std::string>& tags);
+
+    virtual
+    std::vector<std::string>
+    list(const std::string& collection, const std::string& prefix, const std::string& start_after,
+         size_t limit);
+
+    // Calls the function with the node in the Raft reactor. Used to pass in the peer requests.
+    void
+    invoke(std::function<void(raft::node_t&)> function);
+
+private:
+    void
+    on_tick(const std::error_code& ec);
+
+    // Blocks until the command is committed and applied locally.
+    void
+    commit(const std::string& command);
+
+    void
+    propose(const std::string& command, const std::shared_ptr<std::promise<void>>& promise);
+
+    void
+    wait(uint64_t index, uint64_t term, const std::shared_ptr<std::promise<void>>& promise);
+};
+
+}} // namespace cocaine::storage
+
+#endif
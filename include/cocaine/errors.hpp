@@ -32,7 +32,10 @@ enum transport_errors {
     frame_format_error = 1,
     hpack_error,
     insufficient_bytes,
-    parse_error
+    parse_error,
+    compression_error,
+    idle_timeout,
+    heartbeat_timeout
 };
 
 enum dispatch_errors {
@@ -42,7 +45,8 @@ enum dispatch_errors {
     revoked_channel,
     slot_not_found,
     unbound_dispatch,
-    uncaught_error
+    uncaught_error,
+    deadline_expired
 };
 
 enum repository_errors {
@@ -81,6 +85,11 @@ struct registrar {
     auto
     map(size_t id) -> const std::error_category&;
 
+    // Number of the registered error categories.
+    static
+    auto
+    size() -> size_t;
+
     // Modifiers
 
     static
@@ -21,34 +21,470 @@
 #ifndef COCAINE_FORMAT_HPP
 #define COCAINE_FORMAT_HPP
 
-#include <boost/format.hpp>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <type_traits>
 
 namespace cocaine { namespace aux {
 
+// Formatting buffer. Messages are rendered into the inline storage, which spills over to the heap
+// only if the message doesn't fit, so that the only allocation in the common case is the resulting
+// string itself.
+
+class format_buffer_t {
+    static const size_t kInlineSize = 512;
+
+    char m_inline[kInlineSize];
+    std::unique_ptr<char[]> m_heap;
+
+    char * m_data;
+    size_t m_size;
+    size_t m_capacity;
+
+public:
+    format_buffer_t():
+        m_data(m_inline),
+        m_size(0),
+        m_capacity(kInlineSize)
+    { }
+
+    format_buffer_t(const format_buffer_t& other) = delete;
+
+    format_buffer_t&
+    operator=(const format_buffer_t& other) = delete;
+
+    // Returns a pointer to at least the specified amount of writable bytes past the message end.
+    char*
+    reserve(size_t size) {
+        if(size > m_capacity - m_size) {
+            size_t capacity = m_capacity * 2;
+
+            while(size > capacity - m_size) {
+                capacity *= 2;
+            }
+
+            std::unique_ptr<char[]> heap(new char[capacity]);
+            std::memcpy(heap.get(), m_data, m_size);
+
+            m_heap = std::move(heap);
+            m_data = m_heap.get();
+            m_capacity = capacity;
+        }
+
+        return m_data + m_size;
+    }
+
+    void
+    commit(size_t size) {
+        m_size += size;
+    }
+
+    void
+    append(const char* data, size_t size) {
+        std::memcpy(reserve(size), data, size);
+        commit(size);
+    }
+
+    // Pads everything written after the specified offset up to the specified width.
+    void
+    justify(size_t offset, size_t width, bool left) {
+        const size_t size = m_size - offset;
+
+        if(size >= width) {
+            return;
+        }
+
+        char* ptr = reserve(width - size);
+
+        if(left) {
+            std::memset(ptr, ' ', width - size);
+        } else {
+            std::memmove(m_data + offset + width - size, m_data + offset, size);
+            std::memset(m_data + offset, ' ', width - size);
+        }
+
+        commit(width - size);
+    }
+
+    auto
+    size() const -> size_t {
+        return m_size;
+    }
+
+    auto
+    str() const -> std::string {
+        return std::string(m_data, m_size);
+    }
+};
+
+// Format directives are the usual printf-like ones, i.e. %[flags][width][.precision][length]type,
+// but the argument types are deduced at compile time, so the length modifiers are ignored and any
+// directive type can be used with any argument, just like with boost::format().
+
+struct format_spec_t {
+    // Directive text without the length modifiers and the conversion type.
+    const char* begin;
+    const char* modifiers;
+
+    size_t width;
+    char   conversion;
+
+    // Left justification flag.
+    bool left;
+
+    // No flags, width or precision.
+    bool plain;
+};
+
+struct format_cursor_t {
+    static const size_t kMaxDirectiveSize = 24;
+
+    format_cursor_t(const char* it_, const char* end_):
+        it(it_),
+        end(end_),
+        error(nullptr)
+    { }
+
+    // Copies the literal text up to the next directive into the buffer, then parses the directive.
+    // Returns false if there are no directives left or the format string is malformed.
+    bool
+    next(format_buffer_t& buffer, format_spec_t& spec) {
+        while(!error && it != end) {
+            const char* percent = static_cast<const char*>(std::memchr(it, '%', end - it));
+
+            if(percent == nullptr) {
+                buffer.append(it, end - it);
+                it = end;
+                break;
+            }
+
+            buffer.append(it, percent - it);
+
+            if(percent + 1 != end && percent[1] == '%') {
+                buffer.append("%", 1);
+                it = percent + 2;
+                continue;
+            }
+
+            return parse(percent, spec);
+        }
+
+        return false;
+    }
+
+    const char* it;
+    const char* end;
+
+    // Human-readable description of the first formatting error, if any.
+    const char* error;
+
+private:
+    bool
+    parse(const char* percent, format_spec_t& spec) {
+        const char* ptr = percent + 1;
+
+        spec.begin = percent;
+        spec.width = 0;
+        spec.left  = false;
+
+        for(; ptr != end && *ptr && std::strchr("-+ #0", *ptr); ++ptr) {
+            spec.left |= *ptr == '-';
+        }
+
+        for(; ptr != end && *ptr >= '0' && *ptr <= '9'; ++ptr) {
+            spec.width = spec.width * 10 + (*ptr - '0');
+        }
+
+        if(ptr != end && *ptr == '.') {
+            for(++ptr; ptr != end && *ptr >= '0' && *ptr <= '9'; ++ptr);
+        }
+
+        spec.modifiers = ptr;
+        spec.plain = spec.modifiers == percent + 1;
+
+        for(; ptr != end && *ptr && std::strchr("hlLqjzt", *ptr); ++ptr);
+
+        if(ptr == end || !std::isalpha(static_cast<unsigned char>(*ptr)) ||
+           static_cast<size_t>(spec.modifiers - percent) > kMaxDirectiveSize)
+        {
+            error = "format-string is ill-formed";
+            return false;
+        }
+
+        spec.conversion = *ptr;
+        it = ptr + 1;
+
+        return true;
+    }
+};
+
+// Directive rendering through the C library, for everything except the plain decimals and strings.
+
+template<class T>
 static inline
-std::string
-substitute(boost::format&& message) {
-    return message.str();
+void
+format_native(format_buffer_t& buffer, const format_spec_t& spec, const char* length, char conversion,
+              T value)
+{
+    char directive[format_cursor_t::kMaxDirectiveSize + 4];
+
+    const size_t size = spec.modifiers - spec.begin;
+
+    std::memcpy(directive, spec.begin, size);
+    std::strcpy(directive + size, length);
+    std::strncat(directive, &conversion, 1);
+
+    size_t capacity = 64;
+
+    while(true) {
+        const int rv = std::snprintf(buffer.reserve(capacity), capacity, directive, value);
+
+        if(rv < 0) {
+            return;
+        } else if(static_cast<size_t>(rv) < capacity) {
+            return buffer.commit(rv);
+        }
+
+        capacity = rv + 1;
+    }
+}
+
+template<class T>
+static inline
+bool
+is_negative(T value, std::true_type) {
+    return value < 0;
+}
+
+template<class T>
+static inline
+bool
+is_negative(T, std::false_type) {
+    return false;
+}
+
+template<class T>
+static inline
+void
+format_decimal(format_buffer_t& buffer, T value) {
+    typedef typename std::make_unsigned<T>::type unsigned_type;
+
+    char digits[24];
+    char* ptr = digits + sizeof(digits);
+
+    const bool negative = is_negative(value, std::is_signed<T>());
+
+    unsigned_type magnitude = negative ? unsigned_type(0) - static_cast<unsigned_type>(value)
+                                       : static_cast<unsigned_type>(value);
+
+    do {
+        *--ptr = '0' + magnitude % 10;
+    } while(magnitude /= 10);
+
+    if(negative) {
+        *--ptr = '-';
+    }
+
+    buffer.append(ptr, digits + sizeof(digits) - ptr);
+}
+
+static inline
+bool
+is_floating_conversion(char conversion) {
+    return std::strchr("fFeEgGaA", conversion) != nullptr;
+}
+
+// Argument formatting traits
+
+template<class T, class = void>
+struct format_traits {
+    static inline
+    void
+    apply(format_buffer_t& buffer, const format_spec_t& spec, const T& value) {
+        const size_t offset = buffer.size();
+
+        std::ostringstream stream;
+        stream << value;
+
+        const std::string& result = stream.str();
+
+        buffer.append(result.data(), result.size());
+        buffer.justify(offset, spec.width, spec.left);
+    }
+};
+
+template<class T>
+struct format_traits<T, typename std::enable_if<std::is_integral<T>::value>::type> {
+    static inline
+    void
+    apply(format_buffer_t& buffer, const format_spec_t& spec, T value) {
+        if(is_floating_conversion(spec.conversion)) {
+            return format_native(buffer, spec, "", spec.conversion, static_cast<double>(value));
+        }
+
+        char conversion = spec.conversion;
+
+        if(!std::strchr("uxXo", conversion)) {
+            conversion = std::is_signed<T>::value ? 'd' : 'u';
+        }
+
+        if(spec.plain && (conversion == 'd' || conversion == 'u')) {
+            return format_decimal(buffer, value);
+        }
+
+        if(conversion == 'd') {
+            format_native(buffer, spec, "ll", conversion, static_cast<long long>(value));
+        } else {
+            format_native(buffer, spec, "ll", conversion, static_cast<unsigned long long>(value));
+        }
+    }
+};
+
+template<class T>
+struct format_traits<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    static inline
+    void
+    apply(format_buffer_t& buffer, const format_spec_t& spec, T value) {
+        const char conversion = is_floating_conversion(spec.conversion) ? spec.conversion : 'g';
+
+        if(std::is_same<T, long double>::value) {
+            format_native(buffer, spec, "L", conversion, static_cast<long double>(value));
+        } else {
+            format_native(buffer, spec, "", conversion, static_cast<double>(value));
+        }
+    }
+};
+
+// NOTE: Booleans and characters are formatted the same way the standard streams do it.
+
+template<>
+struct format_traits<bool> {
+    static inline
+    void
+    apply(format_buffer_t& buffer, const format_spec_t& spec, bool value) {
+        const size_t offset = buffer.size();
+
+        buffer.append(value ? "1" : "0", 1);
+        buffer.justify(offset, spec.width, spec.left);
+    }
+};
+
+template<>
+struct format_traits<char> {
+    static inline
+    void
+    apply(format_buffer_t& buffer, const format_spec_t& spec, char value) {
+        const size_t offset = buffer.size();
+
+        buffer.append(&value, 1);
+        buffer.justify(offset, spec.width, spec.left);
+    }
+};
+
+template<>
+struct format_traits<signed char>: public format_traits<char> { };
+
+template<>
+struct format_traits<unsigned char>: public format_traits<char> { };
+
+template<>
+struct format_traits<std::string> {
+    static inline
+    void
+    apply(format_buffer_t& buffer, const format_spec_t& spec, const std::string& value) {
+        const size_t offset = buffer.size();
+
+        buffer.append(value.data(), value.size());
+        buffer.justify(offset, spec.width, spec.left);
+    }
+};
+
+template<class T>
+struct format_traits<T, typename std::enable_if<
+    std::is_same<typename std::decay<T>::type,       char*>::value ||
+    std::is_same<typename std::decay<T>::type, const char*>::value>::type>
+{
+    static inline
+    void
+    apply(format_buffer_t& buffer, const format_spec_t& spec, const char* value) {
+        const size_t offset = buffer.size();
+
+        if(value) {
+            buffer.append(value, std::strlen(value));
+        } else {
+            buffer.append("<null>", 6);
+        }
+
+        buffer.justify(offset, spec.width, spec.left);
+    }
+};
+
+static inline
+void
+substitute(format_cursor_t& cursor, format_buffer_t& buffer) {
+    format_spec_t spec;
+
+    if(cursor.next(buffer, spec)) {
+        cursor.error = "format-string referred to more arguments than were passed";
+    }
 }
 
 template<typename T, class... Args>
 static inline
+void
+substitute(format_cursor_t& cursor, format_buffer_t& buffer, const T& argument, const Args&... args) {
+    format_spec_t spec;
+
+    if(!cursor.next(buffer, spec)) {
+        if(!cursor.error) {
+            cursor.error = "format-string referred to less arguments than were passed";
+        }
+
+        return;
+    }
+
+    format_traits<T>::apply(buffer, spec, argument);
+
+    substitute(cursor, buffer, args...);
+}
+
+template<class... Args>
+static inline
 std::string
-substitute(boost::format&& message, const T& argument, const Args&... args) {
-    return substitute(std::move(message % argument), args...);
+format(const char* format, size_t size, const Args&... args) {
+    format_buffer_t buffer;
+    format_cursor_t cursor(format, format + size);
+
+    substitute(cursor, buffer, args...);
+
+    if(cursor.error) {
+        return std::string("<unable to format message - ") + cursor.error + ">";
+    }
+
+    return buffer.str();
 }
 
 } // namespace aux
 
+// Formats the message in a single pass over the format string without throwing on malformed format
+// strings or argument count mismatches. Argument types are dispatched at compile time.
+
 template<class... Args>
 static inline
 std::string
 format(const std::string& format, const Args&... args) {
-    try {
-        return aux::substitute(std::move(boost::format(format)), args...);
-    } catch(const boost::io::format_error& e) {
-        return aux::substitute(std::move(boost::format("<unable to format message - %s>")), e.what());
-    }
+    return aux::format(format.data(), format.size(), args...);
+}
+
+template<class... Args>
+static inline
+std::string
+format(const char* format, const Args&... args) {
+    return aux::format(format, std::strlen(format), args...);
 }
 
 } // namespace cocaine
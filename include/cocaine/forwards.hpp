@@ -38,6 +38,8 @@ typedef unsigned short port_t;
 
 namespace cocaine { namespace api {
 
+class connector_t;
+
 struct cluster_t;
 struct gateway_t;
 struct isolate_t;
@@ -73,6 +75,10 @@ struct transport;
 class basic_dispatch_t;
 class basic_upstream_t;
 
+class channel_table_t;
+
+struct liveness_t;
+
 typedef std::shared_ptr<const basic_dispatch_t> dispatch_ptr_t;
 typedef std::shared_ptr<      basic_upstream_t> upstream_ptr_t;
 
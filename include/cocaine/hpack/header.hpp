@@ -343,6 +343,11 @@ public:
     size_t
     data_capacity() const;
 
+    // Changes the dynamic table capacity as described in HPACK dynamic table size update, evicting
+    // entries which no longer fit. Capacity can not exceed max_data_capacity.
+    void
+    set_capacity(size_t capacity);
+
     bool
     empty() const;
 
@@ -358,8 +363,13 @@ private:
     size_t
     find(const std::function<bool(const header_t&)> comp);
 
+    // Allocates storage for the current capacity. Most of the tables are never populated, so this is
+    // deferred until the first header is actually pushed.
+    void
+    allocate();
+
     // Header storage. Implemented as circular buffer
-    std::array<header_t, max_header_capacity> headers;
+    std::vector<header_t> headers;
     size_t header_lower_bound;
     size_t header_upper_bound;
 
@@ -367,7 +377,7 @@ private:
     // Implemented as a sort of circular buffer.
     // We multiply by 2 as data can be padded and we don't want to move it in memory.
     // 2 multiplier guarantee that we can add new value to the end or beginning without data overlap.
-    std::array<char, max_data_capacity*2> header_data;
+    std::vector<char> header_data;
     size_t data_lower_bound;
     size_t data_lower_bound_end;
     size_t data_upper_bound;
@@ -23,11 +23,30 @@
 
 #include "cocaine/hpack/header.hpp"
 
+#include "cocaine/traits.hpp"
+
 #include <msgpack/pack.hpp>
 #include <msgpack/object.hpp>
 
 namespace cocaine { namespace hpack {
 
+// Advertised by the peer to signal that it accepts dynamic table size updates. Older peers reject
+// them, so the updates are only sent once the remote peer has advertised this.
+
+struct table_size_header {
+    static
+    header::data_t
+    name() {
+        return header::create_data("table-size");
+    }
+
+    static
+    header::data_t
+    value() {
+        return header::create_data("update");
+    }
+};
+
 struct msgpack_traits {
     // Pack a header from static table with predefined value
     template<class Header, class Stream>
@@ -83,6 +102,81 @@ struct msgpack_traits {
         packer.pack_raw_body(source.get_value().blob, source.get_value().size);
     }
 
+    // Pack a header as a literal, which is not stored in the dynamic tables on either side, so that
+    // one-off headers don't force the tables to be allocated.
+    template<class Stream>
+    static
+    void
+    pack_literal(msgpack::packer<Stream>& packer, const header_t& source) {
+        packer.pack_array(3);
+        packer.pack_false();
+        packer.pack_raw(source.get_name().size);
+        packer.pack_raw_body(source.get_name().blob, source.get_name().size);
+        packer.pack_raw(source.get_value().size);
+        packer.pack_raw_body(source.get_value().blob, source.get_value().size);
+    }
+
+    // Pack a dynamic table size update and apply it to the local table. Receiver applies it to its own
+    // table before processing the following headers.
+    template<class Stream>
+    static
+    void
+    pack_capacity(msgpack::packer<Stream>& packer, header_table_t& table, size_t capacity) {
+        table.set_capacity(capacity);
+        packer.pack_array(1);
+        packer.pack_fix_uint64(capacity);
+    }
+
+    // Exact packed sizes of the headers above, given the same header table state. Fixed-size integers
+    // are always 9 bytes long.
+    template<class Header>
+    static
+    size_t
+    size() {
+        return 9;
+    }
+
+    template<class Header>
+    static
+    size_t
+    size(header_table_t& table, const header::data_t& header_data) {
+        size_t pos = header_static_table_t::idx<Header>();
+        if(table[pos].get_value() == header_data) {
+            return 9;
+        }
+        return 1 + 1 + 9 + io::aux::raw_header_size(header_data.size) + header_data.size;
+    }
+
+    static
+    size_t
+    size(header_table_t& table, const header_t& source) {
+        if(table.find_by_full_match(source)) {
+            return 9;
+        }
+        size_t result = 1 + 1;
+        if(table.find_by_name(source)) {
+            result += 9;
+        } else {
+            result += io::aux::raw_header_size(source.get_name().size) + source.get_name().size;
+        }
+        result += io::aux::raw_header_size(source.get_value().size) + source.get_value().size;
+        return result;
+    }
+
+    static
+    size_t
+    size_literal(const header_t& source) {
+        return 1 + 1 +
+            io::aux::raw_header_size(source.get_name().size) + source.get_name().size +
+            io::aux::raw_header_size(source.get_value().size) + source.get_value().size;
+    }
+
+    static
+    size_t
+    size_capacity() {
+        return 1 + 9;
+    }
+
     static inline
     header_t
     unpack(const msgpack::object& source, header_table_t& table) {
@@ -121,34 +215,53 @@ struct msgpack_traits {
         return result;
     }
 
+    // Unpacks a single metadata entry, which is either a header or a dynamic table size update.
+    static inline
+    bool
+    unpack_entry(const msgpack::object& obj, header_table_t& table, std::vector<header_t>& target) {
+        if(obj.type == msgpack::type::ARRAY &&
+           obj.via.array.size == 1 &&
+           obj.via.array.ptr[0].type == msgpack::type::POSITIVE_INTEGER)
+        {
+            // Dynamic table size update.
+            try {
+                table.set_capacity(obj.via.array.ptr[0].via.u64);
+            } catch (...) {
+                return false;
+            }
+        } else if(obj.type == msgpack::type::POSITIVE_INTEGER || (
+               obj.type == msgpack::type::ARRAY &&
+               obj.via.array.size == 3 &&
+               //Either to add header to dynamic table or not
+               obj.via.array.ptr[0].type == msgpack::type::BOOLEAN && (
+                    //Either reference to table or raw data
+                    obj.via.array.ptr[1].type == msgpack::type::POSITIVE_INTEGER ||
+                    obj.via.array.ptr[1].type == msgpack::type::RAW
+               ) && (
+                    //Either raw data or a number.
+                    obj.via.array.ptr[2].type == msgpack::type::RAW ||
+                    obj.via.array.ptr[2].type == msgpack::type::POSITIVE_INTEGER
+               )
+           )
+        ) {
+            try {
+                target.push_back(unpack(obj, table));
+            } catch (...) {
+                // Just swallow it. We can not do anything here.
+                return false;
+            }
+        } else {
+            return false;
+        }
+        return true;
+    }
+
     static inline
     bool
     unpack_vector(const msgpack::object& source, header_table_t& table, std::vector<header_t>& target) {
         target.reserve(source.via.array.size);
         for (size_t i = 0; i < source.via.array.size; i++) {
-            msgpack::object& obj = source.via.array.ptr[i];
-            if(obj.type == msgpack::type::POSITIVE_INTEGER || (
-                   obj.type == msgpack::type::ARRAY &&
-                   obj.via.array.size == 3 &&
-                   //Either to add header to dynamic table or not
-                   obj.via.array.ptr[0].type == msgpack::type::BOOLEAN && (
-                        //Either reference to table or raw data
-                        obj.via.array.ptr[1].type == msgpack::type::POSITIVE_INTEGER ||
-                        obj.via.array.ptr[1].type == msgpack::type::RAW
-                   ) && (
-                        //Either raw data or a number.
-                        obj.via.array.ptr[2].type == msgpack::type::RAW ||
-                        obj.via.array.ptr[2].type == msgpack::type::POSITIVE_INTEGER
-                   )
-               )
-            ) {
-                try {
-                    target.push_back(unpack(obj, table));
-                } catch (...) {
-                    // Just swallow it. We can not do anything here.
-                    return false;
-                }
-            } else {
+            if(!unpack_entry(source.via.array.ptr[i], table, target)) {
                 return false;
             }
         }
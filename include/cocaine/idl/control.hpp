@@ -0,0 +1,94 @@
+/*
+    Copyright (c) 2011-2015 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_CONTROL_INTERFACE_HPP
+#define COCAINE_CONTROL_INTERFACE_HPP
+
+#include "cocaine/hpack/header.hpp"
+
+#include "cocaine/rpc/protocol.hpp"
+
+namespace cocaine { namespace io {
+
+struct control_tag;
+
+// Session control interface. Control messages are sent in the reserved channel zero and are handled
+// by the sessions themselves, without any dispatch involved.
+
+struct control {
+
+struct ping {
+    typedef control_tag tag;
+
+    static const char* alias() {
+        return "ping";
+    }
+
+    typedef void upstream_type;
+};
+
+struct pong {
+    typedef control_tag tag;
+
+    static const char* alias() {
+        return "pong";
+    }
+
+    typedef void upstream_type;
+};
+
+}; // struct control
+
+template<>
+struct protocol<control_tag> {
+    typedef boost::mpl::int_<
+        1
+    >::type version;
+
+    typedef boost::mpl::list<
+        // Sent to a silent remote peer to check whether it's still alive.
+        control::ping,
+        // Reply to the ping.
+        control::pong
+    >::type messages;
+
+    typedef control scope;
+};
+
+// Advertised by the peer to signal that it replies to pings. Peers which don't advertise it are never
+// pinged, since they would treat channel zero as a protocol violation.
+
+struct heartbeat_header {
+    static
+    hpack::header::data_t
+    name() {
+        return hpack::header::create_data("heartbeat");
+    }
+
+    static
+    hpack::header::data_t
+    value() {
+        return hpack::header::create_data("ping");
+    }
+};
+
+}} // namespace cocaine::io
+
+#endif
@@ -111,6 +111,20 @@ struct cluster {
     >::tag upstream_type;
 };
 
+struct memory {
+    typedef locator_tag tag;
+
+    static const char* alias() {
+        return "memory";
+    }
+
+    typedef option_of<
+     /* Allocated, active and resident bytes for every execution unit and service thread, keyed by
+        the thread name. Empty, unless the runtime is built with jemalloc. */
+        std::map<std::string, std::map<std::string, uint64_t>>
+    >::tag upstream_type;
+};
+
 struct publish_tag;
 
 struct publish {
@@ -186,7 +200,8 @@ struct protocol<locator_tag> {
         locator::refresh,
         locator::cluster,
         locator::publish,
-        locator::routing
+        locator::routing,
+        locator::memory
     >::type messages;
 
     typedef locator scope;
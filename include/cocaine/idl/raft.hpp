@@ -0,0 +1,157 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_RAFT_SERVICE_INTERFACE_HPP
+#define COCAINE_RAFT_SERVICE_INTERFACE_HPP
+
+#include "cocaine/idl/primitive.hpp"
+
+#include "cocaine/rpc/protocol.hpp"
+
+namespace cocaine { namespace io {
+
+struct raft_tag;
+
+// Raft peer interface. Peers call each other directly via the endpoints from their configuration,
+// it's not meant to be used by the clients, which should use the storage service instead.
+
+struct raft {
+
+struct vote {
+    typedef raft_tag tag;
+
+    static const char* alias() {
+        return "vote";
+    }
+
+    typedef boost::mpl::list<
+     /* Candidate's term. */
+        uint64_t,
+     /* Candidate's node ID. */
+        std::string,
+     /* Index and term of the last entry in the candidate's log. */
+        uint64_t,
+        uint64_t
+    >::type argument_type;
+
+    typedef option_of<
+     /* Current term of the voter, for the candidate to update itself. */
+        uint64_t,
+     /* Whether the vote has been granted. */
+        bool
+    >::tag upstream_type;
+};
+
+struct append {
+    typedef raft_tag tag;
+
+    static const char* alias() {
+        return "append";
+    }
+
+    typedef boost::mpl::list<
+     /* Leader's term. */
+        uint64_t,
+     /* Leader's node ID, so that the followers can redirect the proposals. */
+        std::string,
+     /* Index and term of the entry immediately preceding the new ones. */
+        uint64_t,
+        uint64_t,
+     /* Log entries to store as term and command pairs, empty for heartbeats. */
+        std::vector<std::tuple<uint64_t, std::string>>,
+     /* Leader's commit index. */
+        uint64_t
+    >::type argument_type;
+
+    typedef option_of<
+     /* Current term of the follower, for the leader to update itself. */
+        uint64_t,
+     /* Whether the follower's log has matched the preceding entry. */
+        bool,
+     /* Last matching entry index on success, otherwise a hint where to continue from. */
+        uint64_t
+    >::tag upstream_type;
+};
+
+struct install {
+    typedef raft_tag tag;
+
+    static const char* alias() {
+        return "install";
+    }
+
+    typedef boost::mpl::list<
+     /* Leader's term. */
+        uint64_t,
+     /* Leader's node ID. */
+        std::string,
+     /* Index and term of the last entry covered by the snapshot. */
+        uint64_t,
+        uint64_t,
+     /* State machine snapshot. */
+        std::string
+    >::type argument_type;
+
+    typedef option_of<
+     /* Current term of the follower, for the leader to update itself. */
+        uint64_t
+    >::tag upstream_type;
+};
+
+struct propose {
+    typedef raft_tag tag;
+
+    static const char* alias() {
+        return "propose";
+    }
+
+    typedef boost::mpl::list<
+     /* Command forwarded by a follower to the leader. */
+        std::string
+    >::type argument_type;
+
+    typedef option_of<
+     /* Index and term of the log entry, so that the follower can wait for it to be applied. */
+        uint64_t,
+        uint64_t
+    >::tag upstream_type;
+};
+
+}; // struct raft
+
+template<>
+struct protocol<raft_tag> {
+    typedef boost::mpl::int_<
+        1
+    >::type version;
+
+    typedef boost::mpl::list<
+        raft::vote,
+        raft::append,
+        raft::install,
+        raft::propose
+    >::type messages;
+
+    typedef raft scope;
+};
+
+}} // namespace cocaine::io
+
+#endif
@@ -110,6 +110,33 @@ struct find {
     >::tag upstream_type;
 };
 
+struct list {
+    typedef storage_tag tag;
+
+    static const char* alias() {
+        return "list";
+    }
+
+    typedef boost::mpl::list<
+     /* Key namespace. */
+        std::string,
+     /* Only the keys starting with this prefix are listed. */
+        optional<std::string>,
+     /* Listing starts right after this key, which is usually the last key of the previous page.
+        Empty means from the beginning. */
+        optional<std::string>,
+     /* Maximum number of keys to list. Zero means no limit, which is not a good idea for large
+        key namespaces. */
+        optional<uint64_t>
+    >::type argument_type;
+
+    typedef option_of<
+     /* A page of keys in the lexicographical order. The listing is over when the page is shorter
+        than the limit. */
+        std::vector<std::string>
+    >::tag upstream_type;
+};
+
 }; // struct storage
 
 template<>
@@ -122,7 +149,8 @@ struct protocol<storage_tag> {
         storage::read,
         storage::write,
         storage::remove,
-        storage::find
+        storage::find,
+        storage::list
     >::type messages;
 
     typedef storage scope;
@@ -21,6 +21,7 @@
 #ifndef COCAINE_MEMORY_HPP
 #define COCAINE_MEMORY_HPP
 
+#include <cstdint>
 #include <memory>
 
 #ifndef __cpp_lib_make_unique
@@ -37,8 +38,86 @@ make_unique(Args&&... args) {
 
 namespace cocaine { namespace io {
 
+namespace aux {
+
+void*
+pool_allocate(size_t size);
+
+void
+pool_deallocate(void* ptr, size_t size);
+
+} // namespace aux
+
+// Allocation counters of the calling thread's block pool. Blocks served from the pool don't touch
+// the heap, so the difference in heap allocations over a number of requests shows how many of them
+// are still left on the hot path.
+
+struct pool_stats_t {
+    // Allocations served by the heap, either because the pool was empty or the block was too large.
+    uint64_t heap;
+
+    // Allocations served by recycling a previously freed block.
+    uint64_t cached;
+};
+
+pool_stats_t
+pool_stats();
+
+// Recycling allocator for small objects allocated for every message, like upstreams, payloads and
+// encoding buffers. Freed blocks are cached in power of two size classes by the thread which has
+// allocated them and handed out by its next allocation of the same size class, so in a steady state
+// neither reactor nor service threads go to the heap at all. Blocks can be freed by any thread, the
+// ones freed by other threads are given back to the allocating thread through a lock-free list.
+
 template<class T>
-struct uninitialized: public std::allocator<T> {
+struct pooled: public std::allocator<T> {
+    template<class U>
+    struct rebind {
+        typedef pooled<U> other;
+    };
+
+    pooled() = default;
+
+    template<class U>
+    pooled(const pooled<U>&) { }
+
+    T*
+    allocate(size_t n, const void* = nullptr) {
+        return static_cast<T*>(aux::pool_allocate(n * sizeof(T)));
+    }
+
+    void
+    deallocate(T* ptr, size_t n) {
+        aux::pool_deallocate(ptr, n * sizeof(T));
+    }
+
+    // All the instances share the same pool.
+
+    friend
+    bool
+    operator==(const pooled&, const pooled&) {
+        return true;
+    }
+
+    friend
+    bool
+    operator!=(const pooled&, const pooled&) {
+        return false;
+    }
+};
+
+template<class T, class Allocator = std::allocator<T>>
+struct uninitialized: public Allocator {
+    template<class U>
+    struct rebind {
+        typedef uninitialized<U, typename Allocator::template rebind<U>::other> other;
+    };
+
+    uninitialized() = default;
+
+    template<class U, class Other>
+    uninitialized(const uninitialized<U, Other>&) { }
+
     void construct(T*) { }
     void destroy  (T*) { }
 };
@@ -33,6 +33,10 @@
     #if (__GNUC__ == 4 && __GNUC_MINOR__ >= 8) || __GNUC__ >= 5
         #define HAVE_GCC48
     #endif
+
+    #if __GNUC__ >= 5
+        #define HAVE_GCC5
+    #endif
 #endif
 
 #if defined(__clang__) || defined(HAVE_GCC47)
@@ -47,4 +51,8 @@
     #define COCAINE_HAS_FEATURE_PAIR_TO_TUPLE_CONVERSION
 #endif
 
+#if defined(__clang__) || defined(HAVE_GCC5)
+    #define COCAINE_HAS_FEATURE_ATOMIC_SHARED_PTR
+#endif
+
 #endif
@@ -24,6 +24,8 @@
 #include "cocaine/common.hpp"
 #include "cocaine/logging.hpp"
 
+#include <mutex>
+#include <set>
 #include <typeinfo>
 #include <type_traits>
 
@@ -83,44 +85,62 @@ class repository_t {
 
     category_map_t m_categories;
 
+    typedef std::pair<std::string, std::string> component_t;
+
+    // Plugins which are known to provide some components, but haven't been loaded yet. They will be
+    // loaded when one of their components is requested for the first time.
+    std::map<component_t, std::string> m_pending;
+
+    // Components provided by every plugin in the plugin directory, as stored in the plugin cache.
+    std::map<std::string, std::vector<component_t>> m_manifest;
+
+    // Plugins which register some error categories. These are never deferred, because the error
+    // registrar has to see the categories in the same order every time.
+    std::set<std::string> m_registrars;
+
+    // The plugin being loaded at the moment, so that registered components can be attributed to it.
+    std::string m_loading;
+
+    // Plugins might be loaded on demand from any thread.
+    std::mutex m_mutex;
+
 public:
     explicit
     repository_t(std::unique_ptr<logging::log_t> log);
 
    ~repository_t();
 
+    // Loads all the plugins in the directory. If a cache path is specified, plugins listed there are
+    // not loaded until one of their components is requested, and the cache is updated as needed.
     void
-    load(const std::string& path);
+    load(const std::string& path, const std::string& cache = std::string());
 
     template<class Category, class... Args>
     typename category_traits<Category>::ptr_type
-    get(const std::string& name, Args&&... args) const;
+    get(const std::string& name, Args&&... args);
 
     template<class T>
     void
     insert(const std::string& name);
 
 private:
+    auto
+    find(const std::string& id, const std::string& name) -> factory_concept_t&;
+
     void
     open(const std::string& target);
 };
 
 template<class Category, class... Args>
 typename category_traits<Category>::ptr_type
-repository_t::get(const std::string& name, Args&&... args) const {
-    const auto id = typeid(Category).name();
-
-    if(!m_categories.count(id) || !m_categories.at(id).count(name)) {
-        throw std::system_error(error::component_not_found, name);
-    }
-
-    auto it = m_categories.at(id).find(name);
+repository_t::get(const std::string& name, Args&&... args) {
+    auto& factory = find(typeid(Category).name(), name);
 
     // TEST: Ensure that the plugin is of the actually specified category.
-    BOOST_ASSERT(it->second->type_id() == typeid(Category));
+    BOOST_ASSERT(factory.type_id() == typeid(Category));
 
     return dynamic_cast<typename category_traits<Category>::factory_type&>(
-        *it->second
+        factory
     ).get(std::forward<Args>(args)...);
 }
 
@@ -152,6 +172,10 @@ repository_t::insert(const std::string& name) {
     );
 
     m_categories[id][name] = std::make_unique<factory_type>();
+
+    if(!m_loading.empty()) {
+        m_manifest[m_loading].emplace_back(id, name);
+    }
 }
 
 struct preconditions_t {
@@ -48,8 +48,9 @@ class actor_t {
     // allow concurrent observing and operations.
     synchronized<std::unique_ptr<asio::ip::tcp::acceptor>> m_acceptor;
 
-    // Main service thread.
-    std::unique_ptr<io::chamber_t> m_chamber;
+    // Main service thread. Synchronized, because memory usage can be observed while the actor is
+    // being terminated.
+    synchronized<std::unique_ptr<io::chamber_t>> m_chamber;
 
 public:
     actor_t(context_t& context, const std::shared_ptr<asio::io_service>& asio,
@@ -68,9 +69,17 @@ public:
     bool
     is_active() const;
 
+    // Whether the service runs on one of the context's shared executors, not on a thread of its own.
+    bool
+    is_shared() const;
+
     auto
     prototype() const -> const io::basic_dispatch_t&;
 
+    // Allocator statistics of the service thread, if it's running.
+    auto
+    memory_usage() const -> std::map<std::string, uint64_t>;
+
     // Modifiers
 
     void
@@ -0,0 +1,99 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_IO_COMPRESSION_HPP
+#define COCAINE_IO_COMPRESSION_HPP
+
+#include "cocaine/common.hpp"
+
+#include "cocaine/hpack/header.hpp"
+
+#include <system_error>
+#include <vector>
+
+namespace cocaine { namespace io {
+
+// Compressed frames are interleaved with plain msgpack messages on the wire. Each compressed frame
+// is a marker byte, which is never used by msgpack, followed by a 32-bit big-endian payload size and
+// the payload itself, which is a sync-flushed block of a per-direction deflate stream. So the frames
+// share the compression history and repetitive messages compress well even when they are small.
+
+struct compressed_frame {
+    static const unsigned char marker = 0xC1;
+    static const size_t header_size = 5;
+};
+
+// Advertised by the peer to signal that it is able to decode compressed frames.
+
+struct compression_header {
+    static
+    hpack::header::data_t
+    name() {
+        return hpack::header::create_data("compression");
+    }
+
+    static
+    hpack::header::data_t
+    value() {
+        return hpack::header::create_data("deflate");
+    }
+};
+
+class deflater_t {
+    COCAINE_DECLARE_NONCOPYABLE(deflater_t)
+
+    struct stream_t;
+
+    const std::unique_ptr<stream_t> m_stream;
+
+public:
+    deflater_t();
+   ~deflater_t();
+
+    // Compresses the data, appending it to the target.
+    void
+    deflate(const char* data, size_t size, std::vector<char>& target, std::error_code& ec);
+
+    // Completes the current compressed block, so that it can be decoded as a whole by the peer.
+    void
+    flush(std::vector<char>& target, std::error_code& ec);
+};
+
+class inflater_t {
+    COCAINE_DECLARE_NONCOPYABLE(inflater_t)
+
+    struct stream_t;
+
+    const std::unique_ptr<stream_t> m_stream;
+
+public:
+    inflater_t();
+   ~inflater_t();
+
+    // Decompresses a single compressed block, appending it to the target. Fails once the target grows
+    // larger than the limit, so that a small block can't be inflated to an arbitrary size.
+    void
+    inflate(const char* data, size_t size, std::vector<char>& target, size_t limit,
+            std::error_code& ec);
+};
+
+}} // namespace cocaine::io
+
+#endif
@@ -26,10 +26,14 @@
 #include "cocaine/hpack/header.hpp"
 #include "cocaine/hpack/msgpack_traits.hpp"
 
+#include "cocaine/rpc/asio/frame.hpp"
+
 #include "cocaine/traits.hpp"
 
 #include <boost/range/algorithm/find_if.hpp>
 
+#include <limits>
+
 namespace cocaine { namespace io {
 
 struct decoder_t;
@@ -41,17 +45,17 @@ struct decoded_message_t {
 
     auto
     span() const -> uint64_t {
-        return object.via.array.ptr[0].as<uint64_t>();
+        return span_id;
     }
 
     auto
     type() const -> uint64_t {
-        return object.via.array.ptr[1].as<uint64_t>();
+        return type_id;
     }
 
     auto
     args() const -> const msgpack::object& {
-        return object.via.array.ptr[2];
+        return arguments;
     }
 
     template<class Header>
@@ -70,8 +74,11 @@ struct decoded_message_t {
     }
 
 private:
+    uint64_t span_id;
+    uint64_t type_id;
+
     // These objects keep references to message buffer in the Decoder.
-    msgpack::object object;
+    msgpack::object arguments;
     std::vector<hpack::header_t> metadata;
 };
 
@@ -80,7 +87,11 @@ private:
 struct decoder_t {
     COCAINE_DECLARE_NONCOPYABLE(decoder_t)
 
-    decoder_t() = default;
+    decoder_t():
+        frame_version(1),
+        frame_limit(std::numeric_limits<size_t>::max())
+    { }
+
    ~decoder_t() = default;
 
     typedef aux::decoded_message_t message_type;
@@ -89,30 +100,100 @@ struct decoder_t {
     decode(const char* data, size_t size, message_type& message, std::error_code& ec) {
         size_t offset = 0;
 
+        if(size && static_cast<unsigned char>(data[0]) == frame_v2::marker) {
+            if(size < frame_v2::preamble_size) {
+                ec = error::insufficient_bytes;
+                return 0;
+            }
+
+            if(static_cast<unsigned char>(data[1]) != frame_v2::version) {
+                ec = error::frame_format_error;
+                return 0;
+            }
+
+            // NOTE: The preamble is only consumed along with the following message, so it is seen
+            // again if that message is incomplete. Switching the version is idempotent, though.
+            frame_version = frame_v2::version;
+            offset = frame_v2::preamble_size;
+        }
+
         // NOTE: We have to clear msgpack zone every decoding iteration to prevent memory leaking
         // for objects structure, because they have no way to notify about self-destruction. Hope
         // someday we migrate to v1.* and everything will be fine automatically.
         zone.clear();
 
-        msgpack::unpack_return rv = msgpack::unpack(data, size, &offset, &zone, &message.object);
+        const size_t bytes_decoded = frame_version == frame_v2::version ?
+            decode_v2(data + offset, size - offset, message, ec) :
+            decode_v1(data + offset, size - offset, message, ec);
+
+        return ec ? 0 : offset + bytes_decoded;
+    }
+
+    // Returns the total size of the frame at the start of the given data, if it can be told without
+    // parsing and the frame fits the limit, or zero otherwise.
+    size_t
+    frame_size(const char* data, size_t size) const {
+        size_t offset = 0;
+
+        if(size && static_cast<unsigned char>(data[0]) == frame_v2::marker) {
+            offset = frame_v2::preamble_size;
+        } else if(frame_version != frame_v2::version) {
+            return 0;
+        }
+
+        if(size < offset + frame_v2::header_size) {
+            return 0;
+        }
+
+        const size_t frame_size = frame_v2::header_size + frame_v2::load<uint32_t>(
+            reinterpret_cast<const unsigned char*>(data + offset));
+
+        return frame_size <= frame_limit ? offset + frame_size : 0;
+    }
+
+    // Sets the maximum size of version 2 frames, not counting the preamble. Larger frames are rejected
+    // as soon as their header is decoded.
+    void
+    limit(size_t size) {
+        frame_limit = size;
+    }
+
+    unsigned int
+    version() const {
+        return frame_version;
+    }
+
+private:
+    size_t
+    decode_v1(const char* data, size_t size, message_type& message, std::error_code& ec) {
+        size_t offset = 0;
+
+        msgpack::object object;
+        msgpack::unpack_return rv = msgpack::unpack(data, size, &offset, &zone, &object);
 
         if(rv == msgpack::UNPACK_SUCCESS || rv == msgpack::UNPACK_EXTRA_BYTES) {
-            if(message.object.type != msgpack::type::ARRAY || message.object.via.array.size < 3) {
+            if(object.type != msgpack::type::ARRAY || object.via.array.size < 3) {
                 ec = error::frame_format_error;
-            } else if(message.object.via.array.ptr[0].type != msgpack::type::POSITIVE_INTEGER ||
-                      message.object.via.array.ptr[1].type != msgpack::type::POSITIVE_INTEGER ||
-                      message.object.via.array.ptr[2].type != msgpack::type::ARRAY)
+            } else if(object.via.array.ptr[0].type != msgpack::type::POSITIVE_INTEGER ||
+                      object.via.array.ptr[1].type != msgpack::type::POSITIVE_INTEGER ||
+                      object.via.array.ptr[2].type != msgpack::type::ARRAY)
             {
                 ec = error::frame_format_error;
-            } else if(message.object.via.array.size > 3) {
-                if(message.object.via.array.ptr[3].type != msgpack::type::ARRAY) {
+            } else if(object.via.array.size > 3) {
+                if(object.via.array.ptr[3].type != msgpack::type::ARRAY) {
                     ec = error::frame_format_error;
                 } else if(!hpack::msgpack_traits::unpack_vector(
-                          message.object.via.array.ptr[3], hpack_context, message.metadata))
+                          object.via.array.ptr[3], hpack_context, message.metadata))
                 {
                     ec = error::hpack_error;
                 }
             }
+
+            if(!ec) {
+                message.span_id   = object.via.array.ptr[0].via.u64;
+                message.type_id   = object.via.array.ptr[1].via.u64;
+                message.arguments = object.via.array.ptr[2];
+            }
         } else if(rv == msgpack::UNPACK_CONTINUE) {
             ec = error::insufficient_bytes;
         } else if(rv == msgpack::UNPACK_PARSE_ERROR) {
@@ -122,9 +203,82 @@ struct decoder_t {
         return offset;
     }
 
-private:
+    size_t
+    decode_v2(const char* data, size_t size, message_type& message, std::error_code& ec) {
+        if(size < frame_v2::header_size) {
+            ec = error::insufficient_bytes;
+            return 0;
+        }
+
+        const auto* header = reinterpret_cast<const unsigned char*>(data);
+
+        const size_t body_size = frame_v2::load<uint32_t>(header);
+
+        if(body_size > frame_v2::max_body_size || frame_v2::header_size + body_size > frame_limit) {
+            ec = error::frame_format_error;
+            return 0;
+        }
+
+        if(size - frame_v2::header_size < body_size) {
+            ec = error::insufficient_bytes;
+            return 0;
+        }
+
+        const char* body = data + frame_v2::header_size;
+        size_t offset = 0;
+
+        msgpack::unpack_return rv = msgpack::unpack(body, body_size, &offset, &zone, &message.arguments);
+
+        if(rv != msgpack::UNPACK_SUCCESS && rv != msgpack::UNPACK_EXTRA_BYTES) {
+            // The frame is complete, so a truncated body is malformed as well.
+            ec = rv == msgpack::UNPACK_PARSE_ERROR ? error::parse_error : error::frame_format_error;
+            return 0;
+        }
+
+        if(message.arguments.type != msgpack::type::ARRAY) {
+            ec = error::frame_format_error;
+            return 0;
+        }
+
+        const size_t metadata_size = frame_v2::load<uint16_t>(header + 16);
+
+        message.metadata.reserve(metadata_size);
+
+        for(size_t i = 0; i < metadata_size; ++i) {
+            msgpack::object object;
+
+            rv = msgpack::unpack(body, body_size, &offset, &zone, &object);
+
+            if(rv != msgpack::UNPACK_SUCCESS && rv != msgpack::UNPACK_EXTRA_BYTES) {
+                ec = rv == msgpack::UNPACK_PARSE_ERROR ? error::parse_error : error::frame_format_error;
+                return 0;
+            }
+
+            if(!hpack::msgpack_traits::unpack_entry(object, hpack_context, message.metadata)) {
+                ec = error::hpack_error;
+                return 0;
+            }
+        }
+
+        if(offset != body_size) {
+            ec = error::frame_format_error;
+            return 0;
+        }
+
+        message.span_id = frame_v2::load<uint64_t>(header + 4);
+        message.type_id = frame_v2::load<uint32_t>(header + 12);
+
+        return frame_v2::header_size + body_size;
+    }
+
     msgpack::zone zone;
 
+    // Frame format version, switched to version 2 once the remote peer sends the preamble.
+    unsigned int frame_version;
+
+    // Maximum size of version 2 frames.
+    size_t frame_limit;
+
     // HPACK HTTP/2.0 tables.
     hpack::header_table_t hpack_context;
 };
@@ -26,6 +26,8 @@
 #include "cocaine/hpack/header.hpp"
 #include "cocaine/hpack/msgpack_traits.hpp"
 
+#include "cocaine/rpc/asio/frame.hpp"
+
 #include "cocaine/rpc/protocol.hpp"
 
 #include "cocaine/trace/trace.hpp"
@@ -33,7 +35,14 @@
 #include "cocaine/traits.hpp"
 #include "cocaine/traits/tuple.hpp"
 
+#include <algorithm>
 #include <cstring>
+#include <memory>
+#include <tuple>
+
+#include <asio/buffer.hpp>
+
+#include <boost/optional.hpp>
 
 namespace cocaine { namespace io {
 
@@ -46,19 +55,42 @@ namespace aux {
 
 struct encoded_buffers_t {
     friend struct encoded_message_t;
+    friend struct io::encoder_t;
 
     static const size_t kInitialBufferSize = 2048;
 
+    // Writes at least this large, sourced from memory exposed by the message payload, are referenced
+    // in place instead of being copied into the buffer.
+    static const size_t kMinReferenceSize = 4096;
+
     encoded_buffers_t():
         offset(0)
     {
         vector.resize(kInitialBufferSize);
     }
 
+    explicit
+    encoded_buffers_t(size_t capacity):
+        offset(0)
+    {
+        vector.resize(capacity);
+    }
+
+    void
+    reserve(size_t capacity) {
+        if(capacity > vector.size()) {
+            vector.resize(capacity);
+        }
+    }
+
     void
     write(const char* data, size_t size) {
-        while(size > vector.size() - offset) {
-            vector.resize(vector.size() * 2);
+        if(size >= kMinReferenceSize && exposed(data, size)) {
+            return references.push_back(reference_t{offset, data, size});
+        }
+
+        if(size > vector.size() - offset) {
+            vector.resize(std::max(vector.size() * 2, offset + size));
         }
 
         std::memcpy(vector.data() + offset, data, size);
@@ -66,6 +98,26 @@ struct encoded_buffers_t {
         offset += size;
     }
 
+    // Marks the memory of a payload argument as safe to reference until the message is written. Only
+    // top-level string arguments are exposed, which covers large replies like storage reads.
+
+    size_t
+    expose(const std::string& source) {
+        if(source.size() < kMinReferenceSize) {
+            return 0;
+        }
+
+        regions.emplace_back(source.data(), source.size());
+
+        return source.size();
+    }
+
+    template<class T>
+    size_t
+    expose(const T&) {
+        return 0;
+    }
+
     // Movable
 
     encoded_buffers_t(encoded_buffers_t&&) = default;
@@ -76,34 +128,102 @@ struct encoded_buffers_t {
     COCAINE_DECLARE_NONCOPYABLE(encoded_buffers_t)
 
 private:
-    std::vector<char, uninitialized<char>> vector;
-    std::vector<char, uninitialized<char>>::size_type offset;
+    bool
+    exposed(const char* data, size_t size) const {
+        for(auto it = regions.begin(); it != regions.end(); ++it) {
+            if(data >= it->first && data + size <= it->first + it->second) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    struct reference_t {
+        // Offset in the buffer, at which the referenced block is spliced in.
+        size_t position;
+
+        const char* data;
+        size_t size;
+    };
+
+    typedef std::vector<char, uninitialized<char, pooled<char>>> vector_type;
+
+    vector_type vector;
+    vector_type::size_type offset;
+
+    std::vector<std::pair<const char*, size_t>> regions;
+    std::vector<reference_t> references;
 };
 
 struct encoded_message_t {
     friend struct io::encoder_t;
 
-    auto
-    data() const -> const char* {
-        return buffer.vector.data();
+    encoded_message_t() = default;
+
+    explicit
+    encoded_message_t(size_t capacity):
+        buffer(capacity)
+    { }
+
+    // Emits the message as a sequence of buffers: the packed data, interleaved with the payload blocks
+    // it references. The buffers stay valid for as long as this message object is alive.
+    template<class OutputIterator>
+    OutputIterator
+    buffers(OutputIterator it) const {
+        const char* data = buffer.vector.data();
+        size_t position = 0;
+
+        for(auto ref = buffer.references.begin(); ref != buffer.references.end(); ++ref) {
+            if(ref->position > position) {
+                *it++ = asio::const_buffer(data + position, ref->position - position);
+            }
+
+            *it++ = asio::const_buffer(ref->data, ref->size);
+
+            position = ref->position;
+        }
+
+        if(buffer.offset > position) {
+            *it++ = asio::const_buffer(data + position, buffer.offset - position);
+        }
+
+        return it;
     }
 
     size_t
     size() const {
-        return buffer.offset;
+        size_t size = buffer.offset;
+
+        for(auto ref = buffer.references.begin(); ref != buffer.references.end(); ++ref) {
+            size += ref->size;
+        }
+
+        return size;
     }
 
 private:
     encoded_buffers_t buffer;
+
+    // Keeps the referenced payload blocks alive.
+    std::shared_ptr<const void> payload;
 };
 
 struct unbound_message_t {
-    typedef std::function<aux::encoded_message_t(encoder_t&)> function_type;
+    typedef aux::encoded_message_t (*function_type)(encoder_t&, uint64_t, const std::shared_ptr<const void>&);
 
-    // Partially applied message encoding function.
+    // Message encoding function along with its arguments. It is spelled out instead of being bound
+    // into a std::function, which would have to allocate for every message.
     const function_type bind;
 
-    unbound_message_t(function_type&& bind_): bind(std::move(bind_)) { }
+    const uint64_t channel_id;
+    const std::shared_ptr<const void> payload;
+
+    unbound_message_t(function_type bind_, uint64_t channel_id_, std::shared_ptr<const void>&& payload_):
+        bind(bind_),
+        channel_id(channel_id_),
+        payload(std::move(payload_))
+    { }
 };
 
 } // namespace aux
@@ -111,7 +231,11 @@ struct unbound_message_t {
 struct encoder_t {
     COCAINE_DECLARE_NONCOPYABLE(encoder_t)
 
-    encoder_t() = default;
+    encoder_t():
+        frame_version(1),
+        preamble(false)
+    { }
+
    ~encoder_t() = default;
 
     typedef aux::unbound_message_t message_type;
@@ -120,46 +244,200 @@ struct encoder_t {
     template<class Event, class... Args>
     static inline
     aux::encoded_message_t
-    tether(encoder_t& encoder, uint64_t channel_id, Args&... args) {
-        aux::encoded_message_t message;
+    tether(encoder_t& encoder, uint64_t channel_id, const std::shared_ptr<const void>& payload) {
+        return tether_impl<Event>(encoder, channel_id, *static_cast<const std::tuple<Args...>*>(payload.get()),
+            payload, typename make_index_sequence<sizeof...(Args)>::type());
+    }
 
-        msgpack::packer<aux::encoded_buffers_t> packer(message.buffer);
+    aux::encoded_message_t
+    encode(const message_type& message) {
+        return message.bind(*this, message.channel_id, message.payload);
+    }
 
-        packer.pack_array(4);
+    // Schedules a HPACK dynamic table size update, which is applied and sent to the remote peer along
+    // with the next encoded message.
+    void
+    resize_table(size_t capacity) {
+        if(capacity > hpack::header_table_t::max_data_capacity) {
+            throw std::system_error(std::make_error_code(std::errc::invalid_argument),
+                "header table capacity exceeds the maximum allowed");
+        }
 
-        // Channel ID & Message ID
+        hpack_capacity = capacity;
+    }
 
-        packer.pack(channel_id);
-        packer.pack(static_cast<uint64_t>(event_traits<Event>::id));
+    // Schedules a header to be sent to the remote peer along with the next encoded message. Header
+    // data must stay valid until then. Such headers are sent as literals, without being indexed.
+    void
+    push_header(const hpack::header_t& header) {
+        hpack_headers.push_back(header);
+    }
 
-        // Message arguments
+    // Switches to version 2 frames. The next encoded message is preceded by the preamble, which tells
+    // the remote peer about the switch.
+    void
+    upgrade() {
+        if(frame_version != frame_v2::version) {
+            frame_version = frame_v2::version;
+            preamble = true;
+        }
+    }
 
-        type_traits<typename event_traits<Event>::argument_type>::pack(packer,
-            std::forward<Args>(args)...);
+    unsigned int
+    version() const {
+        return frame_version;
+    }
 
-        // Optional message metadata
+private:
+    template<class Event, class... Args, size_t... Indices>
+    static inline
+    aux::encoded_message_t
+    tether_impl(encoder_t& encoder, uint64_t channel_id, const std::tuple<Args...>& args,
+                const std::shared_ptr<const void>& payload, index_sequence<Indices...>)
+    {
+        typedef type_traits<typename event_traits<Event>::argument_type> traits;
 
-        packer.pack_array(3);
+        const uint64_t message_id = event_traits<Event>::id;
 
         uint64_t trace_id  = trace_t::current().get_trace_id();
         uint64_t span_id   = trace_t::current().get_id();
         uint64_t parent_id = trace_t::current().get_parent_id();
 
-        hpack::msgpack_traits::pack<hpack::headers::trace_id<>>(packer, encoder.hpack_context, hpack::header::create_data(trace_id));
-        hpack::msgpack_traits::pack<hpack::headers::span_id<>>(packer, encoder.hpack_context, hpack::header::create_data(span_id));
-        hpack::msgpack_traits::pack<hpack::headers::parent_id<>>(packer, encoder.hpack_context, hpack::header::create_data(parent_id));
+        const auto trace_data  = hpack::header::create_data(trace_id);
+        const auto span_data   = hpack::header::create_data(span_id);
+        const auto parent_data = hpack::header::create_data(parent_id);
+
+        const size_t metadata_size = 3 + (encoder.hpack_capacity ? 1 : 0) + encoder.hpack_headers.size();
+
+        const bool compact = encoder.frame_version == frame_v2::version;
+
+        // NOTE: The exact encoded message size is computed first, so that the buffer is allocated
+        // only once, without any reallocations and copying during packing.
+        size_t size = (compact ?
+                (encoder.preamble ? frame_v2::preamble_size : 0) + frame_v2::header_size :
+                1 + packed_size<uint64_t>(channel_id) + packed_size<uint64_t>(message_id) + 1)
+            + traits::size(std::get<Indices>(args)...)
+            + (encoder.hpack_capacity ? hpack::msgpack_traits::size_capacity() : 0)
+            + encoder.headers_size()
+            + hpack::msgpack_traits::size<hpack::headers::trace_id<>>(encoder.hpack_context, trace_data)
+            + hpack::msgpack_traits::size<hpack::headers::span_id<>>(encoder.hpack_context, span_data)
+            + hpack::msgpack_traits::size<hpack::headers::parent_id<>>(encoder.hpack_context, parent_data);
+
+        if(compact) {
+            const size_t body_size = size - frame_v2::header_size -
+                (encoder.preamble ? frame_v2::preamble_size : 0);
+
+            // NOTE: Checked before the encoder state is touched, so that the pending headers and the
+            // HPACK table stay intact for the following messages if this one doesn't fit.
+            if(body_size > frame_v2::max_body_size || metadata_size > 0xFFFF ||
+               message_id > 0xFFFFFFFF)
+            {
+                throw std::system_error(error::make_error_code(error::frame_format_error),
+                    "message doesn't fit into a frame");
+            }
+        }
+
+        aux::encoded_message_t message(0);
+
+        // NOTE: Large arguments are not copied into the buffer, but referenced by the message, which
+        // shares the payload ownership, so the buffer only has to fit everything else.
+        const size_t exposed[] = { 0, message.buffer.expose(std::get<Indices>(args))... };
+
+        for(size_t i = 1; i < sizeof(exposed) / sizeof(exposed[0]); ++i) {
+            size -= exposed[i];
+        }
+
+        message.buffer.reserve(size);
+        message.payload = payload;
+
+        msgpack::packer<aux::encoded_buffers_t> packer(message.buffer);
+
+        size_t header_offset = 0;
+
+        if(compact) {
+            if(encoder.preamble) {
+                const char preamble[] = { static_cast<char>(frame_v2::marker), frame_v2::version };
+
+                message.buffer.write(preamble, frame_v2::preamble_size);
+                encoder.preamble = false;
+            }
+
+            // The fixed header is filled in once the body size is known.
+            const char header[frame_v2::header_size] = {};
+
+            header_offset = message.buffer.offset;
+            message.buffer.write(header, frame_v2::header_size);
+        } else {
+            packer.pack_array(4);
+
+            // Channel ID & Message ID
+
+            packer.pack(channel_id);
+            packer.pack(message_id);
+        }
+
+        // Message arguments
+
+        traits::pack(packer, std::get<Indices>(args)...);
+
+        // Optional message metadata
+
+        if(!compact) {
+            packer.pack_array(metadata_size);
+        }
+
+        if(encoder.hpack_capacity) {
+            hpack::msgpack_traits::pack_capacity(packer, encoder.hpack_context, *encoder.hpack_capacity);
+            encoder.hpack_capacity.reset();
+        }
+
+        for(auto it = encoder.hpack_headers.begin(); it != encoder.hpack_headers.end(); ++it) {
+            hpack::msgpack_traits::pack_literal(packer, *it);
+        }
+
+        encoder.hpack_headers.clear();
+
+        hpack::msgpack_traits::pack<hpack::headers::trace_id<>>(packer, encoder.hpack_context, trace_data);
+        hpack::msgpack_traits::pack<hpack::headers::span_id<>>(packer, encoder.hpack_context, span_data);
+        hpack::msgpack_traits::pack<hpack::headers::parent_id<>>(packer, encoder.hpack_context, parent_data);
+
+        if(compact) {
+            const size_t body_size = message.size() - header_offset - frame_v2::header_size;
+
+            auto* header = reinterpret_cast<unsigned char*>(message.buffer.vector.data() + header_offset);
+
+            frame_v2::store<uint32_t>(header, body_size);
+            frame_v2::store<uint64_t>(header + 4, channel_id);
+            frame_v2::store<uint32_t>(header + 12, message_id);
+            frame_v2::store<uint16_t>(header + 16, metadata_size);
+        }
 
         return message;
     }
 
-    aux::encoded_message_t
-    encode(const message_type& message) {
-        return message.bind(*this);
+    size_t
+    headers_size() const {
+        size_t size = 0;
+
+        for(auto it = hpack_headers.begin(); it != hpack_headers.end(); ++it) {
+            size += hpack::msgpack_traits::size_literal(*it);
+        }
+
+        return size;
     }
 
-private:
     // HPACK HTTP/2.0 tables.
     hpack::header_table_t hpack_context;
+
+    // Pending dynamic table size update, if any.
+    boost::optional<size_t> hpack_capacity;
+
+    // Pending extra headers.
+    std::vector<hpack::header_t> hpack_headers;
+
+    // Outgoing frame format version, and whether the switch to it is yet to be announced.
+    unsigned int frame_version;
+    bool preamble;
 };
 
 template<class Event>
@@ -168,11 +446,22 @@ struct encoded:
 {
     template<class... Args>
     encoded(uint64_t channel_id, Args&&... args): unbound_message_t(
-        std::bind(&encoder_t::tether<Event, typename std::decay<Args>::type...>,
-            std::placeholders::_1,
-            channel_id,
-            std::forward<Args>(args)...))
+        &encoder_t::tether<Event, typename std::decay<Args>::type...>,
+        channel_id,
+        share(std::forward<Args>(args)...))
     { }
+
+private:
+    // NOTE: Arguments are shared with the encoded message instead of being copied into it, so that
+    // large blocks can be written directly from the payload.
+    template<class... Args>
+    static
+    std::shared_ptr<const void>
+    share(Args&&... args) {
+        typedef std::tuple<typename std::decay<Args>::type...> tuple_type;
+
+        return std::allocate_shared<tuple_type>(pooled<tuple_type>(), std::forward<Args>(args)...);
+    }
 };
 
 }} // namespace cocaine::io
@@ -0,0 +1,78 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_IO_FRAME_HPP
+#define COCAINE_IO_FRAME_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cocaine { namespace io {
+
+// Version 1 frames are msgpack arrays of [span, type, [args...], [headers...]]. Version 2 frames have
+// a fixed binary header, so that frame boundaries are known without parsing:
+//
+//   uint32 body size, uint64 span, uint32 type, uint16 header count
+//
+// All integers are in network byte order. The body consists of a msgpack array of arguments followed
+// by the given number of msgpack-encoded HPACK entries.
+//
+// Each direction of a connection starts with version 1 frames and switches to version 2 once the
+// sender emits the preamble, a marker byte no msgpack message can start with followed by the version
+// number. A peer which receives the preamble replies with its own one, so that connections with peers
+// that don't know about version 2 frames stay on version 1 in both directions.
+
+struct frame_v2 {
+    static const unsigned char marker  = 0xC4;
+    static const unsigned char version = 2;
+
+    static const size_t preamble_size = 2;
+    static const size_t header_size   = 18;
+
+    // Body size limit, also makes preamble bytes unambiguous at frame boundaries.
+    static const size_t max_body_size = 0x7FFFFFFF;
+
+    template<class T>
+    static
+    void
+    store(unsigned char* target, T value) {
+        for(size_t i = sizeof(T); i > 0; --i) {
+            target[i - 1] = static_cast<unsigned char>(value & 0xFF);
+            value >>= 8;
+        }
+    }
+
+    template<class T>
+    static
+    T
+    load(const unsigned char* source) {
+        T value = 0;
+
+        for(size_t i = 0; i < sizeof(T); ++i) {
+            value = static_cast<T>(value << 8) | source[i];
+        }
+
+        return value;
+    }
+};
+
+}} // namespace cocaine::io
+
+#endif
@@ -23,12 +23,16 @@
 
 #include "cocaine/errors.hpp"
 
+#include "cocaine/rpc/asio/compression.hpp"
+
 #include <functional>
 
 #include <asio/io_service.hpp>
 #include <asio/basic_stream_socket.hpp>
 
+#include <algorithm>
 #include <cstring>
+#include <limits>
 
 namespace cocaine { namespace io {
 
@@ -45,7 +49,7 @@ class readable_stream:
     typedef Decoder decoder_type;
     typedef typename decoder_type::message_type message_type;
 
-    const std::shared_ptr<socket_type> m_socket;
+    std::shared_ptr<socket_type> m_socket;
 
     typedef std::function<void(const std::error_code&)> handler_type;
 
@@ -54,29 +58,122 @@ class readable_stream:
 
     decoder_type m_decoder;
 
+    // Decompressed messages from the last compressed frame. Created on the first compressed frame.
+    std::unique_ptr<inflater_t> m_inflater;
+    std::vector<char> m_plain;
+    std::vector<char>::size_type m_plain_offset;
+
+    struct quantum_t {
+        size_t messages;
+        size_t bytes;
+    };
+
+    // Deficit round-robin over the sessions of the same reactor. Every stream has at most one turn
+    // queued in the reactor at a time, so the reactor's queue is the round-robin list. Each turn adds
+    // the byte quantum to the stream's deficit, and messages are handled while the deficit covers
+    // their size, up to the message quantum per turn. A message larger than the deficit waits for as
+    // many turns as it needs, so sessions get the reactor in proportion to bytes, not messages. The
+    // deficit is reset once the stream runs out of buffered data, so idle sessions can't save it up.
+    quantum_t m_quantum;
+
+    // Messages left for the current turn and the byte deficit.
+    quantum_t m_budget;
+
+    // Maximum size of compressed and version 2 frames, and of the messages a compressed frame inflates
+    // to. These frames tell their size upfront, so larger ones are rejected before the stream buffers
+    // them. Plain version 1 frames are only buffered as they arrive, and aren't limited.
+    size_t m_limit;
+
+    // Compressed frames are only accepted once this side has advertised that it can decode them.
+    bool m_compressed;
+
+    // Whether the pending read has been aborted by cancel(), as opposed to the socket being closed.
+    bool m_cancelled;
+
 public:
     explicit
     readable_stream(const std::shared_ptr<socket_type>& socket):
-        m_socket(socket)
+        m_socket(socket),
+        m_quantum({1, std::numeric_limits<size_t>::max()}),
+        m_budget({0, 0}),
+        m_limit(std::numeric_limits<size_t>::max()),
+        m_compressed(false),
+        m_cancelled(false)
     {
         m_ring.resize(kInitialBufferSize);
-        m_rd_offset = m_rx_offset = 0;
+        m_rd_offset = m_rx_offset = m_plain_offset = 0;
     }
 
     void
     read(message_type& message, handler_type handle) {
         std::error_code ec;
 
-        const size_t
-            bytes_pending = m_rd_offset - m_rx_offset,
-            bytes_decoded = m_decoder.decode(m_ring.data() + m_rx_offset, bytes_pending, message, ec);
+        m_cancelled = false;
+
+        if(m_plain_offset != m_plain.size()) {
+            const size_t offset = m_plain_offset;
 
-        if(ec != error::insufficient_bytes) {
-            if(!ec) {
-                m_rx_offset += bytes_decoded;
+            // Compressed frames always contain whole messages, so there's no need to wait for more.
+            m_plain_offset += m_decoder.decode(m_plain.data() + m_plain_offset,
+                m_plain.size() - m_plain_offset, message, ec);
+
+            if(ec == error::insufficient_bytes) {
+                ec = error::compression_error;
             }
 
-            return m_socket->get_io_service().post(std::bind(handle, ec));
+            return complete(handle, ec, m_plain_offset - offset);
+        }
+
+        const size_t bytes_pending = m_rd_offset - m_rx_offset;
+
+        if(bytes_pending && static_cast<unsigned char>(m_ring[m_rx_offset]) == compressed_frame::marker) {
+            const size_t bytes_required = frame_size(bytes_pending);
+
+            if(!m_compressed || bytes_required - compressed_frame::header_size > m_limit) {
+                ec = error::frame_format_error;
+                return m_socket->get_io_service().post(std::bind(handle, ec));
+            }
+
+            if(bytes_required <= bytes_pending) {
+                inflate(m_ring.data() + m_rx_offset + compressed_frame::header_size,
+                    bytes_required - compressed_frame::header_size, ec);
+
+                if(ec) {
+                    return m_socket->get_io_service().post(std::bind(handle, ec));
+                }
+
+                m_rx_offset += bytes_required;
+
+                return read(message, handle);
+            }
+
+            while(m_ring.size() < bytes_required) {
+                // The ring is going to be compacted below, so the whole frame will fit.
+                m_ring.resize(m_ring.size() * 2);
+            }
+        } else {
+            const size_t bytes_decoded = m_decoder.decode(m_ring.data() + m_rx_offset, bytes_pending,
+                message, ec);
+
+            if(ec != error::insufficient_bytes) {
+                if(!ec) {
+                    m_rx_offset += bytes_decoded;
+                }
+
+                return complete(handle, ec, bytes_decoded);
+            }
+
+            // Version 2 frames tell their size upfront, so the ring can be grown to fit the whole frame
+            // before reading the rest of it.
+            const size_t bytes_required = m_decoder.frame_size(m_ring.data() + m_rx_offset, bytes_pending);
+
+            while(m_ring.size() < bytes_required) {
+                m_ring.resize(m_ring.size() * 2);
+            }
+        }
+
+        if(!bytes_pending) {
+            m_budget.bytes = 0;
         }
 
         if(m_rx_offset) {
@@ -103,14 +200,131 @@ public:
 
     auto
     pressure() const -> size_t {
-        return m_ring.size();
+        return m_ring.size() + m_plain.capacity();
+    }
+
+    // Sets the maximum number of messages handled per turn of the reactor's event loop, and the number
+    // of bytes added to the stream's deficit every turn.
+    void
+    schedule(size_t messages, size_t bytes) {
+        m_quantum = {messages, bytes};
+    }
+
+    // Sets the maximum size of incoming compressed and version 2 frames, and of the messages a
+    // compressed frame inflates to.
+    void
+    limit(size_t size) {
+        m_limit = size;
+        m_decoder.limit(size);
+    }
+
+    // Starts accepting compressed frames, which must be advertised to the remote peer beforehand.
+    void
+    decompress() {
+        m_compressed = true;
+    }
+
+    // Aborts the pending read, if any, keeping all the buffered data. Its handler is invoked with the
+    // operation_aborted error, unlike when the socket is closed, so that it can resume reading, e.g.
+    // after the stream is moved to another socket. NOTE: Pending writes on the socket are aborted as
+    // well.
+    void
+    cancel() {
+        std::error_code ec;
+
+        m_cancelled = true;
+        m_socket->cancel(ec);
+    }
+
+    // Moves the stream to another socket sharing the same connection, keeping all the buffered data
+    // and the decoder state. NOTE: Must be called between reads, i.e. not while a read is pending.
+    void
+    rebind(const std::shared_ptr<socket_type>& socket) {
+        m_socket = socket;
+    }
+
+    // Frame format version used by the remote peer.
+    auto
+    version() const -> unsigned int {
+        return m_decoder.version();
     }
 
 private:
+    void
+    complete(const handler_type& handle, const std::error_code& ec, size_t size) {
+        if(ec) {
+            return m_socket->get_io_service().post(std::bind(handle, ec));
+        }
+
+        if(m_budget.messages && m_budget.bytes >= size) {
+            m_budget.messages--;
+            m_budget.bytes -= size;
+
+            // NOTE: Handled right away, without a round trip through the reactor queue. The depth of
+            // the resulting recursion is bounded by the message quantum.
+            return handle(ec);
+        }
+
+        if(m_budget.bytes >= size) {
+            // Out of messages for this turn. The deficit left isn't carried over, otherwise a session
+            // sending small messages would pile it up turn after turn.
+            m_budget.bytes = 0;
+        }
+
+        // Yield to other sessions. The message is handled in one of the next turns, once the deficit
+        // covers its size.
+        m_socket->get_io_service().post(std::bind(&readable_stream::resume,
+            this->shared_from_this(),
+            handle,
+            size
+        ));
+    }
+
+    void
+    resume(const handler_type& handle, size_t size) {
+        refill();
+        complete(handle, std::error_code(), size);
+    }
+
+    void
+    refill() {
+        const size_t headroom = std::numeric_limits<size_t>::max() - m_budget.bytes;
+
+        m_budget.messages = m_quantum.messages;
+        m_budget.bytes += std::min(m_quantum.bytes, headroom);
+    }
+
+    auto
+    frame_size(size_t bytes_pending) const -> size_t {
+        if(bytes_pending < compressed_frame::header_size) {
+            return compressed_frame::header_size;
+        }
+
+        const auto* header = reinterpret_cast<const unsigned char*>(m_ring.data() + m_rx_offset);
+
+        return compressed_frame::header_size + (
+            static_cast<size_t>(header[1]) << 24 |
+            static_cast<size_t>(header[2]) << 16 |
+            static_cast<size_t>(header[3]) << 8  |
+            static_cast<size_t>(header[4]));
+    }
+
+    void
+    inflate(const char* data, size_t size, std::error_code& ec) {
+        if(!m_inflater) {
+            m_inflater.reset(new inflater_t());
+        }
+
+        m_plain.clear();
+        m_plain_offset = 0;
+
+        m_inflater->inflate(data, size, m_plain, m_limit, ec);
+    }
+
     void
     fill(message_type& message, handler_type handle, const std::error_code& ec, size_t bytes_read) {
         if(ec) {
-            if(ec == asio::error::operation_aborted) {
+            if(ec == asio::error::operation_aborted && !m_cancelled) {
                 return;
             }
 
@@ -119,6 +333,9 @@ private:
 
         m_rd_offset += bytes_read;
 
+        // Completion handlers are invoked by the reactor, so this is a new turn.
+        refill();
+
         read(std::ref(message), handle);
     }
 };
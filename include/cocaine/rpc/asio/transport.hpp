@@ -55,6 +55,20 @@ struct transport {
         // The socket is already in non-blocking mode.
     }
 
+    // Migration constructor, which moves the streams of another transport to a new socket sharing
+    // the same connection, so that buffered data, header tables and compression state are kept.
+    // NOTE: The other transport's socket must be closed instead of shut down afterwards.
+    transport(std::unique_ptr<socket_type> socket_, const transport& other):
+        socket(std::move(socket_)),
+        reader(other.reader),
+        writer(other.writer)
+    {
+        socket->non_blocking(true);
+
+        reader->rebind(socket);
+        writer->rebind(socket);
+    }
+
    ~transport() {
         try {
             socket->shutdown(socket_type::shutdown_both);
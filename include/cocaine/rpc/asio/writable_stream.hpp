@@ -24,12 +24,15 @@
 #include "cocaine/errors.hpp"
 #include "cocaine/logging.hpp"
 
+#include "cocaine/rpc/asio/compression.hpp"
+
 #include <functional>
 
 #include <asio/io_service.hpp>
 #include <asio/basic_stream_socket.hpp>
 
 #include <deque>
+#include <iterator>
 
 namespace cocaine { namespace io {
 
@@ -44,48 +47,84 @@ class writable_stream:
     typedef Encoder encoder_type;
     typedef typename encoder_type::message_type message_type;
 
-    const std::shared_ptr<socket_type> m_socket;
+    std::shared_ptr<socket_type> m_socket;
 
     typedef std::function<void(const std::error_code&)> handler_type;
 
-    std::deque<asio::const_buffer> m_messages;
-    std::deque<typename Encoder::encoded_message_type> m_encoded_messages;
-    std::deque<handler_type> m_handlers;
+    struct pending_t {
+        typename Encoder::encoded_message_type message;
+
+        // Compressed frame, which is sent instead of the encoded message, if any.
+        std::vector<char> frame;
+
+        // Number of buffers in the queue, which are still left unwritten for this message.
+        size_t buffers;
+
+        handler_type handle;
+    };
+
+    // Scatter-gather sequence of all the pending messages' buffers.
+    std::deque<asio::const_buffer> m_buffers;
+    std::deque<pending_t> m_pending;
 
     enum class states { idle, flushing } m_state;
 
     encoder_type encoder;
 
+    // Outgoing messages compression, enabled after the remote peer advertises its support.
+    std::unique_ptr<deflater_t> m_deflater;
+    size_t m_threshold;
+
 public:
     explicit
     writable_stream(const std::shared_ptr<socket_type>& socket):
         m_socket(socket),
-        m_state(states::idle)
+        m_state(states::idle),
+        m_threshold(0)
     { }
 
     void
     write(const message_type& message, handler_type handle) {
-        size_t bytes_written = 0;
-
         auto encoded = encoder.encode(message);
 
-        if(m_state == states::idle) {
-            std::error_code ec;
+        std::vector<char> frame;
 
-            // Try to write some data right away, as we don't have anything pending.
-            bytes_written = m_socket->write_some(asio::buffer(encoded.data(), encoded.size()), ec);
+        if(m_deflater && encoded.size() >= m_threshold) {
+            frame = deflate(encoded);
+        }
 
-            if(!ec && bytes_written == encoded.size()) {
-                return m_socket->get_io_service().post(trace_t::bind(handle, ec));
-            }
+        // NOTE: The handler is bound to the current trace here, because it might be invoked either
+        // right away or much later from an unrelated write completion.
+        m_pending.push_back(pending_t{std::move(encoded), std::move(frame), 0,
+            trace_t::bind(std::move(handle), std::placeholders::_1)});
+
+        pending_t& pending = m_pending.back();
+
+        const size_t count = m_buffers.size();
+
+        if(pending.frame.empty()) {
+            pending.message.buffers(std::back_inserter(m_buffers));
+        } else {
+            m_buffers.emplace_back(pending.frame.data(), pending.frame.size());
         }
 
-        m_messages.emplace_back(encoded.data() + bytes_written, encoded.size() - bytes_written);
-        m_handlers.emplace_back(handle);
-        m_encoded_messages.emplace_back(std::move(encoded));
+        pending.buffers = m_buffers.size() - count;
 
         if(m_state == states::flushing) {
             return;
+        }
+
+        std::error_code ec;
+
+        // Try to write some data right away, as we don't have anything pending.
+        const size_t bytes_written = m_socket->write_some(m_buffers, ec);
+
+        if(!ec) {
+            consume(bytes_written);
+        }
+
+        if(m_buffers.empty()) {
+            return;
         } else {
             m_state = states::flushing;
         }
@@ -93,56 +132,119 @@ public:
         namespace ph = std::placeholders;
 
         m_socket->async_write_some(
-            m_messages,
+            m_buffers,
             std::bind(&writable_stream::flush, this->shared_from_this(), ph::_1, ph::_2)
         );
     }
 
     auto
     pressure() const -> size_t {
-        return asio::buffer_size(m_messages);
+        return asio::buffer_size(m_buffers);
     }
 
-private:
+    // Whether all the queued messages have been written and no write operation is pending.
+    bool
+    idle() const {
+        return m_state == states::idle && m_pending.empty();
+    }
+
+    // Moves the stream to another socket sharing the same connection, keeping the encoder state.
+    // NOTE: Must be called only when the stream is idle.
     void
-    flush(const std::error_code& ec, size_t bytes_written) {
-        if(ec) {
-            if(ec == asio::error::operation_aborted) {
-                return;
-            }
+    rebind(const std::shared_ptr<socket_type>& socket) {
+        BOOST_ASSERT(idle());
+        m_socket = socket;
+    }
 
-            while(!m_handlers.empty()) {
-                m_socket->get_io_service().post(std::bind(m_handlers.front(), ec));
+    // Schedules a header to be sent to the remote peer along with the next message.
+    void
+    advertise(const hpack::header_t& header) {
+        encoder.push_header(header);
+    }
 
-                m_messages.pop_front();
-                m_handlers.pop_front();
-                m_encoded_messages.pop_front();
-            }
+    // Schedules a HPACK dynamic table size update. The remote peer must be able to apply it.
+    void
+    resize_table(size_t capacity) {
+        encoder.resize_table(capacity);
+    }
 
-            return;
+    // Enables compression for messages of at least the specified size. The remote peer must be able
+    // to decode compressed frames.
+    void
+    compress(size_t threshold) {
+        if(!m_deflater) {
+            m_deflater.reset(new deflater_t());
         }
 
-        while(bytes_written) {
-            BOOST_ASSERT(!m_messages.empty() && !m_handlers.empty());
+        m_threshold = threshold;
+    }
 
-            const size_t message_size = asio::buffer_size(m_messages.front());
+    // Switches outgoing messages to version 2 frames. The remote peer must be able to decode them.
+    void
+    upgrade() {
+        encoder.upgrade();
+    }
 
-            if(message_size > bytes_written) {
-                m_messages.front() = m_messages.front() + bytes_written;
-                break;
+    auto
+    version() const -> unsigned int {
+        return encoder.version();
+    }
+
+private:
+    auto
+    deflate(const typename Encoder::encoded_message_type& encoded) -> std::vector<char> {
+        std::vector<asio::const_buffer> buffers;
+        std::vector<char> frame(compressed_frame::header_size);
+        std::error_code ec;
+
+        encoded.buffers(std::back_inserter(buffers));
+
+        for(auto it = buffers.begin(); it != buffers.end() && !ec; ++it) {
+            m_deflater->deflate(asio::buffer_cast<const char*>(*it), asio::buffer_size(*it), frame, ec);
+        }
+
+        if(!ec) {
+            m_deflater->flush(frame, ec);
+        }
+
+        if(ec) {
+            // NOTE: The compression stream is broken at this point and the remote peer would not be
+            // able to decode anything from it anymore, so fall back to plain messages for good.
+            m_deflater.reset();
+            return std::vector<char>();
+        }
+
+        const size_t size = frame.size() - compressed_frame::header_size;
+
+        frame[0] = static_cast<char>(compressed_frame::marker);
+        frame[1] = static_cast<char>(size >> 24);
+        frame[2] = static_cast<char>(size >> 16);
+        frame[3] = static_cast<char>(size >> 8);
+        frame[4] = static_cast<char>(size);
+
+        return frame;
+    }
+
+    void
+    flush(const std::error_code& ec, size_t bytes_written) {
+        if(ec) {
+            if(ec == asio::error::operation_aborted) {
+                return;
             }
 
-            bytes_written -= message_size;
+            while(!m_pending.empty()) {
+                m_socket->get_io_service().post(std::bind(m_pending.front().handle, ec));
+                m_pending.pop_front();
+            }
 
-            // Queue this block's handler for invocation.
-            m_socket->get_io_service().post(std::bind(m_handlers.front(), ec));
+            m_buffers.clear();
 
-            m_messages.pop_front();
-            m_handlers.pop_front();
-            m_encoded_messages.pop_front();
+            return;
         }
 
-        if(m_messages.empty() && m_state == states::flushing) {
+        consume(bytes_written);
+
+        if(m_buffers.empty() && m_state == states::flushing) {
             m_state = states::idle;
             return;
         }
@@ -150,10 +252,37 @@ private:
         namespace ph = std::placeholders;
 
         m_socket->async_write_some(
-            m_messages,
+            m_buffers,
             std::bind(&writable_stream::flush, this->shared_from_this(), ph::_1, ph::_2)
         );
     }
+
+    void
+    consume(size_t bytes_written) {
+        while(bytes_written) {
+            BOOST_ASSERT(!m_buffers.empty() && !m_pending.empty());
+
+            const size_t buffer_size = asio::buffer_size(m_buffers.front());
+
+            if(buffer_size > bytes_written) {
+                m_buffers.front() = m_buffers.front() + bytes_written;
+                break;
+            }
+
+            bytes_written -= buffer_size;
+
+            m_buffers.pop_front();
+
+            if(--m_pending.front().buffers) {
+                continue;
+            }
+
+            // Queue this message's handler for invocation.
+            m_socket->get_io_service().post(std::bind(m_pending.front().handle, std::error_code()));
+
+            m_pending.pop_front();
+        }
+    }
 };
 
 }} // namespace cocaine::io
@@ -65,6 +65,15 @@ public:
     boost::optional<dispatch_ptr_t>
     process(const decoder_t::message_type& message, const upstream_ptr_t& upstream) const = 0;
 
+    // Same as above, but protocol violations, i.e. unknown slots or malformed arguments, are reported
+    // via the error code instead of exceptions, so that rejecting garbage is cheap. Exceptions thrown
+    // by the slots themselves are propagated as usual.
+
+    virtual
+    boost::optional<dispatch_ptr_t>
+    process(const decoder_t::message_type& message, const upstream_ptr_t& upstream,
+            std::error_code& ec) const = 0;
+
     // Called on abnormal transport destruction. The idea's if the client disconnects unexpectedly,
     // i.e. not reaching the end of the dispatch graph, then some special handling might be needed.
     // Think 'zookeeper ephemeral nodes'.
@@ -148,6 +157,11 @@ public:
     boost::optional<io::dispatch_ptr_t>
     process(const io::decoder_t::message_type& message, const io::upstream_ptr_t& upstream) const;
 
+    virtual
+    boost::optional<io::dispatch_ptr_t>
+    process(const io::decoder_t::message_type& message, const io::upstream_ptr_t& upstream,
+            std::error_code& ec) const;
+
     virtual
     auto
     root() const -> const io::graph_root_t& {
@@ -165,6 +179,10 @@ public:
     template<class Visitor>
     typename Visitor::result_type
     process(int id, const Visitor& visitor) const;
+
+private:
+    auto
+    find_slot(int id) const -> boost::optional<typename slot_map_t::mapped_type>;
 };
 
 template<class Tag>
@@ -194,25 +212,36 @@ struct select<streamed<R>, Event> {
 struct calling_visitor_t:
     public boost::static_visitor<boost::optional<io::dispatch_ptr_t>>
 {
-    calling_visitor_t(const msgpack::object& unpacked_, const io::upstream_ptr_t& upstream_):
+    calling_visitor_t(const msgpack::object& unpacked_, const io::upstream_ptr_t& upstream_,
+                      std::error_code& ec_):
         unpacked(unpacked_),
-        upstream(upstream_)
+        upstream(upstream_),
+        ec(ec_)
     { }
 
     template<class Event>
     result_type
     operator()(const std::shared_ptr<io::basic_slot<Event>>& slot) const {
         typedef io::basic_slot<Event> slot_type;
+        typedef io::type_traits<typename io::event_traits<Event>::argument_type> traits_type;
 
         // Unpacked arguments storage.
         typename slot_type::tuple_type args;
 
+        // NOTE: Most of the garbage is rejected here without throwing. Element type mismatches are
+        // only detected by MessagePack itself, which signals them with exceptions.
+        if(!traits_type::conforms(unpacked)) {
+            ec = error::invalid_argument;
+            return boost::none;
+        }
+
         try {
             // NOTE: Unpacks the object into a tuple using the argument typelist unlike using plain
             // tuple type traits, in order to support parameter tags, like optional<T>.
-            io::type_traits<typename io::event_traits<Event>::argument_type>::unpack(unpacked, args);
-        } catch(const msgpack::type_error& e) {
-            throw std::system_error(error::invalid_argument, e.what());
+            traits_type::unpack(unpacked, args);
+        } catch(const msgpack::type_error&) {
+            ec = error::invalid_argument;
+            return boost::none;
         }
 
         // Call the slot with the upstream constrained with the event's upstream protocol type tag.
@@ -222,6 +251,9 @@ struct calling_visitor_t:
 private:
     const msgpack::object&    unpacked;
     const io::upstream_ptr_t& upstream;
+
+    // Protocol violations are reported here, slot exceptions are propagated.
+    std::error_code& ec;
 };
 
 } // namespace aux
@@ -263,16 +295,51 @@ dispatch<Tag>::forget() {
 template<class Tag>
 boost::optional<io::dispatch_ptr_t>
 dispatch<Tag>::process(const io::decoder_t::message_type& message, const io::upstream_ptr_t& upstream) const {
-    return process(message.type(), aux::calling_visitor_t(message.args(), upstream));
+    std::error_code ec;
+
+    const auto transition = process(message, upstream, ec);
+
+    if(ec) {
+        throw std::system_error(ec);
+    }
+
+    return transition;
+}
+
+template<class Tag>
+boost::optional<io::dispatch_ptr_t>
+dispatch<Tag>::process(const io::decoder_t::message_type& message, const io::upstream_ptr_t& upstream,
+                       std::error_code& ec) const
+{
+    const auto slot = find_slot(message.type());
+
+    if(!slot) {
+        ec = error::slot_not_found;
+        return boost::none;
+    }
+
+    return boost::apply_visitor(aux::calling_visitor_t(message.args(), upstream, ec), *slot);
 }
 
 template<class Tag>
 template<class Visitor>
 typename Visitor::result_type
 dispatch<Tag>::process(int id, const Visitor& visitor) const {
+    const auto slot = find_slot(id);
+
+    if(!slot) {
+        throw std::system_error(error::slot_not_found);
+    }
+
+    return boost::apply_visitor(visitor, *slot);
+}
+
+template<class Tag>
+auto
+dispatch<Tag>::find_slot(int id) const -> boost::optional<typename slot_map_t::mapped_type> {
     typedef typename slot_map_t::mapped_type slot_ptr_type;
 
-    const auto slot = m_slots.apply([&](const slot_map_t& mapping) -> slot_ptr_type {
+    return m_slots.apply([&](const slot_map_t& mapping) -> boost::optional<slot_ptr_type> {
         typename slot_map_t::const_iterator lb, ub;
 
         // NOTE: Using equal_range() here, instead of find() to check for slot existence and get the
@@ -284,11 +351,9 @@ dispatch<Tag>::process(int id, const Visitor& visitor) const {
             // via dispatch<T>::forget() without pulling the object from underneath itself.
             return lb->second;
         } else {
-            throw std::system_error(error::slot_not_found);
+            return boost::none;
         }
     });
-
-    return boost::apply_visitor(visitor, slot);
 }
 
 } // namespace cocaine
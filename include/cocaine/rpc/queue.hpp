@@ -25,6 +25,11 @@
 #include "cocaine/rpc/tags.hpp"
 #include "cocaine/rpc/upstream.hpp"
 
+#include "cocaine/memory.hpp"
+
+#include <atomic>
+#include <mutex>
+
 #include <boost/variant/apply_visitor.hpp>
 #include <boost/variant/static_visitor.hpp>
 
@@ -58,14 +63,29 @@ private:
 
 template<class Tag>
 class message_queue {
-    // Operation log.
-    std::vector<typename make_frozen_over<Tag>::type> m_operations;
+    typedef typename make_frozen_over<Tag>::type frozen_type;
+
+    enum class state_t { buffering, attached };
+
+    // Switches to attached once the operation log has been flushed into the upstream, after which
+    // the events are sent straight to the upstream without locking.
+    std::atomic<state_t> m_state;
 
-    // The upstream might be attached during message invocation, so it has to be synchronized for
-    // thread safety - the atomicity guarantee of the shared_ptr<T> is not enough.
+    // Guards the operation log and the transition from buffering to attached.
+    std::mutex m_mutex;
+
+    // Operation log. Most of the time it holds one or two events, so it's allocated from the pool.
+    std::vector<frozen_type, pooled<frozen_type>> m_operations;
+
+    // Set once under the lock right before the state transition and never modified afterwards, so
+    // it's safe to use without locking as soon as the queue is observed to be attached.
     std::shared_ptr<basic_upstream_t> m_upstream;
 
 public:
+    message_queue():
+        m_state(state_t::buffering)
+    { }
+
     template<class Event, class... Args>
     void
     append(Args&&... args) {
@@ -74,10 +94,20 @@ public:
             "message protocol is not compatible with this message queue"
         );
 
-        if(!m_upstream) {
+        if(m_state.load(std::memory_order_acquire) == state_t::attached) {
+            return m_upstream->template send<Event>(std::forward<Args>(args)...);
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        if(m_state.load(std::memory_order_relaxed) == state_t::buffering) {
             return m_operations.emplace_back(make_frozen<Event>(std::forward<Args>(args)...));
         }
 
+        // The upstream has been attached while this thread was waiting for the lock, and the log has
+        // already been flushed, so the event can be sent without holding it.
+        lock.unlock();
+
         m_upstream->template send<Event>(std::forward<Args>(args)...);
     }
 
@@ -89,6 +119,8 @@ public:
             "upstream protocol is not compatible with this message queue"
         );
 
+        std::lock_guard<std::mutex> lock(m_mutex);
+
         if(!m_operations.empty()) {
             aux::frozen_visitor visitor(upstream.ptr);
 
@@ -96,10 +128,14 @@ public:
             // visitor object, so there's no other choice but to actually bind it to a variable.
             std::for_each(m_operations.begin(), m_operations.end(), boost::apply_visitor(visitor));
 
-            m_operations.clear();
+            // Give the log storage back to the pool, it won't be used anymore.
+            decltype(m_operations)().swap(m_operations);
         }
 
         m_upstream = std::move(upstream.ptr);
+
+        // Publish the upstream. Events appended after this point are ordered after the flushed ones.
+        m_state.store(state_t::attached, std::memory_order_release);
     }
 };
 
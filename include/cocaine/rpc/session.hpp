@@ -24,6 +24,9 @@
 #include "cocaine/common.hpp"
 #include "cocaine/locked_ptr.hpp"
 
+#include <atomic>
+#include <deque>
+
 #include <asio/generic/stream_protocol.hpp>
 
 #include "cocaine/rpc/asio/encoder.hpp"
@@ -42,15 +45,13 @@ class session_t:
     class pull_action_t;
     class push_action_t;
 
-    class channel_t;
-
-    typedef std::map<uint64_t, std::shared_ptr<channel_t>> channel_map_t;
+    struct deleter_t;
 
     // Log of last resort.
     const std::unique_ptr<logging::log_t> log;
 
     // The underlying connection.
-#if defined(__clang__)
+#if defined(COCAINE_HAS_FEATURE_ATOMIC_SHARED_PTR)
     std::shared_ptr<transport_type> transport;
 #else
     synchronized<std::shared_ptr<transport_type>> transport;
@@ -59,21 +60,57 @@ class session_t:
     // Initial dispatch. Internally synchronized.
     const io::dispatch_ptr_t prototype;
 
-    // Virtual channels.
-    synchronized<channel_map_t> channels;
+    // Virtual channels. Owned by the session thread, i.e. the thread running the transport's reactor,
+    // so that incoming messages are routed without any locking.
+    const std::unique_ptr<io::channel_table_t> channels;
 
     // The maximum channel id processed by the session. Checking whether channel id is always higher
     // than the previous channel id is similar to an infinite TIME_WAIT timeout for TCP sockets. It
     // might be not the best approach, but since we have 2^64 possible channel ids, and not 2^16 TCP
     // ports available to us, it's good enough.
-    uint64_t max_channel_id;
+    std::atomic<uint64_t> max_channel_id;
+
+    // Outgoing messages of at least this size are compressed once the remote peer advertises that it
+    // supports compression. Zero means that compression is disabled.
+    size_t compression_threshold;
+    bool compression_enabled;
+
+    // HPACK dynamic table capacity for the remote peer to use for the headers sent by the session,
+    // applied once the remote peer advertises that it supports table size updates.
+    boost::optional<size_t> table_capacity;
+    bool table_resized;
+
+    // Number of incoming messages handled and outgoing messages written by the session. Owned by the
+    // session thread.
+    uint64_t handled;
+    uint64_t written;
+
+    // Idle timeout and heartbeat state, if enabled. Owned by the session thread.
+    std::unique_ptr<io::liveness_t> liveness;
+
+    struct migration_t {
+        std::shared_ptr<asio::io_service> target;
+        std::function<bool(int)> handle;
+    };
+
+    // Pending request to move the session to another reactor. Owned by the session thread.
+    std::unique_ptr<migration_t> migration;
+
+    // While the session is being moved to another reactor, outgoing messages sent via the new one
+    // are held back until every message still in flight to the previous reactor has been forwarded,
+    // so that they are written in order. Owned by the session thread.
+    bool fenced;
+    std::deque<std::function<void()>> backlog;
 
 public:
     session_t(std::unique_ptr<logging::log_t> log,
               std::unique_ptr<transport_type> transport, const io::dispatch_ptr_t& prototype);
 
+   ~session_t();
+
     // Observers
 
+    // NOTE: Must be called from the session thread.
     auto
     active_channels() const -> std::map<uint64_t, std::string>;
 
@@ -86,17 +123,69 @@ public:
     auto
     remote_endpoint() const -> endpoint_type;
 
+    // Number of incoming messages handled by the session so far.
+    // NOTE: Must be called from the session thread.
+    auto
+    messages() const -> uint64_t;
+
+    // Whether the session can be moved to another reactor right away, i.e. it has nothing left to
+    // write and isn't being moved already.
+    // NOTE: Must be called from the session thread.
+    bool
+    movable() const;
+
     // Modifiers
 
     auto
     fork(const io::dispatch_ptr_t& dispatch) -> io::upstream_ptr_t;
 
+    // NOTE: Must be called before the session is activated via pull().
+    void
+    compress(size_t threshold);
+
+    // Resizes the remote peer's HPACK dynamic table for the headers sent by the session, as soon as
+    // the remote peer advertises that it supports table size updates.
+    // NOTE: Must be called before the session is activated via pull().
+    void
+    header_table(size_t capacity);
+
+    // Detaches the session once the remote peer sends a compressed or version 2 frame larger than the
+    // given size in bytes, or a compressed frame inflating to more than that.
+    // NOTE: Must be called before the session is activated via pull().
+    void
+    limit(size_t size);
+
+    // Sets the number of messages handled at most in one turn of the session's engine, and the number
+    // of bytes the session is granted every turn. See readable_stream for the scheduling details.
+    // NOTE: Must be called before the session is activated via pull().
+    void
+    schedule(size_t messages, size_t bytes);
+
+    // Switches outgoing messages to version 2 frames, which the remote peer must support. Incoming
+    // version 2 frames are always accepted and make the session reply with them as well.
+    // NOTE: Must be called before the session is activated via pull().
+    void
+    upgrade();
+
+    // Detaches the session once it hasn't sent or received any messages for the timeout, and pings the
+    // remote peer once it's been silent for the heartbeat interval, detaching the session if there's
+    // no reply within the same interval. Only peers advertising heartbeat support are pinged. Both
+    // intervals are in seconds, zero disables either.
+    // NOTE: Must be called before the session is activated via pull().
+    void
+    keepalive(size_t timeout, size_t heartbeat);
+
     void
     pull();
 
     void
     push(io::encoder_t::message_type&& message);
 
+    // Removes the channel from the channel table without notifying its dispatch, so that messages
+    // sent by the remote peer to that channel are ignored from now on. Can be called from any thread.
+    void
+    forget(uint64_t channel_id);
+
     // NOTE: Detaching a session destroys the connection but not necessarily the session itself, as
     // it might be still in use by shared upstreams even in other threads. In other words, this does
     // not guarantee that the session will be actually deleted, but it's fine, since the connection
@@ -105,9 +194,29 @@ public:
     void
     detach(const std::error_code& ec);
 
+    // Moves the session to another reactor by re-registering its socket there. Sessions with nothing
+    // left to write are moved right away, by cancelling the pending read, others at the next message
+    // boundary. The handler is invoked from the session thread with the new socket descriptor right
+    // before the switch, and might refuse it by returning false. A new request replaces the previous
+    // one, if it's still pending.
+    // NOTE: Must be called from the session thread.
+    void
+    migrate(const std::shared_ptr<asio::io_service>& target, std::function<bool(int)> handle);
+
+    // Drops the pending migration request, if any.
+    // NOTE: Must be called from the session thread.
+    void
+    stay();
+
 private:
+    // Protocol violations, like revoked channels or unknown slots, are reported via the error code
+    // instead of exceptions. Exceptions are reserved for failures inside the slots.
     void
-    handle(const io::decoder_t::message_type& message);
+    handle(const io::decoder_t::message_type& message, std::error_code& ec);
+
+    // Control messages from the reserved channel zero, like heartbeats.
+    void
+    control(const io::decoder_t::message_type& message, std::error_code& ec);
 
     // NOTE: The revocation happens to channel id only, not the upstream itself. It means that while
     // some channel might be revoked during message handling, it only prohibit new incoming messages
@@ -116,6 +225,35 @@ private:
 
     void
     revoke(uint64_t channel_id);
+
+    // Channel table operations, all of them are run in the session thread.
+
+    void
+    insert(const std::shared_ptr<transport_type>& ptr, uint64_t channel_id,
+           const io::dispatch_ptr_t& dispatch, const io::upstream_ptr_t& upstream);
+
+    void
+    erase(const std::shared_ptr<transport_type>& ptr, uint64_t channel_id);
+
+    void
+    discard(const std::error_code& ec);
+
+    // Migration steps. The transport is moved in the old session thread, and the held back messages
+    // are released in the new one once the old transport is no longer referenced, see deleter_t.
+
+    auto
+    transfer(const std::shared_ptr<transport_type>& ptr) -> std::shared_ptr<transport_type>;
+
+    void
+    release();
+
+    // Liveness checks, run in the session thread.
+
+    void
+    watch();
+
+    void
+    check(const std::error_code& ec);
 };
 
 template<class Protocol>
@@ -105,7 +105,7 @@ struct deferred {
     template<template<class> class, class, class> friend struct io::deferred_slot;
 
     deferred():
-        outbox(new synchronized<queue_type>())
+        outbox(std::allocate_shared<queue_type>(io::pooled<queue_type>()))
     { }
 
     template<class... Args>
@@ -114,20 +114,20 @@ struct deferred {
         deferred&
     >::type
     write(Args&&... args) {
-        outbox->synchronize()->template append<typename protocol::value>(std::forward<Args>(args)...);
+        outbox->template append<typename protocol::value>(std::forward<Args>(args)...);
         return *this;
     }
 
     deferred&
     abort(const std::error_code& ec, const std::string& reason) {
-        outbox->synchronize()->template append<typename protocol::error>(ec, reason);
+        outbox->template append<typename protocol::error>(ec, reason);
         return *this;
     }
 
 #if defined(__clang__)
     deferred&
     abort(const std::error_code& ec) {
-        outbox->synchronize()->template append<typename protocol::error>(ec);
+        outbox->template append<typename protocol::error>(ec);
         return *this;
     }
 #endif
@@ -135,11 +135,12 @@ struct deferred {
     template<class UpstreamType>
     void
     attach(UpstreamType&& upstream) {
-        outbox->synchronize()->attach(std::move(upstream));
+        outbox->attach(std::move(upstream));
     }
 
 private:
-    const std::shared_ptr<synchronized<queue_type>> outbox;
+    // Internally synchronized.
+    const std::shared_ptr<queue_type> outbox;
 };
 
 template<>
@@ -152,37 +153,38 @@ struct deferred<void> {
     template<template<class> class, class, class> friend struct io::deferred_slot;
 
     deferred():
-        outbox(new synchronized<queue_type>())
+        outbox(std::allocate_shared<queue_type>(io::pooled<queue_type>()))
     { }
 
     deferred&
     abort(const std::error_code& ec, const std::string& reason) {
-        outbox->synchronize()->append<protocol::error>(ec, reason);
+        outbox->append<protocol::error>(ec, reason);
         return *this;
     }
 
 #if defined(__clang__)
     deferred&
     abort(const std::error_code& ec) {
-        outbox->synchronize()->append<protocol::error>(ec);
+        outbox->append<protocol::error>(ec);
         return *this;
     }
 #endif
 
     deferred&
     close() {
-        outbox->synchronize()->append<protocol::value>();
+        outbox->append<protocol::value>();
         return *this;
     }
 
     template<class UpstreamType>
     void
     attach(UpstreamType&& upstream) {
-        outbox->synchronize()->attach(std::move(upstream));
+        outbox->attach(std::move(upstream));
     }
 
 private:
-    const std::shared_ptr<synchronized<queue_type>> outbox;
+    // Internally synchronized.
+    const std::shared_ptr<queue_type> outbox;
 };
 
 } // namespace cocaine
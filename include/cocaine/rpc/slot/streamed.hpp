@@ -35,7 +35,7 @@ struct streamed {
     template<template<class> class, class, class> friend struct io::deferred_slot;
 
     streamed():
-        outbox(new synchronized<queue_type>())
+        outbox(std::allocate_shared<queue_type>(io::pooled<queue_type>()))
     { }
 
     template<class... Args>
@@ -44,38 +44,39 @@ struct streamed {
         streamed&
     >::type
     write(Args&&... args) {
-        outbox->synchronize()->template append<typename protocol::chunk>(std::forward<Args>(args)...);
+        outbox->template append<typename protocol::chunk>(std::forward<Args>(args)...);
         return *this;
     }
 
     streamed&
     abort(const std::error_code& ec, const std::string& reason) {
-        outbox->synchronize()->template append<typename protocol::error>(ec, reason);
+        outbox->template append<typename protocol::error>(ec, reason);
         return *this;
     }
 
 #if defined(__clang__)
     streamed&
     abort(const std::error_code& ec) {
-        outbox->synchronize()->template append<typename protocol::error>(ec);
+        outbox->template append<typename protocol::error>(ec);
         return *this;
     }
 #endif
 
     streamed&
     close() {
-        outbox->synchronize()->template append<typename protocol::choke>();
+        outbox->template append<typename protocol::choke>();
         return *this;
     }
 
     template<class UpstreamType>
     void
     attach(UpstreamType&& upstream) {
-        outbox->synchronize()->attach(std::move(upstream));
+        outbox->attach(std::move(upstream));
     }
 
 private:
-    const std::shared_ptr<synchronized<queue_type>> outbox;
+    // Internally synchronized.
+    const std::shared_ptr<queue_type> outbox;
 };
 
 } // namespace cocaine
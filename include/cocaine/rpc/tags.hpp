@@ -35,6 +35,12 @@ struct optional;
 template<class T, T Default>
 struct optional_with_default;
 
+// Packs an arithmetic vector as a single raw blob of little-endian values instead of an array. The
+// receiving side accepts both encodings for arithmetic vectors, regardless of this tag.
+
+template<class T>
+struct raw;
+
 // Forward common protocol tags
 
 template<class T>
@@ -76,12 +82,35 @@ struct unwrap_type {
 };
 
 template<class T>
-struct unwrap_type<optional<T>> {
+struct unwrap_type<optional<T>>:
+    public unwrap_type<T>
+{ };
+
+template<class T, T Default>
+struct unwrap_type<optional_with_default<T, Default>> {
+    typedef T type;
+};
+
+template<class T>
+struct unwrap_type<raw<T>> {
+    typedef T type;
+};
+
+// Unlike unwrap_type<T>, keeps the encoding tags, so that the correct type traits are used to pack
+// the argument.
+
+template<class T>
+struct pack_type {
     typedef T type;
 };
 
+template<class T>
+struct pack_type<optional<T>>:
+    public pack_type<T>
+{ };
+
 template<class T, T Default>
-struct unwrap_type<optional_with_default<T, Default>> {
+struct pack_type<optional_with_default<T, Default>> {
     typedef T type;
 };
 
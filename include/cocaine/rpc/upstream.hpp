@@ -45,6 +45,11 @@ public:
     void
     send(Args&&... args);
 
+    // Stops routing incoming messages of this channel to its dispatch, e.g. once the caller has given
+    // up waiting for a reply. The dispatch is not notified.
+    void
+    revoke();
+
     /* none_t if upstream belongs to server side */
     boost::optional<trace_t> client_trace;
 };
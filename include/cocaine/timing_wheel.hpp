@@ -0,0 +1,201 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_IO_TIMING_WHEEL_HPP
+#define COCAINE_IO_TIMING_WHEEL_HPP
+
+#include "cocaine/common.hpp"
+
+#include <array>
+#include <chrono>
+#include <functional>
+
+#include <asio/deadline_timer.hpp>
+#include <asio/io_service.hpp>
+
+namespace cocaine { namespace io {
+
+// Hierarchical timing wheel with millisecond granularity, which keeps any number of timeouts on a
+// single asio timer. Timeouts are inserted and cancelled in constant time without touching the heap,
+// so it's suitable for per-request deadlines, idle timeouts and keepalives.
+//
+// There's one wheel per reactor, created on first use and owned by the reactor's io_service. Use it
+// via wheel_timer_t objects below.
+// NOTE: Not thread-safe, i.e. must be only used from the thread running the reactor.
+
+class timing_wheel_t:
+    public asio::io_service::service
+{
+    COCAINE_DECLARE_NONCOPYABLE(timing_wheel_t)
+
+    friend class wheel_timer_t;
+
+    // Four levels of 256 slots each cover timeouts up to 49 days. Longer timeouts are cascaded down
+    // from the last level more than once.
+    static const unsigned int kLevelBits  = 8;
+    static const unsigned int kLevelCount = 4;
+    static const unsigned int kSlotCount  = 1 << kLevelBits;
+    static const unsigned int kSlotMask   = kSlotCount - 1;
+
+    // Pseudo slots for entries which are not linked into the wheel or are being expired.
+    static const unsigned int kUnlinked = ~0u;
+    static const unsigned int kExpiring = kLevelCount * kSlotCount;
+
+    typedef std::function<void(const std::error_code&)> handler_type;
+
+    struct entry_t {
+        entry_t* prev;
+        entry_t* next;
+
+        // Slot the entry is linked into.
+        unsigned int slot;
+
+        // Expiration time in wheel ticks, i.e. milliseconds since the wheel's creation.
+        uint64_t deadline;
+
+        handler_type handler;
+    };
+
+    // Entry lists for every slot of every level, and the expiring entries of the current tick.
+    std::array<entry_t*, kLevelCount * kSlotCount + 1> m_slots;
+    std::array<uint64_t, kLevelCount * kSlotCount / 64> m_occupied;
+
+    const std::chrono::steady_clock::time_point m_epoch;
+
+    // The next tick to be processed, every earlier one has already expired.
+    uint64_t m_next;
+
+    // The underlying timer is armed for the earliest tick which has something to process, if any.
+    asio::deadline_timer m_timer;
+    uint64_t m_armed;
+
+public:
+    static asio::io_service::id id;
+
+    explicit
+    timing_wheel_t(asio::io_service& asio);
+
+    // Current time in wheel ticks. Never behind the ticks already processed, so that timeouts started
+    // by the handlers are relative to the tick being processed, even when the wheel is driven by hand.
+    auto
+    now() const -> uint64_t;
+
+    // Processes every tick up to and including the target one, firing the expired entries. Normally
+    // driven by the underlying timer, but might be called directly to drive the wheel by hand.
+    void
+    advance(uint64_t target);
+
+private:
+    virtual
+    void
+    shutdown_service();
+
+    void
+    link(entry_t& entry);
+
+    void
+    unlink(entry_t& entry);
+
+    void
+    cascade(unsigned int level, uint64_t tick);
+
+    // Index of the first occupied slot of the level starting from the specified one, if any.
+    auto
+    find(unsigned int level, unsigned int from) const -> unsigned int;
+
+    // The earliest tick which has something to process, i.e. some slot to expire or to cascade.
+    auto
+    due() const -> uint64_t;
+
+    void
+    arm(uint64_t tick);
+
+    void
+    on_timer(const std::error_code& ec);
+};
+
+// Drop-in replacement for asio::deadline_timer, backed by the reactor's timing wheel. Pending waits
+// are completed with asio::error::operation_aborted on cancellation, as usual.
+// NOTE: Unlike asio::deadline_timer, only one wait might be pending at a time.
+
+class wheel_timer_t {
+    COCAINE_DECLARE_NONCOPYABLE(wheel_timer_t)
+
+    timing_wheel_t& m_wheel;
+    timing_wheel_t::entry_t m_entry;
+
+public:
+    explicit
+    wheel_timer_t(asio::io_service& asio):
+        m_wheel(asio::use_service<timing_wheel_t>(asio))
+    {
+        m_entry.slot = timing_wheel_t::kUnlinked;
+        m_entry.deadline = m_wheel.now();
+    }
+
+   ~wheel_timer_t() {
+        cancel();
+    }
+
+    auto
+    get_io_service() -> asio::io_service& {
+        return m_wheel.get_io_service();
+    }
+
+    // Cancels the pending wait, if any.
+    size_t
+    expires_from_now(const boost::posix_time::time_duration& duration) {
+        const size_t cancelled = cancel();
+
+        m_entry.deadline = m_wheel.now() + std::max<int64_t>(duration.total_milliseconds(), 0);
+
+        return cancelled;
+    }
+
+    template<class Handler>
+    void
+    async_wait(Handler handler) {
+        BOOST_ASSERT(m_entry.slot == timing_wheel_t::kUnlinked);
+
+        m_entry.handler = std::move(handler);
+        m_wheel.link(m_entry);
+    }
+
+    size_t
+    cancel() {
+        if(m_entry.slot == timing_wheel_t::kUnlinked) {
+            return 0;
+        }
+
+        m_wheel.unlink(m_entry);
+
+        m_wheel.get_io_service().post(std::bind(std::move(m_entry.handler),
+            std::error_code(asio::error::operation_aborted)
+        ));
+
+        m_entry.handler = nullptr;
+
+        return 1;
+    }
+};
+
+}} // namespace cocaine::io
+
+#endif
@@ -74,9 +74,17 @@ public:
     template<typename Level>
     blackhole::record_t
     open_record(Level level, blackhole::attribute::set_t attributes = blackhole::attribute::set_t()) const {
+        // NOTE: Records below the logger verbosity are rejected right away, so that the filtered out
+        // debug messages on hot paths don't pay for copying and formatting the attributes, which is
+        // only needed for records which are going to be emitted.
+        if(level < this->log().verbosity()) {
+            return blackhole::record_t();
+        }
+
         // TODO: Do this under lock or drop assignment.
         AttributeFetcher fetcher;
         const auto& dynamic_attributes = fetcher();
+        attributes.reserve(attributes.size() + this->attributes.size() + dynamic_attributes.size());
         std::copy(this->attributes.begin(), this->attributes.end(), std::back_inserter(attributes));
         std::copy(dynamic_attributes.begin(), dynamic_attributes.end(), std::back_inserter(attributes));
         return this->wrapped->open_record(level, std::move(attributes));
@@ -23,6 +23,8 @@
 
 #include <msgpack.hpp>
 
+#include <type_traits>
+
 namespace cocaine { namespace io {
 
 template<class T, class = void>
@@ -41,6 +43,150 @@ struct type_traits {
     }
 };
 
+namespace aux {
+
+// Stream which only counts the bytes written into it.
+
+struct size_counter_t {
+    size_counter_t():
+        size(0)
+    { }
+
+    void
+    write(const char*, size_t length) {
+        size += length;
+    }
+
+    size_t size;
+};
+
+// MessagePack container header sizes.
+
+inline
+size_t
+raw_header_size(size_t size) {
+    return size < 32 ? 1 : size < 65536 ? 3 : 5;
+}
+
+inline
+size_t
+array_header_size(size_t size) {
+    return size < 16 ? 1 : size < 65536 ? 3 : 5;
+}
+
+inline
+size_t
+map_header_size(size_t size) {
+    return size < 16 ? 1 : size < 65536 ? 3 : 5;
+}
+
+// MessagePack always packs numbers using the shortest encoding which fits the value.
+
+inline
+size_t
+integer_size(uint64_t value) {
+    return value < 128 ? 1 : value < 256 ? 2 : value < 65536 ? 3 : value < 4294967296ULL ? 5 : 9;
+}
+
+inline
+size_t
+integer_size(int64_t value) {
+    if(value >= 0) {
+        return integer_size(static_cast<uint64_t>(value));
+    }
+
+    return value >= -32 ? 1 : value >= -128 ? 2 : value >= -32768 ? 3 :
+        value >= -2147483648LL ? 5 : 9;
+}
+
+// Packed size of the types which don't depend on the value, or zero for the ones which do.
+
+template<class T>
+struct fixed_size:
+    public std::integral_constant<size_t, 0>
+{ };
+
+template<>
+struct fixed_size<bool>:
+    public std::integral_constant<size_t, 1>
+{ };
+
+template<>
+struct fixed_size<float>:
+    public std::integral_constant<size_t, 5>
+{ };
+
+template<>
+struct fixed_size<double>:
+    public std::integral_constant<size_t, 9>
+{ };
+
+template<class T>
+struct is_sized_arithmetic:
+    public std::integral_constant<bool,
+        std::is_integral<T>::value || (std::is_floating_point<T>::value && fixed_size<T>::value)>
+{ };
+
+// Overload priorities for packed_size_impl().
+
+template<int N>
+struct rank: public rank<N - 1> { };
+
+template<>
+struct rank<0> { };
+
+template<class T, class U>
+inline
+auto
+packed_size_impl(const U& source, rank<2>) -> decltype(type_traits<T>::size(source)) {
+    return type_traits<T>::size(source);
+}
+
+template<class T, class U>
+inline
+typename std::enable_if<
+    is_sized_arithmetic<T>::value && std::is_convertible<U, T>::value,
+    size_t
+>::type
+packed_size_impl(const U& source, rank<1>) {
+    if(fixed_size<T>::value) {
+        return fixed_size<T>::value;
+    }
+
+    const T value = static_cast<T>(source);
+
+    if(std::is_signed<T>::value) {
+        return integer_size(static_cast<int64_t>(value));
+    } else {
+        return integer_size(static_cast<uint64_t>(value));
+    }
+}
+
+template<class T, class U>
+inline
+size_t
+packed_size_impl(const U& source, rank<0>) {
+    size_counter_t counter;
+    msgpack::packer<size_counter_t> packer(counter);
+
+    type_traits<T>::pack(packer, source);
+
+    return counter.size;
+}
+
+} // namespace aux
+
+// Exact size of the object packed with type_traits<T>, used to preallocate the encoding buffers.
+// Uses type_traits<T>::size() if available, computes it for numbers, and otherwise falls back to
+// packing the object into a counter.
+
+template<class T, class U>
+inline
+size_t
+packed_size(const U& source) {
+    return aux::packed_size_impl<T>(source, aux::rank<2>());
+}
+
 }} // namespace cocaine::io
 
 #endif
@@ -93,6 +93,62 @@ private:
     msgpack::packer<Stream>& m_target;
 };
 
+struct size_dynamic:
+    public boost::static_visitor<size_t>
+{
+    size_t
+    operator()(const dynamic_t::null_t& COCAINE_UNUSED_(source)) const {
+        return 1;
+    }
+
+    size_t
+    operator()(const dynamic_t::bool_t& COCAINE_UNUSED_(source)) const {
+        return 1;
+    }
+
+    size_t
+    operator()(const dynamic_t::int_t& source) const {
+        return packed_size<dynamic_t::int_t>(source);
+    }
+
+    size_t
+    operator()(const dynamic_t::uint_t& source) const {
+        return packed_size<dynamic_t::uint_t>(source);
+    }
+
+    size_t
+    operator()(const dynamic_t::double_t& COCAINE_UNUSED_(source)) const {
+        return 9;
+    }
+
+    size_t
+    operator()(const dynamic_t::string_t& source) const {
+        return raw_header_size(source.size()) + source.size();
+    }
+
+    size_t
+    operator()(const dynamic_t::array_t& source) const {
+        size_t result = array_header_size(source.size());
+
+        for(size_t i = 0; i < source.size(); ++i) {
+            result += source[i].apply(*this);
+        }
+
+        return result;
+    }
+
+    size_t
+    operator()(const dynamic_t::object_t& source) const {
+        size_t result = map_header_size(source.size());
+
+        for(auto it = source.begin(); it != source.end(); ++it) {
+            result += raw_header_size(it->first.size()) + it->first.size() + it->second.apply(*this);
+        }
+
+        return result;
+    }
+};
+
 } // namespace aux
 
 template<>
@@ -104,6 +160,12 @@ struct type_traits<dynamic_t> {
         source.apply(aux::pack_dynamic<Stream>(target));
     }
 
+    static inline
+    size_t
+    size(const dynamic_t& source) {
+        return source.apply(aux::size_dynamic());
+    }
+
     static inline
     void
     unpack(const msgpack::object& source, dynamic_t& target) {
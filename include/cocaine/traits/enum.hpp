@@ -50,6 +50,12 @@ struct type_traits<
         target << static_cast<base_type>(source);
     }
 
+    static inline
+    size_t
+    size(const T& source) {
+        return packed_size<base_type>(static_cast<base_type>(source));
+    }
+
     static inline
     void
     unpack(const msgpack::object& source, T& target) {
@@ -42,6 +42,13 @@ struct type_traits<std::error_code> {
         type_traits<sequence_type>::pack(target, category_id, ec);
     }
 
+    static inline
+    size_t
+    size(const std::error_code& source) {
+        return type_traits<sequence_type>::size(error::registrar::map(source.category()),
+            source.value());
+    }
+
     static inline
     void
     unpack(const msgpack::object& source, std::error_code& target) {
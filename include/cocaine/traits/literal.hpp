@@ -38,6 +38,12 @@ struct type_traits<char[N]> {
         target.pack_raw(N - 1);
         target.pack_raw_body(source, N - 1);
     }
+
+    static inline
+    size_t
+    size(const char*) {
+        return aux::raw_header_size(N - 1) + N - 1;
+    }
 };
 
 // Specialization to pack character arrays without copying to a std::string first.
@@ -68,6 +74,18 @@ struct type_traits<std::string> {
         target << source;
     }
 
+    static inline
+    size_t
+    size(const literal_t& source) {
+        return aux::raw_header_size(source.size) + source.size;
+    }
+
+    static inline
+    size_t
+    size(const std::string& source) {
+        return aux::raw_header_size(source.size()) + source.size();
+    }
+
     static inline
     void
     unpack(const msgpack::object& source, std::string& target) {
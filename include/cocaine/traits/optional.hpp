@@ -40,6 +40,12 @@ struct type_traits<boost::optional<T>> {
         }
     }
 
+    static inline
+    size_t
+    size(const boost::optional<T>& source) {
+        return source ? packed_size<T>(*source) : 1;
+    }
+
     static inline
     void
     unpack(const msgpack::object& source, boost::optional<T>& target) {
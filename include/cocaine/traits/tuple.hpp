@@ -61,6 +61,13 @@ struct tuple_type_traits_impl<index_sequence<Indices...>> {
         type_traits<Sequence>::pack(target, std::get<Indices>(source)...);
     }
 
+    template<class Sequence, class Tuple>
+    static inline
+    size_t
+    size(const Tuple& source) {
+        return type_traits<Sequence>::size(std::get<Indices>(source)...);
+    }
+
     template<class Sequence, class Tuple>
     static inline
     void
@@ -71,10 +78,12 @@ struct tuple_type_traits_impl<index_sequence<Indices...>> {
 
 template<class T>
 struct unpack_sequence_impl {
+    typedef typename details::unwrap_type<T>::type value_type;
+
     template<class SourceIterator>
     static inline
     SourceIterator
-    apply(SourceIterator it, SourceIterator COCAINE_UNUSED_(end), T& target) {
+    apply(SourceIterator it, SourceIterator COCAINE_UNUSED_(end), value_type& target) {
         // The only place where the source iterator is actually could be incremented, all other
         // unpackers either delegate to this one, or don't touch the source at all.
         type_traits<T>::unpack(*it++, target);
@@ -85,14 +94,16 @@ struct unpack_sequence_impl {
 
 template<class T>
 struct unpack_sequence_impl<optional<T>> {
+    typedef typename details::unwrap_type<T>::type value_type;
+
     template<class SourceIterator>
     static inline
     SourceIterator
-    apply(SourceIterator it, SourceIterator end, T& target) {
+    apply(SourceIterator it, SourceIterator end, value_type& target) {
         if(it != end) {
             return unpack_sequence_impl<T>::apply(it, end, target);
         } else {
-            target = T();
+            target = value_type();
         }
 
         return it;
@@ -195,6 +206,25 @@ public:
         traits_type::template pack<T>(target, source);
     }
 
+    template<class... Args>
+    static inline
+    size_t
+    size(const Args&... sources) {
+        return aux::array_header_size(sizeof...(sources)) +
+            size_sequence<typename boost::mpl::begin<T>::type>(sources...);
+    }
+
+    template<class... Args>
+    static inline
+    size_t
+    size(const std::tuple<Args...>& source) {
+        typedef aux::tuple_type_traits_impl<
+            typename make_index_sequence<sizeof...(Args)>::type
+        > traits_type;
+
+        return traits_type::template size<T>(source);
+    }
+
     template<class... Args>
     static inline
     void
@@ -228,6 +258,23 @@ public:
         );
     }
 
+    // Checks the sequence shape without unpacking it, so that obviously malformed sequences can be
+    // rejected without throwing. Element types are still checked by unpack() only.
+    static inline
+    bool
+    conforms(const msgpack::object& source) {
+        #if defined(__GNUC__) && defined(HAVE_GCC46)
+            #pragma GCC diagnostic push
+            #pragma GCC diagnostic ignored "-Wtype-limits"
+        #endif
+
+        return source.type == msgpack::type::ARRAY && source.via.array.size >= minimal;
+
+        #if defined(__GNUC__) && defined(HAVE_GCC46)
+            #pragma GCC diagnostic pop
+        #endif
+    }
+
     template<class... Args>
     static inline
     void
@@ -252,20 +299,37 @@ private:
     void
     pack_sequence(msgpack::packer<Stream>& target, const Head& head, const Tail&... tail) {
         typedef typename pristine<Head>::type type;
-        typedef typename details::unwrap_type<typename boost::mpl::deref<It>::type>::type unwrapped_type;
+        typedef typename boost::mpl::deref<It>::type element_type;
 
         static_assert(
-            std::is_convertible<type, unwrapped_type>::value,
+            std::is_convertible<type, typename details::unwrap_type<element_type>::type>::value,
             "sequence element type mismatch"
         );
 
         // Pack the current element using the correct packer.
-        type_traits<unwrapped_type>::pack(target, head);
+        type_traits<typename details::pack_type<element_type>::type>::pack(target, head);
 
         // Recurse to the next element.
         pack_sequence<typename boost::mpl::next<It>::type>(target, tail...);
     }
 
+    template<class It>
+    static inline
+    size_t
+    size_sequence() {
+        return 0;
+    }
+
+    template<class It, class Head, class... Tail>
+    static inline
+    size_t
+    size_sequence(const Head& head, const Tail&... tail) {
+        typedef typename boost::mpl::deref<It>::type element_type;
+
+        return packed_size<typename details::pack_type<element_type>::type>(head) +
+            size_sequence<typename boost::mpl::next<It>::type>(tail...);
+    }
+
     template<class It, class SourceIterator>
     static inline
     void
@@ -310,6 +374,12 @@ struct type_traits<std::tuple<Args...>> {
         traits_type::template pack<sequence_type>(target, source);
     }
 
+    static inline
+    size_t
+    size(const std::tuple<Args...>& source) {
+        return traits_type::template size<sequence_type>(source);
+    }
+
     static inline
     void
     unpack(const msgpack::object& source, std::tuple<Args...>& target) {
@@ -347,6 +417,12 @@ struct type_traits<std::pair<T, U>> {
         traits_type::template pack<sequence_type>(target, source);
     }
 
+    static inline
+    size_t
+    size(const std::pair<T, U>& source) {
+        return traits_type::template size<sequence_type>(source);
+    }
+
     static inline
     void
     unpack(const msgpack::object& source, std::pair<T, U>& target) {
@@ -23,10 +23,88 @@
 
 #include "cocaine/traits.hpp"
 
+#include "cocaine/rpc/tags.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
 #include <vector>
 
 namespace cocaine { namespace io {
 
+namespace aux {
+
+template<class T>
+struct is_raw_packable:
+    public std::integral_constant<bool, std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>
+{ };
+
+// Arithmetic vectors packed as raw blobs of little-endian values. On little-endian hosts, both the
+// packing and the unpacking are just a memcpy().
+
+template<class T>
+struct raw_array_traits {
+    template<class Stream>
+    static inline
+    void
+    pack(msgpack::packer<Stream>& target, const std::vector<T>& source) {
+        const size_t size = source.size() * sizeof(T);
+
+        target.pack_raw(size);
+
+        if(!size) {
+            return;
+        }
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        target.pack_raw_body(reinterpret_cast<const char*>(source.data()), size);
+#else
+        std::vector<T> swapped(source);
+        char* ptr = reinterpret_cast<char*>(swapped.data());
+
+        for(size_t offset = 0; offset < size; offset += sizeof(T)) {
+            std::reverse(ptr + offset, ptr + offset + sizeof(T));
+        }
+
+        target.pack_raw_body(ptr, size);
+#endif
+    }
+
+    static inline
+    size_t
+    size(const std::vector<T>& source) {
+        return raw_header_size(source.size() * sizeof(T)) + source.size() * sizeof(T);
+    }
+
+    static inline
+    void
+    unpack(const msgpack::object& source, std::vector<T>& target) {
+        const size_t size = source.via.raw.size;
+
+        if(size % sizeof(T) != 0) {
+            throw msgpack::type_error();
+        }
+
+        target.resize(size / sizeof(T));
+
+        if(!size) {
+            return;
+        }
+
+        char* ptr = reinterpret_cast<char*>(target.data());
+
+        std::memcpy(ptr, source.via.raw.ptr, size);
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+        for(size_t offset = 0; offset < size; offset += sizeof(T)) {
+            std::reverse(ptr + offset, ptr + offset + sizeof(T));
+        }
+#endif
+    }
+};
+
+} // namespace aux
+
 template<class T>
 struct type_traits<std::vector<T>> {
     template<class Stream>
@@ -40,19 +118,85 @@ struct type_traits<std::vector<T>> {
         }
     }
 
+    static inline
+    size_t
+    size(const std::vector<T>& source) {
+        size_t result = aux::array_header_size(source.size());
+
+        if(aux::fixed_size<T>::value) {
+            return result + source.size() * aux::fixed_size<T>::value;
+        }
+
+        for(auto it = source.begin(); it != source.end(); ++it) {
+            result += packed_size<T>(*it);
+        }
+
+        return result;
+    }
+
     static inline
     void
     unpack(const msgpack::object& source, std::vector<T>& target) {
+        if(source.type == msgpack::type::RAW) {
+            return unpack(source, target, aux::is_raw_packable<T>());
+        }
+
         if(source.type != msgpack::type::ARRAY) {
             throw msgpack::type_error();
         }
 
-        target.assign(source.via.array.size, T());
+        // NOTE: Elements are constructed in place and then unpacked into, instead of being copied
+        // from a prototype element first.
+        target.clear();
+        target.reserve(source.via.array.size);
 
         for(size_t i = 0; i < source.via.array.size; ++i) {
-            type_traits<T>::unpack(source.via.array.ptr[i], target[i]);
+            target.emplace_back();
+            type_traits<T>::unpack(source.via.array.ptr[i], target.back());
         }
     }
+
+private:
+    static inline
+    void
+    unpack(const msgpack::object& source, std::vector<T>& target, std::true_type) {
+        aux::raw_array_traits<T>::unpack(source, target);
+    }
+
+    static inline
+    void
+    unpack(const msgpack::object&, std::vector<T>&, std::false_type) {
+        throw msgpack::type_error();
+    }
+};
+
+// Opt-in raw encoding for arithmetic vectors, see io::raw<T>.
+
+template<class T>
+struct type_traits<raw<std::vector<T>>> {
+    static_assert(
+        aux::is_raw_packable<T>::value,
+        "only arithmetic vectors can be packed as raw blobs"
+    );
+
+    template<class Stream>
+    static inline
+    void
+    pack(msgpack::packer<Stream>& target, const std::vector<T>& source) {
+        aux::raw_array_traits<T>::pack(target, source);
+    }
+
+    static inline
+    size_t
+    size(const std::vector<T>& source) {
+        return aux::raw_array_traits<T>::size(source);
+    }
+
+    static inline
+    void
+    unpack(const msgpack::object& source, std::vector<T>& target) {
+        type_traits<std::vector<T>>::unpack(source, target);
+    }
 };
 
 }} // namespace cocaine::io
@@ -84,7 +84,10 @@ actor_t::accept_action_t::finalize(const std::error_code& ec) {
         COCAINE_LOG_DEBUG(parent->m_log, "accepted connection on fd %d", ptr->native_handle());
 
         try {
-            parent->m_context.engine().attach(std::move(ptr), parent->m_prototype);
+            const auto& compression = parent->m_context.config.network.compression;
+
+            parent->m_context.engine(parent->m_prototype->name()).attach(std::move(ptr), parent->m_prototype,
+                compression.services.count(parent->m_prototype->name()) ? compression.threshold : 0);
         } catch(const std::system_error& e) {
             COCAINE_LOG_ERROR(parent->m_log, "unable to attach connection to engine: %s",
                 error::to_string(e));
@@ -186,11 +189,23 @@ actor_t::is_active() const {
     return static_cast<bool>(*m_acceptor.synchronize());
 }
 
+bool
+actor_t::is_shared() const {
+    return m_context.is_shared(*m_asio);
+}
+
 const basic_dispatch_t&
 actor_t::prototype() const {
     return *m_prototype;
 }
 
+std::map<std::string, uint64_t>
+actor_t::memory_usage() const {
+    return m_chamber.apply([](const std::unique_ptr<chamber_t>& ptr) {
+        return ptr ? ptr->memory_usage() : std::map<std::string, uint64_t>();
+    });
+}
+
 void
 actor_t::run() {
     m_acceptor.apply([this](std::unique_ptr<tcp::acceptor>& ptr) {
@@ -218,18 +233,32 @@ actor_t::run() {
         std::make_shared<accept_action_t>(this)
     ));
 
+    if(is_shared()) {
+        // The shared executor is already running, so there's no need for a thread of its own.
+        return;
+    }
+
     // The post() above won't be executed until this thread is started.
-    m_chamber = std::make_unique<chamber_t>(m_prototype->name(), m_asio);
+    *m_chamber.synchronize() = std::make_unique<chamber_t>(m_prototype->name(), m_asio);
 }
 
 void
 actor_t::terminate() {
-    // Do not wait for the service to finish all its stuff (like timers, etc). Graceful termination
-    // happens only in engine chambers, because that's where client connections are being handled.
-    m_asio->stop();
+    if(!is_shared()) {
+        // Do not wait for the service to finish all its stuff (like timers, etc). Graceful termination
+        // happens only in engine chambers, because that's where client connections are being handled.
+        m_asio->stop();
 
-    // Does not block, unlike the one in execution_unit_t's destructors.
-    m_chamber = nullptr;
+        // Does not block, unlike the one in execution_unit_t's destructors. The chamber is destroyed
+        // outside of the lock to keep memory usage observers from waiting for the thread to join.
+        std::unique_ptr<chamber_t> chamber;
+
+        std::swap(chamber, *m_chamber.synchronize());
+    }
+
+    // NOTE: Other services keep running on a shared executor, so it's left alone. The pending accept
+    // operation is aborted when the acceptor is destroyed below, and its handler doesn't touch the
+    // actor in that case. The executor itself is stopped by the context on shutdown.
 
     m_acceptor.apply([this](std::unique_ptr<tcp::acceptor>& ptr) {
         std::error_code ec;
@@ -240,8 +269,10 @@ actor_t::terminate() {
         ptr = nullptr;
     });
 
-    // Be ready to restart the actor.
-    m_asio->reset();
+    if(!is_shared()) {
+        // Be ready to restart the actor.
+        m_asio->reset();
+    }
 
     // Mark this service's port as free.
     m_context.mapper.retain(m_prototype->name());
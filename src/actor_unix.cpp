@@ -53,7 +53,8 @@ private:
 
             try {
                 auto base = parent->fact();
-                auto session = parent->m_context.engine().attach(std::move(ptr), base);
+                auto& engine = parent->m_context.engine(parent->m_prototype->name());
+                auto session = engine.attach(std::move(ptr), base, 0);
                 parent->bind(base, std::move(session));
             } catch(const std::system_error& e) {
                 COCAINE_LOG_ERROR(parent->m_log, "unable to attach connection to engine: %s",
@@ -0,0 +1,130 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/detail/balancer.hpp"
+
+#include "cocaine/context.hpp"
+#include "cocaine/logging.hpp"
+
+#include "cocaine/detail/chamber.hpp"
+#include "cocaine/detail/engine.hpp"
+
+#include <asio/io_service.hpp>
+
+using namespace cocaine;
+using namespace cocaine::io;
+
+using namespace asio;
+
+class balancer_t::rebalance_action_t:
+    public std::enable_shared_from_this<rebalance_action_t>
+{
+    balancer_t *const parent;
+    const boost::posix_time::seconds repeat;
+
+public:
+    template<class Interval>
+    rebalance_action_t(balancer_t *const parent_, Interval repeat_):
+        parent(parent_),
+        repeat(repeat_)
+    { }
+
+    void
+    operator()();
+
+private:
+    void
+    finalize(const std::error_code& ec);
+};
+
+void
+balancer_t::rebalance_action_t::operator()() {
+    if(!parent->m_cron) {
+        return;
+    }
+
+    parent->m_cron->expires_from_now(repeat);
+
+    parent->m_cron->async_wait(std::bind(&rebalance_action_t::finalize,
+        shared_from_this(),
+        std::placeholders::_1
+    ));
+}
+
+namespace {
+
+struct utilization_t {
+    typedef std::unique_ptr<execution_unit_t> value_type;
+
+    bool
+    operator()(const value_type& lhs, const value_type& rhs) const {
+        return lhs->utilization() < rhs->utilization();
+    }
+};
+
+} // namespace
+
+void
+balancer_t::rebalance_action_t::finalize(const std::error_code& ec) {
+    if(ec == asio::error::operation_aborted) {
+        return;
+    }
+
+    const auto& pool = parent->m_pool;
+    const auto bounds = std::minmax_element(pool.begin(), pool.end(), utilization_t());
+
+    const double spread = (*bounds.second)->utilization() - (*bounds.first)->utilization();
+
+    if(spread >= parent->m_threshold) {
+        COCAINE_LOG_DEBUG(parent->m_log, "rebalancing execution units, load spread: %.2f%%", spread * 100);
+
+        (*bounds.second)->rebalance(**bounds.first);
+    }
+
+    operator()();
+}
+
+balancer_t::balancer_t(context_t& context, const std::vector<std::unique_ptr<execution_unit_t>>& pool):
+    m_pool(pool),
+    m_log(context.log("core/balancer")),
+    m_threshold(context.config.network.rebalance.threshold),
+    m_asio(new io_service()),
+    m_chamber(new chamber_t("core/balancer", m_asio)),
+    m_cron(new asio::deadline_timer(*m_asio))
+{
+    m_asio->post(std::bind(&rebalance_action_t::operator(),
+        std::make_shared<rebalance_action_t>(this, boost::posix_time::seconds(
+            context.config.network.rebalance.interval
+        ))
+    ));
+
+    COCAINE_LOG_DEBUG(m_log, "balancer started");
+}
+
+balancer_t::~balancer_t() {
+    m_asio->post([this] {
+        // NOTE: It's okay to destroy deadline timer here, because the rebalancing action always
+        // performs existence check for timer.
+        m_cron.reset();
+    });
+
+    // NOTE: This will block until all the outstanding operations are complete.
+    m_chamber = nullptr;
+}
@@ -31,18 +31,82 @@
 
 #include <sys/resource.h>
 
+#if defined(COCAINE_ALLOW_JEMALLOC)
+    #include "cocaine/format.hpp"
+
+    #include <cstring>
+    #include <iostream>
+
+    #include <jemalloc/jemalloc.h>
+#endif
+
 using namespace cocaine::io;
 
+#if defined(COCAINE_ALLOW_JEMALLOC)
+
+namespace {
+
+// Arenas can't be destroyed, so the ones left behind by stopped chambers are reused by new ones.
+cocaine::synchronized<std::vector<unsigned int>> retired_arenas;
+
+unsigned int
+acquire_arena() {
+    {
+        auto ptr = retired_arenas.synchronize();
+
+        if(!ptr->empty()) {
+            const auto arena = ptr->back();
+            ptr->pop_back();
+            return arena;
+        }
+    }
+
+    unsigned int arena = 0;
+    size_t size = sizeof(arena);
+
+#if JEMALLOC_VERSION_MAJOR >= 5
+    const int rv = ::mallctl("arenas.create", &arena, &size, nullptr, 0);
+#else
+    const int rv = ::mallctl("arenas.extend", &arena, &size, nullptr, 0);
+#endif
+
+    if(rv != 0) {
+        throw std::system_error(rv, std::system_category(), "unable to create an allocator arena");
+    }
+
+    return arena;
+}
+
+size_t
+arena_stat(unsigned int arena, const char* name) {
+    const auto key = cocaine::format("stats.arenas.%d.%s", arena, name);
+
+    size_t value = 0;
+    size_t size  = sizeof(value);
+
+    // NOTE: Statistics which are not available in this jemalloc build are reported as zeros.
+    ::mallctl(key.c_str(), &value, &size, nullptr, 0);
+
+    return value;
+}
+
+} // namespace
+
+#endif
+
 // Chamber internals
 
 class chamber_t::named_runnable_t {
     const std::string name;
     const std::shared_ptr<asio::io_service>& asio;
+    const boost::optional<unsigned int> arena;
 
 public:
-    named_runnable_t(const std::string& name_, const std::shared_ptr<asio::io_service>& asio_):
+    named_runnable_t(const std::string& name_, const std::shared_ptr<asio::io_service>& asio_,
+                     const boost::optional<unsigned int>& arena_):
         name(name_),
-        asio(asio_)
+        asio(asio_),
+        arena(arena_)
     { }
 
     void
@@ -61,6 +125,19 @@ chamber_t::named_runnable_t::operator()() const {
     pthread_setname_np(name.c_str());
 #endif
 
+#if defined(COCAINE_ALLOW_JEMALLOC)
+    if(arena) {
+        unsigned int index = *arena;
+
+        if(const int rv = ::mallctl("thread.arena", nullptr, nullptr, &index, sizeof(index))) {
+            // NOTE: Chambers don't have a logger of their own. The thread keeps allocating from its
+            // default arena, so its memory usage is reported as zeros instead.
+            std::cerr << cocaine::format("ERROR: unable to bind thread '%s' to arena %d - [%d] %s.",
+                name, index, rv, std::strerror(rv)) << std::endl;
+        }
+    }
+#endif
+
     asio->run();
 }
 
@@ -151,7 +228,11 @@ chamber_t::chamber_t(const std::string& name_, const std::shared_ptr<asio::io_se
     // Bootstrap the rolling mean to avoid showing NaNs to the first clients.
     (*load_acc1.synchronize())(0.0f);
 
-    thread = std::make_unique<boost::thread>(named_runnable_t(name, asio));
+#if defined(COCAINE_ALLOW_JEMALLOC)
+    arena = acquire_arena();
+#endif
+
+    thread = std::make_unique<boost::thread>(named_runnable_t(name, asio, arena));
 }
 
 chamber_t::~chamber_t() {
@@ -163,6 +244,10 @@ chamber_t::~chamber_t() {
     // NOTE: This might hang forever if io_service users have failed to abort their async operations
     // upon context.signals.shutdown signal (or haven't connected to it at all).
     thread->join();
+
+#if defined(COCAINE_ALLOW_JEMALLOC)
+    retired_arenas->push_back(*arena);
+#endif
 }
 
 std::string
@@ -174,3 +259,35 @@ chamber_t::thread_id() const {
 
     return stream.str();
 }
+
+auto
+chamber_t::memory_usage() const -> std::map<std::string, uint64_t> {
+    std::map<std::string, uint64_t> result;
+
+#if defined(COCAINE_ALLOW_JEMALLOC)
+    // Statistics are cached by jemalloc and refreshed only when the epoch is advanced.
+    uint64_t epoch = 1;
+    size_t size = sizeof(epoch);
+
+    ::mallctl("epoch", &epoch, &size, &epoch, size);
+
+    size_t page = 0;
+    size = sizeof(page);
+
+    ::mallctl("arenas.page", &page, &size, nullptr, 0);
+
+    result["allocated"] = arena_stat(*arena, "small.allocated") + arena_stat(*arena, "large.allocated");
+    result["active"]    = arena_stat(*arena, "pactive") * page;
+
+#if JEMALLOC_VERSION_MAJOR >= 5
+    result["resident"]  = arena_stat(*arena, "resident");
+#else
+    // Older versions have a separate class for huge allocations and don't track resident memory, so
+    // the mapped memory is the closest estimate.
+    result["allocated"] += arena_stat(*arena, "huge.allocated");
+    result["resident"]   = arena_stat(*arena, "mapped");
+#endif
+#endif
+
+    return result;
+}
@@ -0,0 +1,313 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/api/client.hpp"
+
+#include "cocaine/context.hpp"
+
+#include "cocaine/detail/engine.hpp"
+
+#include "cocaine/idl/locator.hpp"
+
+#include "cocaine/logging.hpp"
+
+#include "cocaine/rpc/actor.hpp"
+
+#include "cocaine/traits/endpoint.hpp"
+#include "cocaine/traits/graph.hpp"
+#include "cocaine/traits/vector.hpp"
+
+#include <asio/connect.hpp>
+
+using namespace cocaine;
+using namespace cocaine::api;
+
+using namespace asio;
+using namespace asio::ip;
+
+// Drops the session from the pool as soon as it's detached. It's the dispatch of a channel which is
+// never used to send anything, so it's only notified when the session discards its channels.
+
+class connector_t::uplink_sink_t:
+    public io::basic_dispatch_t
+{
+    const std::weak_ptr<connector_t> parent;
+    const std::weak_ptr<session_t> session;
+
+public:
+    uplink_sink_t(const std::string& name, const std::shared_ptr<connector_t>& parent_,
+                  const std::shared_ptr<session_t>& session_):
+        io::basic_dispatch_t(name + ":uplink"),
+        parent(parent_),
+        session(session_)
+    { }
+
+    virtual
+    boost::optional<io::dispatch_ptr_t>
+    process(const io::decoder_t::message_type& COCAINE_UNUSED_(message),
+            const io::upstream_ptr_t& COCAINE_UNUSED_(upstream)) const
+    {
+        throw std::system_error(cocaine::error::slot_not_found);
+    }
+
+    virtual
+    boost::optional<io::dispatch_ptr_t>
+    process(const io::decoder_t::message_type& COCAINE_UNUSED_(message),
+            const io::upstream_ptr_t& COCAINE_UNUSED_(upstream), std::error_code& ec) const
+    {
+        ec = cocaine::error::slot_not_found;
+        return boost::none;
+    }
+
+    virtual
+    void
+    discard(const std::error_code& COCAINE_UNUSED_(ec)) const {
+        const auto connector = parent.lock();
+        const auto ptr = session.lock();
+
+        if(connector && ptr) {
+            connector->drop(ptr);
+        }
+    }
+
+    virtual
+    auto
+    root() const -> const io::graph_root_t& {
+        static const io::graph_root_t protocol;
+        return protocol;
+    }
+
+    virtual
+    int
+    version() const {
+        return 1;
+    }
+};
+
+connector_t::connector_t(context_t& context, io_service& asio):
+    m_context(context),
+    m_asio(asio),
+    m_log(context.log("core/client"))
+{ }
+
+connector_t::~connector_t() {
+    m_uplinks.apply([](std::map<tcp::endpoint, uplink_t>& mapping) {
+        for(auto it = mapping.begin(); it != mapping.end(); ++it) {
+            if(it->second.session) it->second.session->detach(asio::error::operation_aborted);
+        }
+    });
+}
+
+io_service&
+connector_t::asio() {
+    return m_asio;
+}
+
+void
+connector_t::connect(const std::string& name, int version, handler_type handle) {
+    if(name == "locator") {
+        // NOTE: The Locator itself is never resolved, clients always use the local one.
+        if(const auto actor = m_context.locate(name)) {
+            return link(name, actor->endpoints(), std::move(handle));
+        } else {
+            return handle(cocaine::error::service_not_available, nullptr);
+        }
+    }
+
+    const auto now = boost::posix_time::microsec_clock::universal_time();
+
+    const auto cached = m_services.apply(
+        [&](const std::map<std::string, service_t>& mapping) -> boost::optional<service_t>
+    {
+        auto it = mapping.find(name);
+
+        if(it == mapping.end() || it->second.expiration < now) {
+            return boost::none;
+        }
+
+        return it->second;
+    });
+
+    if(cached) {
+        if(cached->version != static_cast<unsigned int>(version)) {
+            return handle(cocaine::error::version_mismatch, nullptr);
+        }
+
+        return link(name, cached->endpoints, std::move(handle));
+    }
+
+    typedef std::tuple<std::vector<tcp::endpoint>, unsigned int, io::graph_root_t> result_type;
+
+    const auto self = shared_from_this();
+
+    client<io::locator_tag>(self, "locator").invoke<io::locator::resolve>(
+        [=](const std::error_code& ec, const result_type& result)
+    {
+        if(ec) {
+            COCAINE_LOG_ERROR(m_log, "unable to resolve service '%s': [%d] %s", name, ec.value(),
+                ec.message());
+            return handle(ec, nullptr);
+        }
+
+        const service_t service = {
+            std::get<0>(result),
+            std::get<1>(result),
+            now + boost::posix_time::seconds(kCacheTimeout)
+        };
+
+        m_services.apply([&](std::map<std::string, service_t>& mapping) {
+            mapping[name] = service;
+        });
+
+        if(service.version != static_cast<unsigned int>(version)) {
+            return handle(cocaine::error::version_mismatch, nullptr);
+        }
+
+        self->link(name, service.endpoints, handle);
+    }, name, std::string());
+}
+
+void
+connector_t::pin(const std::string& name, int version, const std::vector<tcp::endpoint>& endpoints) {
+    const service_t service = {
+        endpoints,
+        static_cast<unsigned int>(version),
+        boost::posix_time::pos_infin
+    };
+
+    m_services.apply([&](std::map<std::string, service_t>& mapping) {
+        mapping[name] = service;
+    });
+}
+
+void
+connector_t::drop(const std::shared_ptr<session_t>& session) {
+    m_uplinks.apply([&](std::map<tcp::endpoint, uplink_t>& mapping) {
+        for(auto it = mapping.begin(); it != mapping.end(); /***/) {
+            if(it->second.session == session) {
+                it = mapping.erase(it);
+            } else {
+                it++;
+            }
+        }
+    });
+}
+
+void
+connector_t::link(const std::string& name, const std::vector<tcp::endpoint>& endpoints,
+                  handler_type handle)
+{
+    if(endpoints.empty()) {
+        return handle(cocaine::error::service_not_available, nullptr);
+    }
+
+    bool connecting = false;
+
+    const auto session = m_uplinks.apply(
+        [&](std::map<tcp::endpoint, uplink_t>& mapping) -> std::shared_ptr<session_t>
+    {
+        for(auto it = endpoints.begin(); it != endpoints.end(); ++it) {
+            auto uplink = mapping.find(*it);
+
+            if(uplink != mapping.end() && uplink->second.session) {
+                return uplink->second.session;
+            }
+        }
+
+        // NOTE: Connections in progress are keyed by the first endpoint, so that all the concurrent
+        // invocations wait for the same connection.
+        auto& uplink = mapping[endpoints.front()];
+
+        connecting = !uplink.pending.empty();
+        uplink.pending.push_back(std::move(handle));
+
+        return nullptr;
+    });
+
+    if(session) {
+        return handle(std::error_code(), session);
+    }
+
+    if(connecting) {
+        return;
+    }
+
+    const auto self = shared_from_this();
+
+    const auto socket = std::make_shared<tcp::socket>(m_asio);
+    const auto routes = std::make_shared<std::vector<tcp::endpoint>>(endpoints);
+
+    asio::async_connect(*socket, routes->begin(), routes->end(),
+        [=](const std::error_code& ec, std::vector<tcp::endpoint>::const_iterator endpoint)
+    {
+        std::error_code result = ec;
+        std::shared_ptr<session_t> session;
+
+        if(!ec) {
+            const auto& compression = m_context.config.network.compression;
+
+            try {
+                session = m_context.engine().attach(std::make_unique<tcp::socket>(std::move(*socket)),
+                    nullptr, compression.services.count(name) ? compression.threshold : 0);
+            } catch(const std::system_error& e) {
+                result = e.code();
+            }
+        }
+
+        if(result) {
+            COCAINE_LOG_ERROR(m_log, "unable to connect to service '%s': [%d] %s", name, result.value(),
+                result.message());
+
+            // Resolve the service again next time, its endpoints might have changed. Pinned ones are
+            // kept, as there's nothing to resolve them with.
+            m_services.apply([&](std::map<std::string, service_t>& mapping) {
+                auto it = mapping.find(name);
+
+                if(it != mapping.end() && !it->second.expiration.is_pos_infinity()) {
+                    mapping.erase(it);
+                }
+            });
+        } else {
+            COCAINE_LOG_DEBUG(m_log, "connected to service '%s' via %s", name, *endpoint);
+        }
+
+        std::vector<handler_type> pending;
+
+        self->m_uplinks.apply([&](std::map<tcp::endpoint, uplink_t>& mapping) {
+            pending.swap(mapping[routes->front()].pending);
+
+            if(!session) {
+                mapping.erase(routes->front());
+                return;
+            }
+
+            mapping[routes->front()].session = session;
+            mapping[*endpoint].session = session;
+        });
+
+        if(session) {
+            session->fork(std::make_shared<uplink_sink_t>(name, self, session));
+        }
+
+        for(auto it = pending.begin(); it != pending.end(); ++it) {
+            (*it)(result, session);
+        }
+    });
+}
@@ -235,7 +235,7 @@ multicast_t::on_receive(const std::error_code& ec, size_t bytes_received,
         auto& expiration = m_expirations[uuid];
 
         if(!expiration) {
-            expiration = std::make_unique<deadline_timer>(m_locator.asio());
+            expiration = std::make_unique<wheel_timer_t>(m_locator.asio());
 
             // Link a new node only when seen for the first time.
             m_locator.link_node(uuid, endpoints);
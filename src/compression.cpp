@@ -0,0 +1,132 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/rpc/asio/compression.hpp"
+
+#include "cocaine/errors.hpp"
+
+#include <limits>
+
+#include <zlib.h>
+
+using namespace cocaine::io;
+
+namespace {
+
+const size_t kChunkSize = 16384;
+
+template<class Stream>
+void
+process(Stream& stream, int (*step)(z_streamp, int), int flush, std::vector<char>& target,
+        size_t limit, std::error_code& ec)
+{
+    do {
+        const size_t offset = target.size();
+
+        target.resize(offset + kChunkSize);
+
+        stream.next_out  = reinterpret_cast<Bytef*>(target.data() + offset);
+        stream.avail_out = kChunkSize;
+
+        const int rv = step(&stream, flush);
+
+        target.resize(target.size() - stream.avail_out);
+
+        if(rv != Z_OK && rv != Z_BUF_ERROR) {
+            ec = cocaine::error::compression_error;
+            return;
+        }
+
+        if(target.size() > limit) {
+            ec = cocaine::error::frame_format_error;
+            return;
+        }
+
+        // NOTE: Output buffer filled completely means that there might be more pending output.
+    } while(stream.avail_out == 0);
+}
+
+} // namespace
+
+// Deflater
+
+struct deflater_t::stream_t:
+    public z_stream
+{ };
+
+deflater_t::deflater_t():
+    m_stream(new stream_t())
+{
+    if(deflateInit(m_stream.get(), Z_DEFAULT_COMPRESSION) != Z_OK) {
+        throw std::system_error(error::compression_error, "unable to initialize deflate stream");
+    }
+}
+
+deflater_t::~deflater_t() {
+    deflateEnd(m_stream.get());
+}
+
+void
+deflater_t::deflate(const char* data, size_t size, std::vector<char>& target, std::error_code& ec) {
+    m_stream->next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    m_stream->avail_in = size;
+
+    process(*m_stream, &::deflate, Z_NO_FLUSH, target, std::numeric_limits<size_t>::max(), ec);
+}
+
+void
+deflater_t::flush(std::vector<char>& target, std::error_code& ec) {
+    m_stream->next_in  = nullptr;
+    m_stream->avail_in = 0;
+
+    process(*m_stream, &::deflate, Z_SYNC_FLUSH, target, std::numeric_limits<size_t>::max(), ec);
+}
+
+// Inflater
+
+struct inflater_t::stream_t:
+    public z_stream
+{ };
+
+inflater_t::inflater_t():
+    m_stream(new stream_t())
+{
+    if(inflateInit(m_stream.get()) != Z_OK) {
+        throw std::system_error(error::compression_error, "unable to initialize inflate stream");
+    }
+}
+
+inflater_t::~inflater_t() {
+    inflateEnd(m_stream.get());
+}
+
+void
+inflater_t::inflate(const char* data, size_t size, std::vector<char>& target, size_t limit,
+                    std::error_code& ec)
+{
+    m_stream->next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    m_stream->avail_in = size;
+
+    process(*m_stream, &::inflate, Z_SYNC_FLUSH, target, limit, ec);
+
+    if(!ec && m_stream->avail_in != 0) {
+        ec = cocaine::error::compression_error;
+    }
+}
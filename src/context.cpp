@@ -22,6 +22,8 @@
 
 #include "cocaine/api/service.hpp"
 
+#include "cocaine/detail/balancer.hpp"
+#include "cocaine/detail/chamber.hpp"
 #include "cocaine/detail/engine.hpp"
 #include "cocaine/detail/essentials.hpp"
 
@@ -57,7 +59,7 @@ context_t::context_t(config_t config_, std::unique_ptr<logging::log_t> log_):
     essentials::initialize(*m_repository);
 
     // Load the rest of plugins.
-    m_repository->load(config.path.plugins);
+    m_repository->load(config.path.plugins, config.path.runtime + "/plugins.cache");
 
     // Spin up all the configured services, launch execution units.
     bootstrap();
@@ -122,6 +124,11 @@ context_t::insert(const std::string& name, std::unique_ptr<actor_t> service) {
 
 std::unique_ptr<actor_t>
 context_t::remove(const std::string& name) {
+    return withdraw(name, false);
+}
+
+std::unique_ptr<actor_t>
+context_t::withdraw(const std::string& name, bool force) {
     scoped_attributes_t guard(*m_log, attribute::set_t({logging::keyword::source() = "core"}));
 
     std::unique_ptr<actor_t> service;
@@ -133,6 +140,13 @@ context_t::remove(const std::string& name) {
             throw cocaine::error_t("service '%s' doesn't exist", name);
         }
 
+        if(it->second->is_shared() && !force) {
+            // NOTE: The caller would be free to destroy the service right away, while its handlers
+            // might still be queued or running on the shared executor.
+            throw cocaine::error_t("service '%s' runs on a shared executor and can't be removed",
+                name);
+        }
+
         service = std::move(it->second); list.erase(it);
     });
 
@@ -167,6 +181,49 @@ context_t::locate(const std::string& name) const {
     return boost::optional<const actor_t&>(it->second->is_active(), *it->second);
 }
 
+std::map<std::string, std::map<std::string, uint64_t>>
+context_t::memory_usage() const {
+    std::map<std::string, std::map<std::string, uint64_t>> result;
+
+    for(size_t i = 0; i < m_pool.size(); ++i) {
+        auto usage = m_pool[i]->memory_usage();
+
+        if(!usage.empty()) {
+            result["core/asio/" + std::to_string(i)] = std::move(usage);
+        }
+    }
+
+    for(auto it = m_pools.begin(); it != m_pools.end(); ++it) {
+        for(size_t i = 0; i < it->second.size(); ++i) {
+            auto usage = it->second[i]->memory_usage();
+
+            if(!usage.empty()) {
+                result["core/asio/" + it->first + "/" + std::to_string(i)] = std::move(usage);
+            }
+        }
+    }
+
+    for(size_t i = 0; i < m_executors.size(); ++i) {
+        auto usage = m_executors[i].second->memory_usage();
+
+        if(!usage.empty()) {
+            result["core/executor/" + std::to_string(i)] = std::move(usage);
+        }
+    }
+
+    auto ptr = m_services.synchronize();
+
+    for(auto it = ptr->begin(); it != ptr->end(); ++it) {
+        auto usage = it->second->memory_usage();
+
+        if(!usage.empty()) {
+            result[it->first] = std::move(usage);
+        }
+    }
+
+    return result;
+}
+
 namespace {
 
 struct utilization_t {
@@ -180,11 +237,31 @@ struct utilization_t {
 
 } // namespace
 
+bool
+context_t::is_shared(const asio::io_service& asio) const {
+    return std::any_of(m_executors.begin(), m_executors.end(), [&asio](const executor_t& executor) {
+        return executor.first.get() == &asio;
+    });
+}
+
 execution_unit_t&
 context_t::engine() {
     return **std::min_element(m_pool.begin(), m_pool.end(), utilization_t());
 }
 
+execution_unit_t&
+context_t::engine(const std::string& service) {
+    const auto it = config.engines.services.find(service);
+
+    if(it == config.engines.services.end()) {
+        return engine();
+    }
+
+    const auto& pool = m_pools.at(it->second);
+
+    return **std::min_element(pool.begin(), pool.end(), utilization_t());
+}
+
 void
 context_t::bootstrap() {
     COCAINE_LOG_INFO(m_log, "starting %d execution unit(s)", config.network.pool);
@@ -193,6 +270,33 @@ context_t::bootstrap() {
         m_pool.emplace_back(std::make_unique<execution_unit_t>(*this));
     }
 
+    for(auto it = config.engines.pools.begin(); it != config.engines.pools.end(); ++it) {
+        COCAINE_LOG_INFO(m_log, "starting %d execution unit(s) for pool '%s'", it->second, it->first);
+
+        auto& pool = m_pools[it->first];
+
+        while(pool.size() != it->second) {
+            pool.emplace_back(std::make_unique<execution_unit_t>(*this));
+        }
+    }
+
+    // NOTE: Only the shared pool is rebalanced, moving sessions into or out of the dedicated pools
+    // would defeat their purpose.
+    if(config.network.rebalance.interval && m_pool.size() > 1) {
+        m_balancer = std::make_unique<balancer_t>(*this, m_pool);
+    }
+
+    if(config.network.executors) {
+        COCAINE_LOG_INFO(m_log, "starting %d shared service executor(s)", config.network.executors);
+    }
+
+    while(m_executors.size() != config.network.executors) {
+        const auto asio = std::make_shared<asio::io_service>();
+        const auto name = "core/executor/" + std::to_string(m_executors.size());
+
+        m_executors.emplace_back(asio, std::make_unique<io::chamber_t>(name, asio));
+    }
+
     COCAINE_LOG_INFO(m_log, "starting %d service(s)", config.services.size());
 
     std::vector<std::string> errored;
@@ -200,7 +304,10 @@ context_t::bootstrap() {
     for(auto it = config.services.begin(); it != config.services.end(); ++it) {
         scoped_attributes_t attributes(*m_log, {attribute::make("service", it->first)});
 
-        const auto asio = std::make_shared<asio::io_service>();
+        // Services are spread over the shared executors in a round-robin fashion, if enabled.
+        const auto asio = m_executors.empty() ?
+            std::make_shared<asio::io_service>() :
+            m_executors[std::distance(config.services.begin(), it) % m_executors.size()].first;
 
         COCAINE_LOG_DEBUG(m_log, "starting service");
 
@@ -256,7 +363,7 @@ context_t::terminate() {
 
     for(auto it = config.services.rbegin(); it != config.services.rend(); ++it) {
         try {
-            actors.push_back(remove(it->first));
+            actors.push_back(withdraw(it->first, true));
         } catch(...) {
             // A service might be absent because it has failed to start during the bootstrap.
             continue;
@@ -267,9 +374,23 @@ context_t::terminate() {
     // app invocation services from the node service, should be dead by now.
     BOOST_ASSERT(m_services->empty());
 
+    if(!m_executors.empty()) {
+        COCAINE_LOG_INFO(m_log, "stopping %d shared service executor(s)", m_executors.size());
+    }
+
+    // Do not wait for the services to finish all their stuff, same as with dedicated service threads.
+    for(auto it = m_executors.begin(); it != m_executors.end(); ++it) {
+        it->first->stop();
+    }
+
+    m_executors.clear();
+
     COCAINE_LOG_INFO(m_log, "stopping %d execution unit(s)", m_pool.size());
 
+    // The balancer looks at the execution units, so it has to be stopped first.
+    m_balancer = nullptr;
     m_pool.clear();
+    m_pools.clear();
 
     // Destroy the service objects.
     actors.clear();
@@ -389,6 +389,15 @@ config_t::config_t(const std::string& source) {
         throw cocaine::error_t("network I/O pool size must be positive");
     }
 
+    const auto executors = network_config.at("executors", defaults::service_executors);
+
+    if(executors.is_bool()) {
+        // Shared executors are sized to the number of cores, unless specified explicitly.
+        network.executors = executors.as_bool() ? boost::thread::hardware_concurrency() : 0;
+    } else {
+        network.executors = executors.as_uint();
+    }
+
     if(network_config.count("pinned")) {
         network.ports.pinned = network_config.at("pinned").to<decltype(network.ports.pinned)>();
     }
@@ -397,6 +406,61 @@ config_t::config_t(const std::string& source) {
         network.ports.shared = network_config.at("shared").to<decltype(network.ports.shared)>();
     }
 
+    const auto compression_config = network_config.at("compression", dynamic_t::empty_object).as_object();
+
+    network.compression.services  = compression_config.at("services", dynamic_t::array_t())
+        .to<decltype(network.compression.services)>();
+    network.compression.threshold = compression_config.at("threshold", defaults::compression_threshold)
+        .as_uint();
+
+    const auto headers_config = network_config.at("headers", dynamic_t::empty_object).as_object();
+
+    network.headers.capacity = headers_config.at("capacity", defaults::header_table_capacity)
+        .as_uint();
+
+    if(network.headers.capacity > defaults::header_table_capacity) {
+        throw cocaine::error_t("header table capacity must not exceed %d bytes",
+            defaults::header_table_capacity);
+    }
+
+    const auto frames_config = network_config.at("frames", dynamic_t::empty_object).as_object();
+
+    network.frames.limit = frames_config.at("limit", defaults::frame_size_limit).as_uint();
+
+    if(network.frames.limit == 0) {
+        throw cocaine::error_t("frame size limit must be positive");
+    }
+
+    network.frames.version = frames_config.at("version", defaults::frame_version).as_uint();
+
+    if(network.frames.version != 1 && network.frames.version != 2) {
+        throw cocaine::error_t("frame format version must be either 1 or 2");
+    }
+
+    const auto quantum_config = network_config.at("quantum", dynamic_t::empty_object).as_object();
+
+    network.quantum.messages = quantum_config.at("messages", defaults::quantum_messages).as_uint();
+    network.quantum.bytes    = quantum_config.at("bytes", defaults::quantum_bytes).as_uint();
+
+    if(network.quantum.messages == 0 || network.quantum.bytes == 0) {
+        throw cocaine::error_t("network I/O quantum must be positive");
+    }
+
+    const auto rebalance_config = network_config.at("rebalance", dynamic_t::empty_object).as_object();
+
+    network.rebalance.interval  = rebalance_config.at("interval", defaults::rebalance_interval)
+        .as_uint();
+    network.rebalance.threshold = rebalance_config.at("threshold", defaults::rebalance_threshold)
+        .as_double();
+
+    const auto keepalive_config = network_config.at("keepalive", dynamic_t::empty_object).as_object();
+
+    network.keepalive.timeout   = keepalive_config.at("timeout", defaults::idle_timeout).as_uint();
+    network.keepalive.services  = keepalive_config.at("services", dynamic_t::empty_object)
+        .to<decltype(network.keepalive.services)>();
+    network.keepalive.heartbeat = keepalive_config.at("heartbeat", defaults::heartbeat_interval)
+        .as_uint();
+
     // Blackhole logging configuration
     logging = root.as_object().at("logging",  dynamic_t::empty_object).to<config_t::logging_t>();
 
@@ -404,6 +468,34 @@ config_t::config_t(const std::string& source) {
     services = root.as_object().at("services", dynamic_t::empty_object).to<config_t::component_map_t>();
     storages = root.as_object().at("storages", dynamic_t::empty_object).to<config_t::component_map_t>();
 
+    // Dedicated execution unit pools, e.g. "engines": {"pool": "critical", "size": 2}. Services can
+    // share a pool by naming the same one, by default every service gets a pool of its own.
+    const auto services_config = root.as_object().at("services", dynamic_t::empty_object).as_object();
+
+    for(auto it = services_config.begin(); it != services_config.end(); ++it) {
+        const auto engines_config = it->second.as_object().at("engines", dynamic_t::empty_object)
+            .as_object();
+
+        if(engines_config.empty()) {
+            continue;
+        }
+
+        const auto pool = engines_config.at("pool", it->first).as_string();
+        const auto size = engines_config.at("size", 1u).as_uint();
+
+        if(size <= 0) {
+            throw cocaine::error_t("execution unit pool '%s' size must be positive", pool);
+        }
+
+        const auto inserted = engines.pools.insert({pool, size});
+
+        if(!inserted.second && inserted.first->second != size) {
+            throw cocaine::error_t("execution unit pool '%s' is configured with different sizes", pool);
+        }
+
+        engines.services[it->first] = pool;
+    }
+
 #ifdef COCAINE_ALLOW_RAFT
     create_raft_cluster = false;
 #endif
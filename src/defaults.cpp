@@ -27,5 +27,23 @@ const std::string defaults::runtime_path  = "/var/run/cocaine";
 
 const std::string defaults::endpoint      = "::";
 
+const size_t defaults::compression_threshold = 1024;
+
+const size_t defaults::header_table_capacity = 4096;
+
+const size_t defaults::frame_size_limit = 64 * 1024 * 1024;
+const size_t defaults::frame_version    = 1;
+
+const size_t defaults::quantum_messages = 1;
+const size_t defaults::quantum_bytes    = 65536;
+
+const size_t defaults::rebalance_interval  = 0;
+const double defaults::rebalance_threshold = 0.25;
+
+const size_t defaults::idle_timeout       = 0;
+const size_t defaults::heartbeat_interval = 0;
+
+const size_t defaults::service_executors = 0;
+
 const std::string defaults::log_verbosity = "info";
 const std::string defaults::log_timestamp = "%Y-%m-%d %H:%M:%S.%f";
\ No newline at end of file
@@ -21,10 +21,12 @@
 #include "cocaine/detail/engine.hpp"
 
 #include "cocaine/context.hpp"
+#include "cocaine/defaults.hpp"
 #include "cocaine/logging.hpp"
 
 #include "cocaine/detail/chamber.hpp"
 
+#include "cocaine/rpc/asio/frame.hpp"
 #include "cocaine/rpc/asio/transport.hpp"
 #include "cocaine/rpc/session.hpp"
 
@@ -104,7 +106,16 @@ execution_unit_t::gc_action_t::finalize(const std::error_code& ec) {
 execution_unit_t::execution_unit_t(context_t& context):
     m_asio(new io_service()),
     m_chamber(new chamber_t("core/asio", m_asio)),
+    m_gate(std::make_shared<synchronized<bool>>(true)),
     m_log(context.log("core/asio", {{"engine", m_chamber->thread_id()}})),
+    m_table_capacity(context.config.network.headers.capacity),
+    m_frame_limit(context.config.network.frames.limit),
+    m_frame_version(context.config.network.frames.version),
+    m_quantum_messages(context.config.network.quantum.messages),
+    m_quantum_bytes(context.config.network.quantum.bytes),
+    m_idle_timeout(context.config.network.keepalive.timeout),
+    m_idle_timeouts(context.config.network.keepalive.services),
+    m_heartbeat(context.config.network.keepalive.heartbeat),
     m_cron(new asio::deadline_timer(*m_asio))
 {
     m_asio->post(std::bind(&gc_action_t::operator(),
@@ -115,6 +126,10 @@ execution_unit_t::execution_unit_t(context_t& context):
 }
 
 execution_unit_t::~execution_unit_t() {
+    // NOTE: Sessions being moved here are registered before the gate is closed, so they are detached
+    // below along with the others.
+    *m_gate->synchronize() = false;
+
     m_asio->post([this] {
         COCAINE_LOG_DEBUG(m_log, "stopping engine");
 
@@ -130,11 +145,16 @@ execution_unit_t::~execution_unit_t() {
 
     // NOTE: This will block until all the outstanding operations are complete.
     m_chamber = nullptr;
+
+    // NOTE: Sessions detached from other threads after the reactor has stopped leave their channel
+    // discards queued in it. The reactor thread is gone, so it's safe to run them here.
+    m_asio->reset();
+    m_asio->poll();
 }
 
 template<class Socket>
 std::shared_ptr<session<typename Socket::protocol_type>>
-execution_unit_t::attach(std::unique_ptr<Socket> ptr, const dispatch_ptr_t& dispatch) {
+execution_unit_t::attach(std::unique_ptr<Socket> ptr, const dispatch_ptr_t& dispatch, size_t compression) {
     typedef Socket socket_type;
     typedef typename socket_type::protocol_type protocol_type;
     typedef session<protocol_type> session_type;
@@ -178,6 +198,35 @@ execution_unit_t::attach(std::unique_ptr<Socket> ptr, const dispatch_ptr_t& disp
 
         // Create a new inactive session.
         session_ = std::make_shared<session_type>(std::move(log), std::move(transport), dispatch);
+
+        if(compression) {
+            session_->compress(compression);
+        }
+
+        if(m_table_capacity != defaults::header_table_capacity) {
+            session_->header_table(m_table_capacity);
+        }
+
+        session_->limit(m_frame_limit);
+        session_->schedule(m_quantum_messages, m_quantum_bytes);
+
+        // Outgoing sessions, i.e. the ones without a dispatch, might be configured to use version 2
+        // frames right away, instead of waiting for the remote peer to switch to them first.
+        if(!dispatch && m_frame_version == frame_v2::version) {
+            session_->upgrade();
+        }
+
+        // Outgoing sessions have no dispatch and are owned by their users, so they never time out.
+        size_t timeout = 0;
+
+        if(dispatch) {
+            const auto it = m_idle_timeouts.find(dispatch->name());
+            timeout = it != m_idle_timeouts.end() ? it->second : m_idle_timeout;
+        }
+
+        if(timeout || m_heartbeat) {
+            session_->keepalive(timeout, m_heartbeat);
+        }
     } catch(const std::system_error& e) {
         throw std::system_error(e.code(), "client has disappeared while creating session");
     }
@@ -187,15 +236,87 @@ execution_unit_t::attach(std::unique_ptr<Socket> ptr, const dispatch_ptr_t& disp
     return session_;
 }
 
+void
+execution_unit_t::rebalance(execution_unit_t& target) {
+    // NOTE: The target might be destroyed before the session is moved, so only its reactor and gate
+    // are captured. The target itself is only touched in its own thread, while its gate is open.
+    const std::shared_ptr<io_service> asio = target.m_asio;
+    const std::shared_ptr<synchronized<bool>> gate = target.m_gate;
+
+    execution_unit_t *const unit = &target;
+
+    m_asio->post([this, asio, gate, unit] {
+        std::map<int, uint64_t> traffic;
+
+        auto candidate = m_sessions.end();
+        uint64_t peak = 0;
+
+        for(auto it = m_sessions.begin(); it != m_sessions.end(); ++it) {
+            // Sessions which went silent or kept writing since the previous round stay where they are.
+            it->second->stay();
+
+            const uint64_t handled = it->second->messages();
+            const uint64_t previous = m_traffic.count(it->first) ? m_traffic[it->first] : 0;
+
+            // NOTE: Session slots are reused because of system fd rotation, so the previous count
+            // might belong to some other session.
+            const uint64_t delta = handled >= previous ? handled - previous : handled;
+
+            if(delta > peak && it->second->movable()) {
+                candidate = it;
+                peak = delta;
+            }
+
+            traffic[it->first] = handled;
+        }
+
+        m_traffic.swap(traffic);
+
+        if(candidate == m_sessions.end()) {
+            return;
+        }
+
+        COCAINE_LOG_DEBUG(m_log, "migrating session with %d message(s) handled since last round", peak);
+
+        const int fd = candidate->first;
+        const std::weak_ptr<session_t> weak = candidate->second;
+
+        // Invoked from this unit's thread right before the session is switched to the new socket.
+        candidate->second->migrate(asio, [this, asio, gate, unit, fd, weak](int next) -> bool {
+            const auto session_ = weak.lock();
+
+            return gate->apply([&](bool& open) -> bool {
+                const auto it = m_sessions.find(fd);
+
+                if(!open || it == m_sessions.end() || it->second != session_) {
+                    // Either the target is being stopped or the session has been recycled.
+                    return false;
+                }
+
+                m_sessions.erase(it);
+
+                asio->post([unit, next, session_] { unit->m_sessions[next] = session_; });
+
+                return true;
+            });
+        });
+    });
+}
+
 double
 execution_unit_t::utilization() const {
     return m_chamber->load_avg1();
 }
 
+auto
+execution_unit_t::memory_usage() const -> std::map<std::string, uint64_t> {
+    return m_chamber->memory_usage();
+}
+
 template
 std::shared_ptr<session<ip::tcp>>
-execution_unit_t::attach(std::unique_ptr<ip::tcp::socket>, const dispatch_ptr_t&);
+execution_unit_t::attach(std::unique_ptr<ip::tcp::socket>, const dispatch_ptr_t&, size_t);
 
 template
 std::shared_ptr<session<local::stream_protocol>>
-execution_unit_t::attach(std::unique_ptr<local::stream_protocol::socket>, const dispatch_ptr_t&);
+execution_unit_t::attach(std::unique_ptr<local::stream_protocol::socket>, const dispatch_ptr_t&, size_t);
@@ -70,6 +70,12 @@ class transport_category_t:
             return "insufficient bytes provided to decode the message";
         if(code == cocaine::error::transport_errors::parse_error)
             return "unable to parse the incoming data";
+        if(code == cocaine::error::transport_errors::compression_error)
+            return "unable to process compressed data";
+        if(code == cocaine::error::transport_errors::idle_timeout)
+            return "session has been idle for too long";
+        if(code == cocaine::error::transport_errors::heartbeat_timeout)
+            return "remote peer has stopped replying to heartbeats";
 
         return "cocaine.rpc.transport error";
     }
@@ -101,6 +107,8 @@ class dispatch_category_t:
             return "no dispatch has been assigned for channel";
         if(code == cocaine::error::dispatch_errors::uncaught_error)
             return "uncaught invocation exception";
+        if(code == cocaine::error::dispatch_errors::deadline_expired)
+            return "invocation deadline has expired";
 
         return "cocaine.rpc.dispatch error";
     }
@@ -289,3 +297,10 @@ registrar::map(size_t id) -> const std::error_category& {
         }
     });
 }
+
+auto
+registrar::size() -> size_t {
+    return ptr.apply([&](const std::unique_ptr<impl_type>& impl) -> size_t {
+        return impl->mapping.size();
+    });
+}
@@ -28,6 +28,11 @@
 #include "cocaine/detail/service/storage.hpp"
 #include "cocaine/detail/storage/files.hpp"
 
+#if defined(COCAINE_ALLOW_RAFT)
+    #include "cocaine/detail/service/raft.hpp"
+    #include "cocaine/detail/storage/raft.hpp"
+#endif
+
 void
 cocaine::essentials::initialize(api::repository_t& repository) {
     repository.insert<cluster::multicast_t>("multicast");
@@ -37,4 +42,9 @@ cocaine::essentials::initialize(api::repository_t& repository) {
     repository.insert<service::logging_t>("logging");
     repository.insert<service::storage_t>("storage");
     repository.insert<storage::files_t>("files");
+
+#if defined(COCAINE_ALLOW_RAFT)
+    repository.insert<service::raft_t>("raft");
+    repository.insert<storage::raft_t>("raft");
+#endif
 }
@@ -228,6 +228,47 @@ header_table_t::data_capacity() const {
     return capacity;
 }
 
+void
+header_table_t::set_capacity(size_t value) {
+    if(value > max_data_capacity) {
+        throw std::system_error(
+            std::make_error_code(std::errc::invalid_argument),
+            "Header table capacity exceeds the maximum allowed"
+        );
+    }
+
+    capacity = value;
+
+    while(data_size() > capacity && !empty()) {
+        pop();
+    }
+
+    if(header_data.empty() || header_data.size() >= capacity * 2) {
+        // Either nothing is allocated yet, or the current storage is large enough for the new capacity.
+        return;
+    }
+
+    // Storage is too small for the new capacity, so live entries are moved to a fresh one.
+    std::vector<header_t> live;
+    live.reserve(size() - header_static_table_t::size);
+
+    for(size_t idx = header_lower_bound; idx != header_upper_bound; idx = (idx + 1) % headers.size()) {
+        live.push_back(headers[idx]);
+    }
+
+    headers.clear();
+    headers.shrink_to_fit();
+    header_data.clear();
+    header_data.shrink_to_fit();
+
+    header_lower_bound = header_upper_bound = 0;
+    data_lower_bound = data_lower_bound_end = data_upper_bound = 0;
+
+    for(auto it = live.begin(); it != live.end(); ++it) {
+        push(*it);
+    }
+}
+
 bool
 header_table_t::empty() const {
     return data_lower_bound == data_upper_bound;
@@ -247,6 +288,10 @@ header_table_t::push(const header_t& result) {
         return;
     }
 
+    if(header_data.empty()) {
+        allocate();
+    }
+
     // Find the appropriate position in header table.
     char* dest = header_data.data();
     if(header_data.size() - data_upper_bound < header_size) {
@@ -308,6 +353,14 @@ header_table_t::pop() {
     }
 }
 
+void
+header_table_t::allocate() {
+    // Every entry takes at least 34 bytes, one more slot is needed so that a full circular buffer can
+    // be distinguished from an empty one.
+    headers.resize(capacity / (http2_header_overhead + 2) + 1);
+    header_data.resize(capacity * 2);
+}
+
 size_t
 header_table_t::find(const std::function<bool(const header_t&)> comp) {
     auto it = std::find_if(header_static_table_t::get_headers().begin(), header_static_table_t::get_headers().end(), comp);
@@ -324,8 +377,8 @@ header_table_t::find(const std::function<bool(const header_t&)> comp) {
         if(dyn_it != headers.data() + header_upper_bound) {
             return header_static_table_t::size + (dyn_it - headers.data());
         }
-        dyn_it = std::find_if(headers.data() + header_lower_bound, headers.end(), comp);
-        if(dyn_it != headers.end()) {
+        dyn_it = std::find_if(headers.data() + header_lower_bound, headers.data() + headers.size(), comp);
+        if(dyn_it != headers.data() + headers.size()) {
             return header_static_table_t::size + (dyn_it - (headers.data() + header_lower_bound));
         }
     }
@@ -334,7 +387,7 @@ header_table_t::find(const std::function<bool(const header_t&)> comp) {
 
 const header_t&
 header_table_t::operator[](size_t idx) {
-    if(idx == 0 || idx > headers.size() + header_static_table_t::size) {
+    if(idx == 0 || idx >= headers.size() + header_static_table_t::size) {
         throw std::out_of_range("Invalid index for header table");
     }
     if(idx < header_static_table_t::size) {
@@ -342,7 +395,7 @@ header_table_t::operator[](size_t idx) {
     }
     idx -= header_static_table_t::size;
     idx += header_lower_bound;
-    if(idx > headers.size()) {
+    if(idx >= headers.size()) {
         idx -= headers.size();
     }
     assert(header_upper_bound > header_lower_bound ?
@@ -0,0 +1,287 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/memory.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include <boost/thread/tss.hpp>
+
+using namespace cocaine::io;
+
+namespace {
+
+// Blocks are pooled in power of two size classes, from 16 bytes up to 4 KB, including the block
+// header. Larger blocks are rare enough to be left to the heap.
+
+const size_t kMinBlockShift = 4;
+const size_t kClassCount    = 9;
+
+// Upper bound on the amount of memory cached by every thread in each size class, the rest is freed.
+const size_t kMaxCachedBytes = 256 * 1024;
+
+size_t
+class_of(size_t size) {
+    size_t index = 0;
+
+    for(size = (size - 1) >> kMinBlockShift; size; size >>= 1) {
+        index++;
+    }
+
+    return index;
+}
+
+struct cache_t;
+
+// Every pooled block starts with a header, so that it can be given back to the cache it has been
+// allocated from, whichever thread frees it. The header is padded to keep the blocks aligned.
+
+struct header_t {
+    cache_t* owner;
+    size_t index;
+};
+
+const size_t kHeaderSize = 16;
+
+static_assert(sizeof(header_t) <= kHeaderSize, "block header doesn't fit into its padding");
+
+// Free blocks are linked through their bodies, the header stays intact.
+
+struct node_t {
+    node_t* next;
+};
+
+header_t*
+header_of(node_t* node) {
+    return reinterpret_cast<header_t*>(reinterpret_cast<char*>(node) - kHeaderSize);
+}
+
+node_t*
+node_of(header_t* header) {
+    return reinterpret_cast<node_t*>(reinterpret_cast<char*>(header) + kHeaderSize);
+}
+
+struct cache_t {
+    struct list_t {
+        node_t* head;
+        size_t  size;
+    };
+
+    list_t lists[kClassCount];
+    pool_stats_t stats;
+
+    // Blocks freed by other threads. They only push to the list, while the owning thread takes all
+    // of them at once, so there's no ABA problem.
+    std::atomic<node_t*> returned;
+
+    cache_t();
+
+    // Puts the block into its free list, or frees it, if there are enough blocks cached already.
+    void
+    push(node_t* node);
+
+    // Moves the blocks freed by other threads to the free lists.
+    void
+    reclaim();
+
+    // Frees all the cached blocks.
+    void
+    clear();
+};
+
+cache_t::cache_t():
+    lists(),
+    stats(),
+    returned(nullptr)
+{ }
+
+void
+cache_t::push(node_t* node) {
+    const size_t index = header_of(node)->index;
+
+    auto& list = lists[index];
+
+    if(list.size >= kMaxCachedBytes >> (index + kMinBlockShift)) {
+        return ::operator delete(header_of(node));
+    }
+
+    node->next = list.head;
+    list.head = node;
+    list.size++;
+}
+
+void
+cache_t::reclaim() {
+    node_t* node = returned.exchange(nullptr, std::memory_order_acquire);
+
+    while(node) {
+        node_t* next = node->next;
+        push(node);
+        node = next;
+    }
+}
+
+void
+cache_t::clear() {
+    reclaim();
+
+    for(size_t i = 0; i < kClassCount; ++i) {
+        while(node_t* node = lists[i].head) {
+            lists[i].head = node->next;
+            ::operator delete(header_of(node));
+        }
+
+        lists[i].size = 0;
+    }
+}
+
+// NOTE: The fast path goes through a plain thread-local pointer, while the thread-specific pointer
+// is only there to retire the cache once its thread exits.
+__thread cache_t* local = nullptr;
+
+// Caches of exited threads. Blocks allocated from them might still be in use and will be given back
+// to them eventually, so they are never deleted, but handed over to new threads instead.
+struct orphanage_t {
+    std::mutex mutex;
+    std::vector<cache_t*> caches;
+};
+
+orphanage_t&
+orphanage() {
+    // Intentionally leaked, as well as the caches, so that blocks freed by static destructors don't
+    // touch a dead object.
+    static auto* ptr = new orphanage_t();
+    return *ptr;
+}
+
+void
+retire(cache_t* cache) {
+    cache->clear();
+
+    // Blocks freed by this thread from now on are given back like the ones freed by other threads.
+    local = nullptr;
+
+    auto& shelter = orphanage();
+
+    std::lock_guard<std::mutex> guard(shelter.mutex);
+    shelter.caches.push_back(cache);
+}
+
+boost::thread_specific_ptr<cache_t>&
+registry() {
+    static auto* ptr = new boost::thread_specific_ptr<cache_t>(&retire);
+    return *ptr;
+}
+
+cache_t*
+adopt() {
+    cache_t* cache = nullptr;
+
+    {
+        auto& shelter = orphanage();
+
+        std::lock_guard<std::mutex> guard(shelter.mutex);
+
+        if(!shelter.caches.empty()) {
+            cache = shelter.caches.back();
+            shelter.caches.pop_back();
+        }
+    }
+
+    if(cache) {
+        cache->stats = pool_stats_t();
+    } else {
+        cache = new cache_t();
+    }
+
+    registry().reset(cache);
+
+    return cache;
+}
+
+} // namespace
+
+void*
+cocaine::io::aux::pool_allocate(size_t size) {
+    const size_t index = class_of(size + kHeaderSize);
+
+    if(index >= kClassCount) {
+        if(local) local->stats.heap++;
+        return ::operator new(size);
+    }
+
+    if(!local) {
+        local = adopt();
+    }
+
+    auto& list = local->lists[index];
+
+    if(!list.head) {
+        local->reclaim();
+    }
+
+    if(node_t* node = list.head) {
+        list.head = node->next;
+        list.size--;
+        local->stats.cached++;
+        return node;
+    }
+
+    local->stats.heap++;
+
+    auto header = static_cast<header_t*>(::operator new(size_t(1) << (index + kMinBlockShift)));
+
+    header->owner = local;
+    header->index = index;
+
+    return node_of(header);
+}
+
+void
+cocaine::io::aux::pool_deallocate(void* ptr, size_t size) {
+    if(class_of(size + kHeaderSize) >= kClassCount) {
+        return ::operator delete(ptr);
+    }
+
+    node_t* node = static_cast<node_t*>(ptr);
+    cache_t* owner = header_of(node)->owner;
+
+    if(owner == local) {
+        return owner->push(node);
+    }
+
+    // NOTE: Blocks freed by other threads are given back to the thread which has allocated them,
+    // e.g. payloads allocated by service threads and freed by reactor threads, so that the service
+    // threads don't keep going to the heap while the reactor threads fill their caches up.
+    node_t* head = owner->returned.load(std::memory_order_relaxed);
+
+    do {
+        node->next = head;
+    } while(!owner->returned.compare_exchange_weak(head, node, std::memory_order_release,
+        std::memory_order_relaxed));
+}
+
+pool_stats_t
+cocaine::io::pool_stats() {
+    return local ? local->stats : pool_stats_t();
+}
@@ -0,0 +1,336 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/detail/raft/journal.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace cocaine::raft;
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+// Files are written by the same host which reads them, so integers are stored in the native order.
+
+void
+put(std::string& target, uint64_t value) {
+    target.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+bool
+get(const std::string& source, size_t& offset, uint64_t& value) {
+    if(source.size() - offset < sizeof(value)) {
+        return false;
+    }
+
+    std::memcpy(&value, source.data() + offset, sizeof(value));
+    offset += sizeof(value);
+
+    return true;
+}
+
+void
+put(std::string& target, const entry_t& entry) {
+    put(target, entry.term);
+    put(target, entry.command.size());
+
+    target.append(entry.command);
+}
+
+void
+write_all(int fd, const std::string& data, const std::string& path) {
+    for(size_t offset = 0; offset < data.size();) {
+        const ssize_t written = ::write(fd, data.data() + offset, data.size() - offset);
+
+        if(written < 0) {
+            if(errno == EINTR) continue;
+            throw std::system_error(errno, std::system_category(),
+                "unable to write '" + path + "'");
+        }
+
+        offset += written;
+    }
+
+    if(::fsync(fd) != 0) {
+        throw std::system_error(errno, std::system_category(), "unable to sync '" + path + "'");
+    }
+}
+
+// Returns false if there's no such file.
+bool
+read_file(const std::string& path, std::string& result) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+
+    if(fd < 0) {
+        if(errno == ENOENT) return false;
+        throw std::system_error(errno, std::system_category(), "unable to open '" + path + "'");
+    }
+
+    char buffer[65536];
+    ssize_t size;
+
+    result.clear();
+
+    while((size = ::read(fd, buffer, sizeof(buffer))) != 0) {
+        if(size < 0) {
+            if(errno == EINTR) continue;
+
+            const int ec = errno;
+            ::close(fd);
+
+            throw std::system_error(ec, std::system_category(), "unable to read '" + path + "'");
+        }
+
+        result.append(buffer, size);
+    }
+
+    ::close(fd);
+
+    return true;
+}
+
+// Replaces the file atomically, so that it's never seen half-written after a crash.
+void
+replace_file(const std::string& path, const std::string& data) {
+    const auto temporary = path + ".tmp";
+    const int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if(fd < 0) {
+        throw std::system_error(errno, std::system_category(),
+            "unable to open '" + temporary + "'");
+    }
+
+    try {
+        write_all(fd, data, temporary);
+    } catch(...) {
+        ::close(fd);
+        throw;
+    }
+
+    ::close(fd);
+
+    if(::rename(temporary.c_str(), path.c_str()) != 0) {
+        throw std::system_error(errno, std::system_category(), "unable to replace '" + path + "'");
+    }
+}
+
+} // namespace
+
+journal_t::journal_t(const std::string& path):
+    m_path(path),
+    m_term(0),
+    m_snapshot_index(0),
+    m_snapshot_term(0),
+    m_log(-1)
+{
+    if(m_path.empty()) {
+        return;
+    }
+
+    fs::create_directories(m_path);
+
+    std::string data;
+    size_t offset = 0;
+
+    if(read_file(m_path + "/state", data)) {
+        if(!get(data, offset, m_term)) {
+            throw std::runtime_error("raft state file '" + m_path + "/state' is corrupted");
+        }
+
+        m_vote = data.substr(offset);
+    }
+
+    if(read_file(m_path + "/snapshot", data)) {
+        offset = 0;
+
+        if(!get(data, offset, m_snapshot_index) || !get(data, offset, m_snapshot_term)) {
+            throw std::runtime_error("raft snapshot file '" + m_path + "/snapshot' is corrupted");
+        }
+
+        m_snapshot = data.substr(offset);
+    }
+
+    if(read_file(m_path + "/log", data)) {
+        uint64_t index = 0;
+        offset = 0;
+
+        if(!get(data, offset, index)) {
+            index = m_snapshot_index;
+        }
+
+        // The log file might have a torn record at the end if the node has crashed while appending,
+        // which is fine since such an entry has never been acknowledged.
+        for(entry_t entry; offset < data.size(); ++index) {
+            uint64_t size;
+
+            if(!get(data, offset, entry.term) || !get(data, offset, size) ||
+               data.size() - offset < size)
+            {
+                break;
+            }
+
+            entry.command = data.substr(offset, size);
+            offset += size;
+
+            if(index + 1 > m_snapshot_index) {
+                // Entries covered by the snapshot are left over from an interrupted compaction.
+                m_entries.push_back(std::move(entry));
+            }
+        }
+    }
+
+    // Drop the torn records and the compacted entries, if any.
+    rewrite();
+}
+
+journal_t::~journal_t() {
+    if(m_log >= 0) {
+        ::close(m_log);
+    }
+}
+
+void
+journal_t::assign(uint64_t term, const std::string& vote) {
+    if(!m_path.empty()) {
+        std::string data;
+
+        put(data, term);
+        data.append(vote);
+
+        replace_file(m_path + "/state", data);
+    }
+
+    m_term = term;
+    m_vote = vote;
+}
+
+uint64_t
+journal_t::term(uint64_t index) const {
+    if(index == m_snapshot_index) {
+        return m_snapshot_term;
+    }
+
+    return at(index).term;
+}
+
+const entry_t&
+journal_t::at(uint64_t index) const {
+    if(index <= m_snapshot_index || index > last()) {
+        throw std::out_of_range("raft log index is out of range");
+    }
+
+    return m_entries[index - m_snapshot_index - 1];
+}
+
+void
+journal_t::append(const std::vector<entry_t>& entries) {
+    if(m_log >= 0) {
+        std::string data;
+
+        for(auto it = entries.begin(); it != entries.end(); ++it) {
+            put(data, *it);
+        }
+
+        write_all(m_log, data, m_path + "/log");
+    }
+
+    m_entries.insert(m_entries.end(), entries.begin(), entries.end());
+}
+
+void
+journal_t::truncate(uint64_t index) {
+    if(index <= m_snapshot_index) {
+        throw std::out_of_range("raft log index is out of range");
+    }
+
+    if(index > last()) {
+        return;
+    }
+
+    m_entries.resize(index - m_snapshot_index - 1);
+
+    rewrite();
+}
+
+void
+journal_t::compact(uint64_t index, uint64_t term, std::string snapshot) {
+    if(index <= m_snapshot_index) {
+        return;
+    }
+
+    if(!m_path.empty()) {
+        std::string data;
+
+        put(data, index);
+        put(data, term);
+        data.append(snapshot);
+
+        replace_file(m_path + "/snapshot", data);
+    }
+
+    if(index <= last() && this->term(index) == term) {
+        m_entries.erase(m_entries.begin(), m_entries.begin() + (index - m_snapshot_index));
+    } else {
+        m_entries.clear();
+    }
+
+    m_snapshot_index = index;
+    m_snapshot_term  = term;
+    m_snapshot       = std::move(snapshot);
+
+    rewrite();
+}
+
+void
+journal_t::rewrite() {
+    if(m_path.empty()) {
+        return;
+    }
+
+    std::string data;
+
+    put(data, m_snapshot_index);
+
+    for(auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        put(data, *it);
+    }
+
+    if(m_log >= 0) {
+        ::close(m_log);
+        m_log = -1;
+    }
+
+    replace_file(m_path + "/log", data);
+
+    if((m_log = ::open((m_path + "/log").c_str(), O_WRONLY | O_APPEND)) < 0) {
+        throw std::system_error(errno, std::system_category(),
+            "unable to open '" + m_path + "/log'");
+    }
+}
@@ -0,0 +1,405 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/detail/raft/node.hpp"
+
+#include <algorithm>
+
+using namespace cocaine::raft;
+
+node_t::node_t(const std::string& id, const std::vector<std::string>& peers,
+               const options_t& options, journal_t& journal, machine_t& machine,
+               transport_t& transport)
+:
+    m_id(id),
+    m_options(options),
+    m_journal(journal),
+    m_machine(machine),
+    m_transport(transport),
+    m_role(role_t::follower),
+    m_commit(journal.snapshot_index()),
+    m_applied(journal.snapshot_index()),
+    m_random(std::random_device()())
+{
+    for(auto it = peers.begin(); it != peers.end(); ++it) {
+        m_peers[*it] = peer_t{1, 0, 0};
+    }
+
+    if(m_journal.snapshot_index()) {
+        m_machine.restore(m_journal.snapshot_index(), m_journal.snapshot());
+    }
+
+    reset();
+}
+
+void
+node_t::tick(uint64_t elapsed) {
+    m_elapsed += elapsed;
+
+    if(m_role == role_t::leader) {
+        if(m_elapsed >= m_options.heartbeat) {
+            m_elapsed = 0;
+            replicate();
+        }
+    } else if(m_elapsed >= m_timeout) {
+        campaign();
+    }
+}
+
+uint64_t
+node_t::propose(const std::string& command) {
+    if(m_role != role_t::leader) {
+        return 0;
+    }
+
+    m_journal.append({entry_t{term(), command}});
+
+    // Single-node clusters commit right away.
+    advance();
+    replicate();
+
+    return m_journal.last();
+}
+
+vote_reply_t
+node_t::on_vote(const vote_request_t& request) {
+    if(request.term > term()) {
+        step_down(request.term);
+    }
+
+    const uint64_t last = m_journal.last();
+    const uint64_t last_term = m_journal.term(last);
+
+    // The candidate's log must be at least as up-to-date as this node's, so that committed entries
+    // never get lost in elections.
+    const bool recent = request.last_term > last_term ||
+                       (request.last_term == last_term && request.last_index >= last);
+
+    if(request.term < term() || !recent) {
+        return vote_reply_t{term(), false};
+    }
+
+    if(m_journal.vote().empty()) {
+        m_journal.assign(term(), request.candidate);
+    } else if(m_journal.vote() != request.candidate) {
+        return vote_reply_t{term(), false};
+    }
+
+    reset();
+
+    return vote_reply_t{term(), true};
+}
+
+append_reply_t
+node_t::on_append(const append_request_t& request) {
+    if(request.term < term()) {
+        return append_reply_t{term(), false, m_journal.last()};
+    }
+
+    step_down(request.term);
+
+    m_leader = request.leader;
+    reset();
+
+    uint64_t prev_index = request.prev_index;
+    auto entry = request.entries.begin();
+
+    if(prev_index < m_journal.snapshot_index()) {
+        // Entries covered by the snapshot are committed, so they match the leader's ones for sure.
+        const uint64_t covered = m_journal.snapshot_index() - prev_index;
+
+        if(covered >= request.entries.size()) {
+            return append_reply_t{term(), true, prev_index + request.entries.size()};
+        }
+
+        prev_index = m_journal.snapshot_index();
+        entry += covered;
+    } else if(prev_index > m_journal.last()) {
+        return append_reply_t{term(), false, m_journal.last()};
+    } else if(m_journal.term(prev_index) != request.prev_term) {
+        // Committed entries always match, so the leader can skip right to them.
+        return append_reply_t{term(), false, std::max(m_commit, prev_index - 1)};
+    }
+
+    uint64_t index = prev_index + 1;
+
+    // Skip the entries which are already in the log, and drop the conflicting ones.
+    for(; entry != request.entries.end() && index <= m_journal.last(); ++entry, ++index) {
+        if(m_journal.term(index) != entry->term) {
+            m_journal.truncate(index);
+            break;
+        }
+    }
+
+    if(entry != request.entries.end()) {
+        m_journal.append(std::vector<entry_t>(entry, request.entries.end()));
+    }
+
+    const uint64_t last = request.prev_index + request.entries.size();
+
+    if(request.commit > m_commit) {
+        m_commit = std::max(m_commit, std::min(request.commit, last));
+        apply();
+    }
+
+    return append_reply_t{term(), true, last};
+}
+
+install_reply_t
+node_t::on_install(const install_request_t& request) {
+    if(request.term < term()) {
+        return install_reply_t{term()};
+    }
+
+    step_down(request.term);
+
+    m_leader = request.leader;
+    reset();
+
+    if(request.index <= m_commit) {
+        return install_reply_t{term()};
+    }
+
+    m_journal.compact(request.index, request.last_term, request.snapshot);
+    m_machine.restore(request.index, request.snapshot);
+
+    m_commit  = request.index;
+    m_applied = request.index;
+
+    return install_reply_t{term()};
+}
+
+void
+node_t::on_vote_reply(const std::string& peer, const vote_reply_t& reply) {
+    if(reply.term > term()) {
+        return step_down(reply.term);
+    }
+
+    if(m_role != role_t::candidate || reply.term != term() || !reply.granted) {
+        return;
+    }
+
+    if(!m_peers.count(peer)) {
+        return;
+    }
+
+    m_votes.insert(peer);
+
+    if(m_votes.size() >= quorum()) {
+        lead();
+    }
+}
+
+void
+node_t::on_append_reply(const std::string& peer, const append_reply_t& reply) {
+    if(reply.term > term()) {
+        return step_down(reply.term);
+    }
+
+    auto it = m_peers.find(peer);
+
+    if(m_role != role_t::leader || reply.term != term() || it == m_peers.end()) {
+        return;
+    }
+
+    auto& state = it->second;
+
+    if(reply.success) {
+        state.match = std::max(state.match, reply.last_index);
+        state.next  = std::max(state.next, state.match + 1);
+
+        advance();
+
+        if(state.next > m_journal.last()) {
+            return;
+        }
+    } else {
+        // Replies might be reordered, so never go back past the entries known to be replicated.
+        state.next = std::max(state.match + 1, std::min(state.next - 1, reply.last_index + 1));
+    }
+
+    replicate(peer, state);
+}
+
+void
+node_t::on_install_reply(const std::string& peer, const install_reply_t& reply) {
+    if(reply.term > term()) {
+        return step_down(reply.term);
+    }
+
+    auto it = m_peers.find(peer);
+
+    if(m_role != role_t::leader || reply.term != term() || it == m_peers.end()) {
+        return;
+    }
+
+    auto& state = it->second;
+
+    if(!state.installing) {
+        return;
+    }
+
+    state.match = std::max(state.match, state.installing);
+    state.next  = std::max(state.next, state.match + 1);
+    state.installing = 0;
+
+    advance();
+
+    if(state.next <= m_journal.last()) {
+        replicate(peer, state);
+    }
+}
+
+void
+node_t::step_down(uint64_t term) {
+    if(term > this->term()) {
+        m_journal.assign(term, std::string());
+        m_leader.clear();
+    }
+
+    if(m_role != role_t::follower) {
+        m_role = role_t::follower;
+        m_votes.clear();
+
+        reset();
+    }
+}
+
+void
+node_t::campaign() {
+    m_journal.assign(term() + 1, m_id);
+
+    m_role = role_t::candidate;
+    m_leader.clear();
+
+    m_votes.clear();
+    m_votes.insert(m_id);
+
+    reset();
+
+    if(m_votes.size() >= quorum()) {
+        return lead();
+    }
+
+    const uint64_t last = m_journal.last();
+    const vote_request_t request = {term(), m_id, last, m_journal.term(last)};
+
+    for(auto it = m_peers.begin(); it != m_peers.end(); ++it) {
+        m_transport.vote(it->first, request);
+    }
+}
+
+void
+node_t::lead() {
+    m_role = role_t::leader;
+    m_leader = m_id;
+
+    m_votes.clear();
+
+    for(auto it = m_peers.begin(); it != m_peers.end(); ++it) {
+        it->second = peer_t{m_journal.last() + 1, 0, 0};
+    }
+
+    m_elapsed = 0;
+
+    // Entries from the previous terms can only be committed along with an entry from this term.
+    propose(std::string());
+}
+
+void
+node_t::replicate() {
+    for(auto it = m_peers.begin(); it != m_peers.end(); ++it) {
+        replicate(it->first, it->second);
+    }
+}
+
+void
+node_t::replicate(const std::string& name, peer_t& peer) {
+    if(peer.next <= m_journal.snapshot_index()) {
+        // The entries the peer needs are gone, so it has to catch up with the snapshot.
+        peer.installing = m_journal.snapshot_index();
+
+        return m_transport.install(name, install_request_t{
+            term(),
+            m_id,
+            m_journal.snapshot_index(),
+            m_journal.snapshot_term(),
+            m_journal.snapshot()
+        });
+    }
+
+    append_request_t request;
+
+    request.term       = term();
+    request.leader     = m_id;
+    request.prev_index = peer.next - 1;
+    request.prev_term  = m_journal.term(request.prev_index);
+    request.commit     = m_commit;
+
+    for(uint64_t index = peer.next; index <= m_journal.last(); ++index) {
+        if(request.entries.size() >= m_options.batch) {
+            break;
+        }
+
+        request.entries.push_back(m_journal.at(index));
+    }
+
+    m_transport.append(name, request);
+}
+
+void
+node_t::advance() {
+    for(uint64_t index = m_journal.last(); index > m_commit; --index) {
+        if(m_journal.term(index) != term()) {
+            // Entries from the previous terms are committed indirectly.
+            break;
+        }
+
+        size_t replicas = 1;
+
+        for(auto it = m_peers.begin(); it != m_peers.end(); ++it) {
+            if(it->second.match >= index) ++replicas;
+        }
+
+        if(replicas >= quorum()) {
+            m_commit = index;
+            apply();
+            break;
+        }
+    }
+}
+
+void
+node_t::apply() {
+    while(m_applied < m_commit) {
+        const auto& entry = m_journal.at(++m_applied);
+        m_machine.apply(m_applied, entry.term, entry.command);
+    }
+
+    if(m_options.compaction && m_applied - m_journal.snapshot_index() >= m_options.compaction) {
+        m_journal.compact(m_applied, m_journal.term(m_applied), m_machine.snapshot());
+    }
+}
+
+void
+node_t::reset() {
+    m_elapsed = 0;
+    m_timeout = m_options.election + m_random() % (m_options.election + 1);
+}
@@ -23,10 +23,14 @@
 #include <blackhole/scoped_attributes.hpp>
 
 #include <boost/filesystem/convenience.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/path.hpp>
 
 #include <boost/iterator/filter_iterator.hpp>
 
+#include <sstream>
+
 using namespace cocaine;
 using namespace cocaine::api;
 
@@ -62,6 +66,100 @@ typedef preconditions_t (*validation_fn_t)();
 // Plugin initialization function type.
 typedef void (*initialize_fn_t)(repository_t&);
 
+// Plugin cache. The first line is the core version along with the cache format revision, and every
+// other line describes a plugin with its path, its stamp, whether it registers any error categories
+// and the categories and names of the components it provides, separated by tabs.
+
+const char kCacheRevision[] = "2";
+
+typedef std::pair<std::string, std::string> component_t;
+
+struct cache_entry_t {
+    std::string stamp;
+    bool errors;
+    std::vector<component_t> components;
+};
+
+typedef std::map<std::string, cache_entry_t> plugin_cache_t;
+
+std::string
+stamp(const std::string& plugin) {
+    // Plugins are reloaded to rebuild their cache entries whenever they are replaced.
+    return std::to_string(fs::last_write_time(plugin)) + ":" + std::to_string(fs::file_size(plugin));
+}
+
+std::string
+header() {
+    return std::to_string(COCAINE_VERSION) + "\t" + kCacheRevision;
+}
+
+plugin_cache_t
+read_cache(const std::string& path) {
+    plugin_cache_t result;
+
+    fs::ifstream stream(path);
+    std::string line;
+
+    if(!std::getline(stream, line) || line != header()) {
+        // Component categories are identified by their type names, which might change between the
+        // core versions.
+        return result;
+    }
+
+    while(std::getline(stream, line)) {
+        std::istringstream fields(line);
+        std::string plugin, stamp, errors, id, name;
+
+        if(!std::getline(fields, plugin, '\t') ||
+           !std::getline(fields, stamp,  '\t') ||
+           !std::getline(fields, errors, '\t'))
+        {
+            continue;
+        }
+
+        auto& entry = result[plugin];
+
+        entry.stamp  = stamp;
+        entry.errors = errors != "0";
+
+        while(std::getline(fields, id, '\t') && std::getline(fields, name, '\t')) {
+            entry.components.emplace_back(id, name);
+        }
+    }
+
+    return result;
+}
+
+void
+write_cache(const std::string& path, const plugin_cache_t& cache) {
+    const auto temporary = path + ".tmp";
+
+    fs::ofstream stream(temporary, std::ios::trunc);
+
+    stream << header() << '\n';
+
+    for(auto it = cache.begin(); it != cache.end(); ++it) {
+        stream << it->first << '\t' << it->second.stamp << '\t' << (it->second.errors ? 1 : 0);
+
+        const auto& components = it->second.components;
+
+        for(auto component = components.begin(); component != components.end(); ++component) {
+            stream << '\t' << component->first << '\t' << component->second;
+        }
+
+        stream << '\n';
+    }
+
+    stream.close();
+
+    if(!stream) {
+        throw std::system_error(errno, std::system_category(), "unable to write the plugin cache");
+    }
+
+    // Replace the cache atomically, so that it's never seen half-written.
+    fs::rename(temporary, path);
+}
+
 } // namespace
 
 repository_t::repository_t(std::unique_ptr<logging::log_t> log):
@@ -82,7 +180,9 @@ repository_t::~repository_t() {
 }
 
 void
-repository_t::load(const std::string& path) {
+repository_t::load(const std::string& path, const std::string& cache) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+
     const auto status = fs::status(path);
 
     if(!fs::exists(status) || !fs::is_directory(status)) {
@@ -105,9 +205,86 @@ repository_t::load(const std::string& path) {
     // proper order as well, if they add any to the error registrar.
     std::sort(paths.begin(), paths.end());
 
-    std::for_each(paths.begin(), paths.end(), [this](const std::string& plugin) {
+    if(cache.empty()) {
+        std::for_each(paths.begin(), paths.end(), [this](const std::string& plugin) {
+            open(plugin);
+        });
+
+        return;
+    }
+
+    auto cached = read_cache(cache);
+
+    // Plugins which are gone since the cache has been written are dropped from it.
+    bool dirty = cached.size() != paths.size();
+
+    plugin_cache_t updated;
+
+    for(auto it = paths.begin(); it != paths.end(); ++it) {
+        const auto current = stamp(*it);
+        const auto entry = cached.find(*it);
+
+        if(entry == cached.end() || entry->second.stamp != current) {
+            dirty = true;
+        } else if(!entry->second.errors && !entry->second.components.empty()) {
+            const auto& components = entry->second.components;
+
+            for(auto component = components.begin(); component != components.end(); ++component) {
+                m_pending.insert({*component, *it});
+            }
+
+            COCAINE_LOG_DEBUG(m_log, "deferring plugin loading until its components are requested")(
+                "plugin", *it
+            );
+
+            m_manifest[*it] = std::move(entry->second.components);
+            updated[*it] = {current, false, m_manifest[*it]};
+
+            continue;
+        }
+
+        // Plugins which don't provide any components are always loaded, because they might do some
+        // other useful stuff in their initialization functions. Plugins which register any error
+        // categories are always loaded as well, right here in the sorted order, so that the error
+        // registrar sees their categories in the same order regardless of the requested components.
+        open(*it);
+
+        updated[*it] = {current, m_registrars.count(*it) != 0, m_manifest[*it]};
+    }
+
+    if(!dirty) {
+        return;
+    }
+
+    try {
+        write_cache(cache, updated);
+    } catch(const std::system_error& e) {
+        COCAINE_LOG_WARNING(m_log, "unable to update plugin cache: %s", error::to_string(e));
+    } catch(const fs::filesystem_error& e) {
+        COCAINE_LOG_WARNING(m_log, "unable to update plugin cache: %s", e.what());
+    }
+}
+
+factory_concept_t&
+repository_t::find(const std::string& id, const std::string& name) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    const auto pending = m_pending.find(component_t(id, name));
+
+    if(pending != m_pending.end()) {
+        // The plugin drops all its pending components when loaded, including this one.
+        const auto plugin = pending->second;
+
         open(plugin);
-    });
+    }
+
+    const auto category = m_categories.find(id);
+
+    if(category == m_categories.end() || !category->second.count(name)) {
+        throw std::system_error(error::component_not_found, name);
+    }
+
+    return *category->second.at(name);
 }
 
 void
@@ -150,18 +327,40 @@ repository_t::open(const std::string& target) {
     }
 
     if(initialize.ptr) {
+        // Keep track of the components registered by the plugin for the plugin cache.
+        m_loading = target;
+        m_manifest[target].clear();
+
+        const auto categories = error::registrar::size();
+
         try {
             initialize.call(*this);
         } catch(const std::system_error& e) {
+            m_loading.clear();
             COCAINE_LOG_ERROR(m_log, "unable to initialize plugin: %s", error::to_string(e));
             throw std::system_error(error::initialization_error);
         } catch(const std::exception& e) {
+            m_loading.clear();
             COCAINE_LOG_ERROR(m_log, "unable to initialize plugin: %s", e.what());
             throw std::system_error(error::initialization_error);
         }
+
+        m_loading.clear();
+
+        if(error::registrar::size() != categories) {
+            m_registrars.insert(target);
+        }
     } else {
         throw std::system_error(error::invalid_interface);
     }
 
     m_plugins.emplace_back(plugin.release());
+
+    for(auto it = m_pending.begin(); it != m_pending.end();) {
+        if(it->second == target) {
+            it = m_pending.erase(it);
+        } else {
+            ++it;
+        }
+    }
 }
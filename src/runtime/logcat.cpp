@@ -0,0 +1,423 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/common.hpp"
+#include "cocaine/format.hpp"
+
+#include "cocaine/detail/runtime/segment.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <ctime>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include <msgpack.hpp>
+
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+using namespace cocaine;
+
+namespace fs = boost::filesystem;
+namespace po = boost::program_options;
+
+namespace {
+
+typedef rapidjson::Writer<rapidjson::StringBuffer> json_writer_t;
+
+std::string
+to_string(const msgpack::object& object) {
+    return std::string(object.via.raw.ptr, object.via.raw.size);
+}
+
+void
+to_json(json_writer_t& writer, const msgpack::object& object) {
+    switch(object.type) {
+      case msgpack::type::NIL:
+        writer.Null();
+        break;
+      case msgpack::type::BOOLEAN:
+        writer.Bool(object.via.boolean);
+        break;
+      case msgpack::type::POSITIVE_INTEGER:
+        writer.Uint64(object.via.u64);
+        break;
+      case msgpack::type::NEGATIVE_INTEGER:
+        writer.Int64(object.via.i64);
+        break;
+      case msgpack::type::DOUBLE:
+        writer.Double(object.via.dec);
+        break;
+      case msgpack::type::RAW:
+        writer.String(object.via.raw.ptr, object.via.raw.size);
+        break;
+      case msgpack::type::ARRAY:
+        writer.StartArray();
+
+        for(size_t i = 0; i < object.via.array.size; ++i) {
+            to_json(writer, object.via.array.ptr[i]);
+        }
+
+        writer.EndArray();
+        break;
+      case msgpack::type::MAP:
+        writer.StartObject();
+
+        for(size_t i = 0; i < object.via.map.size; ++i) {
+            const auto& kv = object.via.map.ptr[i];
+
+            if(kv.key.type == msgpack::type::RAW) {
+                writer.String(kv.key.via.raw.ptr, kv.key.via.raw.size);
+            } else {
+                rapidjson::StringBuffer buffer;
+                json_writer_t nested(buffer);
+
+                to_json(nested, kv.key);
+                writer.String(buffer.GetString(), buffer.GetSize());
+            }
+
+            to_json(writer, kv.val);
+        }
+
+        writer.EndObject();
+        break;
+    }
+}
+
+// Strings are printed as is, everything else as JSON.
+std::string
+to_text(const msgpack::object& object) {
+    if(object.type == msgpack::type::RAW) {
+        return to_string(object);
+    }
+
+    rapidjson::StringBuffer buffer;
+    json_writer_t writer(buffer);
+
+    to_json(writer, object);
+
+    return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+// Timestamps are either microseconds since the epoch, fractional seconds or [seconds, microseconds]
+// pairs, depending on the formatter.
+std::string
+to_timestamp(const msgpack::object& object) {
+    uint64_t seconds = 0, microseconds = 0;
+
+    switch(object.type) {
+      case msgpack::type::POSITIVE_INTEGER:
+        seconds = object.via.u64 / 1000000;
+        microseconds = object.via.u64 % 1000000;
+        break;
+      case msgpack::type::DOUBLE:
+        seconds = static_cast<uint64_t>(object.via.dec);
+        microseconds = static_cast<uint64_t>((object.via.dec - seconds) * 1000000);
+        break;
+      case msgpack::type::ARRAY: {
+        const auto& array = object.via.array;
+
+        if(array.size != 2 || array.ptr[0].type != msgpack::type::POSITIVE_INTEGER
+                           || array.ptr[1].type != msgpack::type::POSITIVE_INTEGER)
+        {
+            return to_text(object);
+        }
+
+        seconds = array.ptr[0].via.u64;
+        microseconds = array.ptr[1].via.u64;
+      } break;
+      default:
+        return to_text(object);
+    }
+
+    const std::time_t time = seconds;
+    std::tm tm;
+    char buffer[64];
+
+    ::gmtime_r(&time, &tm);
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &tm);
+
+    return cocaine::format("%s.%06d", buffer, microseconds);
+}
+
+const char* const kSeverities[] = { "D", "I", "W", "E" };
+
+int
+to_severity(const std::string& name) {
+    if(name.size() == 1) {
+        for(size_t i = 0; i < sizeof(kSeverities) / sizeof(kSeverities[0]); ++i) {
+            if(std::toupper(name[0]) == kSeverities[i][0]) return i;
+            if(name[0] == '0' + static_cast<char>(i)) return i;
+        }
+    }
+
+    throw po::validation_error(po::validation_error::invalid_option_value, "severity", name);
+}
+
+struct filter_t {
+    int severity;
+    std::string source;
+    std::string message;
+    std::map<std::string, std::string> attributes;
+
+    bool
+    operator()(const std::map<std::string, const msgpack::object*>& record) const {
+        auto it = record.find("severity");
+
+        if(severity > 0) {
+            if(it == record.end() || it->second->type != msgpack::type::POSITIVE_INTEGER ||
+               it->second->via.u64 < static_cast<uint64_t>(severity))
+            {
+                return false;
+            }
+        }
+
+        if(!source.empty()) {
+            it = record.find("source");
+
+            if(it == record.end() || to_text(*it->second).compare(0, source.size(), source) != 0) {
+                return false;
+            }
+        }
+
+        if(!message.empty()) {
+            it = record.find("message");
+
+            if(it == record.end() || to_text(*it->second).find(message) == std::string::npos) {
+                return false;
+            }
+        }
+
+        for(auto attribute = attributes.begin(); attribute != attributes.end(); ++attribute) {
+            it = record.find(attribute->first);
+
+            if(it == record.end() || to_text(*it->second) != attribute->second) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
+
+// Prints the record as "[timestamp] [S] source: message, key: value, ...".
+void
+print_text(const std::map<std::string, const msgpack::object*>& record) {
+    std::ostringstream stream;
+
+    auto it = record.find("timestamp");
+
+    if(it != record.end()) {
+        stream << "[" << to_timestamp(*it->second) << "] ";
+    }
+
+    if((it = record.find("severity")) != record.end()) {
+        const auto& severity = *it->second;
+
+        if(severity.type == msgpack::type::POSITIVE_INTEGER && severity.via.u64 < 4) {
+            stream << "[" << kSeverities[severity.via.u64] << "] ";
+        } else {
+            stream << "[" << to_text(severity) << "] ";
+        }
+    }
+
+    if((it = record.find("source")) != record.end()) {
+        stream << to_text(*it->second) << ": ";
+    }
+
+    if((it = record.find("message")) != record.end()) {
+        stream << to_text(*it->second);
+    }
+
+    for(it = record.begin(); it != record.end(); ++it) {
+        if(it->first == "timestamp" || it->first == "severity" || it->first == "source" ||
+           it->first == "message")
+        {
+            continue;
+        }
+
+        stream << ", " << it->first << ": " << to_text(*it->second);
+    }
+
+    std::cout << stream.str() << '\n';
+}
+
+void
+print_json(const msgpack::object& object) {
+    rapidjson::StringBuffer buffer;
+    json_writer_t writer(buffer);
+
+    to_json(writer, object);
+
+    std::cout.write(buffer.GetString(), buffer.GetSize()) << '\n';
+}
+
+} // namespace
+
+int
+main(int argc, char* argv[]) {
+    po::options_description general_options("General options");
+    po::options_description hidden_options;
+    po::options_description options;
+    po::positional_options_description positional;
+    po::variables_map vm;
+
+    general_options.add_options()
+        ("help,h", "show this message")
+        ("json,j", "print the records as JSON objects, one per line")
+        ("severity,s", po::value<std::string>(), "minimal severity: D, I, W, E or 0-3")
+        ("source", po::value<std::string>(), "only the records from the sources with this prefix")
+        ("grep,g", po::value<std::string>(), "only the records with messages containing this")
+        ("attribute,a", po::value<std::vector<std::string>>(), "only the records with this "
+            "attribute value, as key=value");
+
+    hidden_options.add_options()
+        ("segments", po::value<std::vector<std::string>>());
+
+    positional.add("segments", -1);
+    options.add(general_options).add(hidden_options);
+
+    filter_t filter = {0, std::string(), std::string(), {}};
+
+    try {
+        po::store(po::command_line_parser(argc, argv).options(options).positional(positional).run(),
+            vm);
+        po::notify(vm);
+
+        if(vm.count("severity")) {
+            filter.severity = to_severity(vm["severity"].as<std::string>());
+        }
+
+        if(vm.count("attribute")) {
+            const auto attributes = vm["attribute"].as<std::vector<std::string>>();
+
+            for(auto it = attributes.begin(); it != attributes.end(); ++it) {
+                const auto delimiter = it->find('=');
+
+                if(delimiter == std::string::npos) {
+                    throw po::validation_error(po::validation_error::invalid_option_value,
+                        "attribute", *it);
+                }
+
+                filter.attributes[it->substr(0, delimiter)] = it->substr(delimiter + 1);
+            }
+        }
+    } catch(const po::error& e) {
+        std::cerr << cocaine::format("ERROR: %s.", e.what()) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if(vm.count("help") || !vm.count("segments")) {
+        std::cout << cocaine::format("USAGE: %s [options] <segment or directory>...", argv[0])
+                  << std::endl;
+        std::cout << general_options;
+        return vm.count("help") ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if(vm.count("source")) {
+        filter.source = vm["source"].as<std::string>();
+    }
+
+    if(vm.count("grep")) {
+        filter.message = vm["grep"].as<std::string>();
+    }
+
+    const bool json = vm.count("json");
+
+    // Directories are expanded into their segments, which are named so that the oldest go first.
+    std::vector<std::string> segments;
+
+    for(const auto& path: vm["segments"].as<std::vector<std::string>>()) {
+        if(!fs::is_directory(path)) {
+            segments.push_back(path);
+            continue;
+        }
+
+        std::vector<std::string> files;
+
+        for(fs::directory_iterator it(path), end; it != end; ++it) {
+            if(it->path().extension() == ".seg") files.push_back(it->path().string());
+        }
+
+        std::sort(files.begin(), files.end());
+        segments.insert(segments.end(), files.begin(), files.end());
+    }
+
+    size_t corrupted = 0;
+    size_t dropped = 0;
+
+    for(auto it = segments.begin(); it != segments.end(); ++it) {
+        try {
+            dropped += logging::segment::read(*it, [&](const char* data, size_t size) {
+                msgpack::unpacked unpacked;
+
+                try {
+                    msgpack::unpack(&unpacked, data, size);
+                } catch(const msgpack::unpack_error&) {
+                    corrupted++;
+                    return;
+                }
+
+                const msgpack::object& object = unpacked.get();
+
+                if(object.type != msgpack::type::MAP) {
+                    corrupted++;
+                    return;
+                }
+
+                std::map<std::string, const msgpack::object*> record;
+
+                for(size_t i = 0; i < object.via.map.size; ++i) {
+                    record[to_text(object.via.map.ptr[i].key)] = &object.via.map.ptr[i].val;
+                }
+
+                if(!filter(record)) {
+                    return;
+                }
+
+                if(json) {
+                    print_json(object);
+                } else {
+                    print_text(record);
+                }
+            });
+        } catch(const std::system_error& e) {
+            std::cerr << cocaine::format("ERROR: %s.", e.what()) << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if(corrupted) {
+        std::cerr << cocaine::format("WARNING: %d record(s) could not be decoded.", corrupted)
+                  << std::endl;
+    }
+
+    if(dropped) {
+        std::cerr << cocaine::format("WARNING: %d record(s) have been dropped by the writer.",
+            dropped) << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
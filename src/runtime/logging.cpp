@@ -22,16 +22,83 @@
 
 #include "cocaine/context/config.hpp"
 
+#include "cocaine/detail/runtime/segment.hpp"
+
+#include "cocaine/format.hpp"
 #include "cocaine/tuple.hpp"
 
 #include <blackhole/formatter/json.hpp>
+#include <blackhole/formatter/msgpack.hpp>
 #include <blackhole/frontend/files.hpp>
 #include <blackhole/frontend/syslog.hpp>
 #include <blackhole/scoped_attributes.hpp>
 #include <blackhole/sink/socket.hpp>
 
+#include <iostream>
+
+namespace cocaine { namespace logging {
+
+// Sink writing the formatted records as they are into binary log segments, usually along with the
+// msgpack formatter, so that no attribute is ever converted to text. Segments can be decoded with
+// cocaine-logcat.
+
+class binary_sink_t {
+    std::unique_ptr<segment_writer_t> writer;
+
+public:
+    struct config_type {
+        // Directory for the segment files.
+        std::string path;
+
+        // Size of each segment and the maximum number of segments to keep.
+        uint64_t size;
+        uint64_t segments;
+    };
+
+    static
+    const char*
+    name() {
+        return "binary";
+    }
+
+    explicit
+    binary_sink_t(const config_type& config):
+        writer(new segment_writer_t(config.path, config.size, config.segments))
+    { }
+
+   ~binary_sink_t() {
+        // NOTE: There's no other logger to report this to. The segments keep their own counts of
+        // dropped records as well, which cocaine-logcat reports.
+        if(writer && writer->dropped()) {
+            std::cerr << cocaine::format("WARNING: binary log sink has dropped %d record(s).",
+                writer->dropped()) << std::endl;
+        }
+    }
+
+    void
+    consume(const std::string& message) {
+        writer->write(message.data(), message.size());
+    }
+};
+
+}} // namespace cocaine::logging
+
 BLACKHOLE_BEG_NS
 
+template<>
+struct factory_traits<cocaine::logging::binary_sink_t> {
+    typedef cocaine::logging::binary_sink_t sink_type;
+    typedef sink_type::config_type config_type;
+
+    static
+    void
+    map_config(const aux::extractor<sink_type>& ex, config_type& config) {
+        ex["path"].to(config.path);
+        ex["size"].to(config.size);
+        ex["segments"].to(config.segments);
+    }
+};
+
 namespace sink {
 
 // Mapping trait that is called by Blackhole each time when syslog mapping is required.
@@ -100,13 +167,15 @@ init_t::init_t(const std::map<std::string, config_t::logging_t::logger_t>& confi
         blackhole::sink::files_t<>,
         blackhole::sink::syslog_t<logging::priorities>,
         blackhole::sink::socket_t<boost::asio::ip::tcp>,
-        blackhole::sink::socket_t<boost::asio::ip::udp>
+        blackhole::sink::socket_t<boost::asio::ip::udp>,
+        logging::binary_sink_t
     > sinks_t;
 
     // Available logging formatters.
     typedef boost::mpl::vector<
         blackhole::formatter::string_t,
-        blackhole::formatter::json_t
+        blackhole::formatter::json_t,
+        blackhole::formatter::msgpack_t
     > formatters_t;
 
     // Register frontends with all combinations of formatters and sinks with the logging repository.
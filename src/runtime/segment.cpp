@@ -0,0 +1,410 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/detail/runtime/segment.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <system_error>
+
+#include <boost/filesystem/convenience.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace cocaine::logging;
+
+namespace fs = boost::filesystem;
+
+const char segment::kMagic[8] = {'C', 'O', 'C', 'A', 'L', 'O', 'G', '\0'};
+
+namespace {
+
+size_t
+aligned(size_t size) {
+    return (size + 7) & ~size_t(7);
+}
+
+std::string
+filename(uint64_t sequence) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%016llx.seg", static_cast<unsigned long long>(sequence));
+    return buffer;
+}
+
+// Parses the sequence number back from the segment file name, returns false for other files.
+bool
+parse(const std::string& name, uint64_t& sequence) {
+    if(name.size() != 20 || name.compare(16, 4, ".seg") != 0) {
+        return false;
+    }
+
+    char* end = nullptr;
+    sequence = std::strtoull(name.c_str(), &end, 16);
+
+    return end == name.c_str() + 16;
+}
+
+// Marks the segment left by a previous run as sealed, since its writers are gone.
+void
+seal(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+
+    if(fd < 0) {
+        return;
+    }
+
+    segment::header_t header;
+
+    if(::pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+       std::memcmp(header.magic, segment::kMagic, sizeof(segment::kMagic)) == 0 && !header.sealed)
+    {
+        header.sealed = 1;
+
+        if(::pwrite(fd, &header.sealed, sizeof(header.sealed), offsetof(segment::header_t, sealed))
+            != sizeof(header.sealed))
+        {
+            // Nothing to do, readers just stop at the first unfilled reservation.
+        }
+    }
+
+    ::close(fd);
+}
+
+} // namespace
+
+// Segment writer internals
+
+struct segment_writer_t::segment_t {
+    std::string path;
+
+    int fd;
+    char* base;
+    size_t capacity;
+
+    // Offset of the next reservation, which might be past the capacity once the segment is full.
+    std::atomic<size_t> offset;
+
+    // Writers which have got hold of the segment and might be copying records into it.
+    std::atomic<size_t> writers;
+
+    // NOTE: Only called once there are no writers left.
+    void
+    close() {
+        auto header = reinterpret_cast<segment::header_t*>(base);
+
+        __atomic_store_n(&header->sealed, 1, __ATOMIC_RELEASE);
+
+        ::munmap(base, capacity);
+
+        // Give the unused preallocated space back.
+        if(::ftruncate(fd, std::min<size_t>(offset, capacity)) != 0) {
+            // Nothing to do, the zeroed tail is just a waste of space.
+        }
+
+        ::close(fd);
+    }
+};
+
+segment_writer_t::segment_writer_t(const std::string& path, size_t size, size_t limit):
+    m_path(path),
+    m_size(aligned(size)),
+    m_limit(std::max<size_t>(limit, 1)),
+    m_dropped(0),
+    m_sequence(0)
+{
+    if(m_size <= sizeof(segment::header_t) + sizeof(segment::record_t)) {
+        throw std::system_error(std::make_error_code(std::errc::invalid_argument),
+            "log segment size is too small");
+    }
+
+    fs::create_directories(m_path);
+
+    std::vector<std::pair<uint64_t, std::string>> existing;
+
+    for(fs::directory_iterator it(m_path), end; it != end; ++it) {
+        uint64_t sequence;
+
+        if(parse(it->path().filename().string(), sequence)) {
+            existing.emplace_back(sequence, it->path().string());
+        }
+    }
+
+    std::sort(existing.begin(), existing.end());
+
+    // NOTE: Segments left by the previous runs are never appended to, the sequence continues from
+    // the last one, and they count towards the limit.
+    for(auto it = existing.begin(); it != existing.end(); ++it) {
+        seal(it->second);
+
+        m_sequence = it->first;
+        m_files.push_back(it->second);
+    }
+
+    m_current = create(++m_sequence);
+}
+
+segment_writer_t::~segment_writer_t() {
+    m_current.load()->close();
+
+    for(auto it = m_retired.begin(); it != m_retired.end(); ++it) {
+        (*it)->close();
+    }
+}
+
+bool
+segment_writer_t::write(const char* data, size_t size) {
+    const size_t length = aligned(sizeof(segment::record_t) + size);
+
+    while(true) {
+        segment_t* segment = m_current.load();
+
+        segment->writers++;
+
+        // NOTE: The segment might have been retired before the writer has been registered, in which
+        // case its mapping might be gone already.
+        if(m_current.load() != segment) {
+            segment->writers--;
+            continue;
+        }
+
+        // NOTE: Empty records can't be told apart from the zeroed space.
+        if(size == 0 || length > m_size - sizeof(segment::header_t)) {
+            drop(segment);
+            segment->writers--;
+            return false;
+        }
+
+        const size_t offset = segment->offset.fetch_add(length);
+
+        if(offset + length <= segment->capacity) {
+            auto record = reinterpret_cast<segment::record_t*>(segment->base + offset);
+
+            // Readers stop at the record until its size is stored, and skip it until it's committed.
+            __atomic_store_n(&record->size, size, __ATOMIC_RELAXED);
+
+            std::memcpy(segment->base + offset + sizeof(segment::record_t), data, size);
+
+            // Readers of the live segments see either a complete record, or no record at all.
+            __atomic_store_n(&record->committed, 1, __ATOMIC_RELEASE);
+
+            segment->writers--;
+            return true;
+        }
+
+        // The segment is full, as well as for all the following reservations. The writer is still
+        // registered, so that the segment stays mapped in case the record has to be dropped.
+        if(!rotate(segment)) {
+            drop(segment);
+            segment->writers--;
+            return false;
+        }
+
+        segment->writers--;
+    }
+}
+
+void
+segment_writer_t::drop(segment_t* segment) {
+    m_dropped++;
+
+    auto header = reinterpret_cast<segment::header_t*>(segment->base);
+
+    __atomic_fetch_add(&header->dropped, 1, __ATOMIC_RELAXED);
+}
+
+bool
+segment_writer_t::rotate(segment_t* segment) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    if(m_current.load() != segment) {
+        // Another writer has already switched to the next segment.
+        return true;
+    }
+
+    segment_t* next;
+
+    try {
+        next = create(m_sequence + 1);
+    } catch(const std::system_error&) {
+        return false;
+    }
+
+    m_sequence++;
+
+    m_current = next;
+    m_retired.push_back(segment);
+
+    for(auto it = m_retired.begin(); it != m_retired.end();) {
+        // NOTE: Writers which have got hold of a retired segment, but haven't noticed yet that it's
+        // not the current one, keep it from being closed until the next rotation.
+        if((*it)->writers == 0) {
+            (*it)->close();
+            m_spare.push_back(*it);
+            it = m_retired.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    while(m_files.size() > m_limit) {
+        ::unlink(m_files.front().c_str());
+        m_files.pop_front();
+    }
+
+    return true;
+}
+
+segment_writer_t::segment_t*
+segment_writer_t::create(uint64_t sequence) {
+    const auto path = (fs::path(m_path) / filename(sequence)).string();
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+
+    if(fd < 0) {
+        throw std::system_error(errno, std::system_category(), "unable to create '" + path + "'");
+    }
+
+    // NOTE: Preallocation makes sure that writes to the mapping never fail with SIGBUS when the
+    // disk runs out of space.
+    if(const int rv = ::posix_fallocate(fd, 0, m_size)) {
+        ::close(fd);
+        ::unlink(path.c_str());
+        throw std::system_error(rv, std::system_category(), "unable to allocate '" + path + "'");
+    }
+
+    void* base = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if(base == MAP_FAILED) {
+        const int ec = errno;
+        ::close(fd);
+        ::unlink(path.c_str());
+        throw std::system_error(ec, std::system_category(), "unable to map '" + path + "'");
+    }
+
+    auto header = static_cast<segment::header_t*>(base);
+
+    std::memcpy(header->magic, segment::kMagic, sizeof(segment::kMagic));
+    header->version = segment::kVersion;
+
+    segment_t* result;
+
+    if(m_spare.empty()) {
+        m_segments.push_back(std::make_unique<segment_t>());
+
+        result = m_segments.back().get();
+        result->writers = 0;
+    } else {
+        // NOTE: The writers counter is left as is, because writers which are still holding the
+        // segment from its previous use only find out that it's not the current one after they
+        // have been registered.
+        result = m_spare.back();
+        m_spare.pop_back();
+    }
+
+    result->path = path;
+    result->fd = fd;
+    result->base = static_cast<char*>(base);
+    result->capacity = m_size;
+    result->offset = sizeof(segment::header_t);
+
+    m_files.push_back(path);
+
+    return result;
+}
+
+uint32_t
+segment::read(const std::string& path, const std::function<void(const char*, size_t)>& handler) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if(fd < 0) {
+        throw std::system_error(errno, std::system_category(), "unable to open '" + path + "'");
+    }
+
+    struct stat info;
+
+    if(::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(header_t)) {
+        ::close(fd);
+        throw std::system_error(std::make_error_code(std::errc::invalid_argument),
+            "'" + path + "' is not a log segment");
+    }
+
+    const size_t size = info.st_size;
+    void* base = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+
+    ::close(fd);
+
+    if(base == MAP_FAILED) {
+        throw std::system_error(errno, std::system_category(), "unable to map '" + path + "'");
+    }
+
+    const char* data = static_cast<const char*>(base);
+    const auto header = reinterpret_cast<const header_t*>(data);
+    const bool sealed = __atomic_load_n(&header->sealed, __ATOMIC_ACQUIRE);
+
+    try {
+        if(std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || header->version != kVersion) {
+            throw std::system_error(std::make_error_code(std::errc::invalid_argument),
+                "'" + path + "' is not a log segment");
+        }
+
+        for(size_t offset = sizeof(header_t); offset + sizeof(record_t) <= size;) {
+            const auto record = reinterpret_cast<const record_t*>(data + offset);
+            const size_t length = __atomic_load_n(&record->size, __ATOMIC_ACQUIRE);
+
+            if(length == 0) {
+                if(!sealed) {
+                    // Either the end of the records, or a reservation still being filled in, which
+                    // would be misparsed if skipped.
+                    break;
+                }
+
+                // Either the end of the records, or a reservation which has never been filled in.
+                // Its space is zeroed up to the next record header, which is 8-byte aligned.
+                offset += sizeof(record_t);
+                continue;
+            }
+
+            if(offset + sizeof(record_t) + length > size) {
+                break;
+            }
+
+            if(__atomic_load_n(&record->committed, __ATOMIC_ACQUIRE)) {
+                handler(data + offset + sizeof(record_t), length);
+            }
+
+            offset += aligned(sizeof(record_t) + length);
+        }
+    } catch(...) {
+        ::munmap(base, size);
+        throw;
+    }
+
+    const uint32_t dropped = __atomic_load_n(&header->dropped, __ATOMIC_RELAXED);
+
+    ::munmap(base, size);
+
+    return dropped;
+}
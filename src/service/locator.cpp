@@ -343,6 +343,7 @@ locator_t::locator_t(context_t& context, io_service& asio, const std::string& na
     on<locator::connect>(std::bind(&locator_t::on_connect, this, ph::_1));
     on<locator::refresh>(std::bind(&locator_t::on_refresh, this, ph::_1));
     on<locator::cluster>(std::bind(&locator_t::on_cluster, this));
+    on<locator::memory>(std::bind(&locator_t::on_memory, this));
 
     on<locator::publish>(std::make_shared<publish_slot_t>(this));
     on<locator::routing>(std::make_shared<routing_slot_t>(this));
@@ -455,7 +456,10 @@ locator_t::link_node(const std::string& uuid, const std::vector<tcp::endpoint>&
             // Uniquify the socket object.
             auto ptr = std::make_unique<tcp::socket>(std::move(*socket));
 
-            return (mapping.at(uuid).ptr = m_context.engine().attach(std::move(ptr), nullptr));
+            const auto& compression = m_context.config.network.compression;
+
+            return (mapping.at(uuid).ptr = m_context.engine().attach(std::move(ptr), nullptr,
+                compression.services.count(m_cfg.name) ? compression.threshold : 0));
         });
 
         // Something went wrong in the session creation code above, bail out.
@@ -644,6 +648,11 @@ locator_t::on_cluster() const {
     });
 }
 
+results::memory
+locator_t::on_memory() const {
+    return m_context.memory_usage();
+}
+
 auto
 locator_t::on_routing(const std::string& ruid, bool replace) -> streamed<results::routing> {
     auto results = results::routing();
@@ -0,0 +1,127 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/detail/service/raft.hpp"
+
+#include "cocaine/detail/storage/raft.hpp"
+
+#include "cocaine/dynamic.hpp"
+
+#include "cocaine/traits/tuple.hpp"
+#include "cocaine/traits/vector.hpp"
+
+using namespace cocaine;
+using namespace cocaine::io;
+using namespace cocaine::service;
+
+namespace ph = std::placeholders;
+
+raft_t::raft_t(context_t& context, asio::io_service& asio, const std::string& name, const dynamic_t& args):
+    category_type(context, asio, name, args),
+    dispatch<raft_tag>(name),
+    m_storage(std::dynamic_pointer_cast<storage::raft_t>(
+        api::storage(context, args.as_object().at("backend", "core").as_string())))
+{
+    if(!m_storage) {
+        throw cocaine::error_t("storage backend '%s' is not replicated with raft",
+            args.as_object().at("backend", "core").as_string());
+    }
+
+    on<io::raft::vote>(std::bind(&raft_t::on_vote, this, ph::_1, ph::_2, ph::_3, ph::_4));
+    on<io::raft::append>(std::bind(&raft_t::on_append, this, ph::_1, ph::_2, ph::_3, ph::_4, ph::_5,
+        ph::_6));
+    on<io::raft::install>(std::bind(&raft_t::on_install, this, ph::_1, ph::_2, ph::_3, ph::_4,
+        ph::_5));
+    on<io::raft::propose>(std::bind(&raft_t::on_propose, this, ph::_1));
+}
+
+auto
+raft_t::prototype() const -> const basic_dispatch_t& {
+    return *this;
+}
+
+deferred<std::tuple<uint64_t, bool>>
+raft_t::on_vote(uint64_t term, const std::string& candidate, uint64_t last_index,
+                uint64_t last_term)
+{
+    deferred<std::tuple<uint64_t, bool>> result;
+
+    const cocaine::raft::vote_request_t request = {term, candidate, last_index, last_term};
+
+    m_storage->invoke([=](cocaine::raft::node_t& node) mutable {
+        const auto reply = node.on_vote(request);
+        result.write(reply.term, reply.granted);
+    });
+
+    return result;
+}
+
+deferred<std::tuple<uint64_t, bool, uint64_t>>
+raft_t::on_append(uint64_t term, const std::string& leader, uint64_t prev_index, uint64_t prev_term,
+                  const std::vector<std::tuple<uint64_t, std::string>>& entries, uint64_t commit)
+{
+    deferred<std::tuple<uint64_t, bool, uint64_t>> result;
+
+    cocaine::raft::append_request_t request = {term, leader, prev_index, prev_term, {}, commit};
+
+    request.entries.reserve(entries.size());
+
+    for(auto it = entries.begin(); it != entries.end(); ++it) {
+        request.entries.push_back(cocaine::raft::entry_t{std::get<0>(*it), std::get<1>(*it)});
+    }
+
+    m_storage->invoke([=](cocaine::raft::node_t& node) mutable {
+        const auto reply = node.on_append(request);
+        result.write(reply.term, reply.success, reply.last_index);
+    });
+
+    return result;
+}
+
+deferred<uint64_t>
+raft_t::on_install(uint64_t term, const std::string& leader, uint64_t index, uint64_t last_term,
+                   const std::string& snapshot)
+{
+    deferred<uint64_t> result;
+
+    const cocaine::raft::install_request_t request = {term, leader, index, last_term, snapshot};
+
+    m_storage->invoke([=](cocaine::raft::node_t& node) mutable {
+        result.write(node.on_install(request).term);
+    });
+
+    return result;
+}
+
+deferred<std::tuple<uint64_t, uint64_t>>
+raft_t::on_propose(const std::string& command) {
+    deferred<std::tuple<uint64_t, uint64_t>> result;
+
+    m_storage->invoke([=](cocaine::raft::node_t& node) mutable {
+        if(const auto index = node.propose(command)) {
+            result.write(index, node.term());
+        } else {
+            result.abort(std::make_error_code(std::errc::resource_unavailable_try_again),
+                "not a raft leader");
+        }
+    });
+
+    return result;
+}
@@ -39,6 +39,7 @@ storage_t::storage_t(context_t& context, asio::io_service& asio, const std::stri
     on<storage::write>(std::bind(&api::storage_t::write, storage, ph::_1, ph::_2, ph::_3, ph::_4));
     on<storage::remove>(std::bind(&api::storage_t::remove, storage, ph::_1, ph::_2));
     on<storage::find>(std::bind(&api::storage_t::find, storage, ph::_1, ph::_2));
+    on<storage::list>(std::bind(&api::storage_t::list, storage, ph::_1, ph::_2, ph::_3, ph::_4));
 }
 
 const basic_dispatch_t&
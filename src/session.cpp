@@ -21,6 +21,12 @@
 #include "cocaine/rpc/session.hpp"
 
 #include "cocaine/logging.hpp"
+#include "cocaine/timing_wheel.hpp"
+
+#include "cocaine/detail/channel_table.hpp"
+#include "cocaine/detail/liveness.hpp"
+
+#include "cocaine/idl/control.hpp"
 
 #include "cocaine/rpc/asio/transport.hpp"
 
@@ -30,6 +36,12 @@
 #include <asio/ip/tcp.hpp>
 #include <asio/local/stream_protocol.hpp>
 
+#include <cerrno>
+#include <cstring>
+#include <limits>
+
+#include <unistd.h>
+
 using namespace cocaine;
 using namespace cocaine::io;
 
@@ -56,6 +68,11 @@ public:
 private:
     void
     finalize(const std::error_code& ec);
+
+    // Moves the session to another reactor if requested and possible, then cycles the transport
+    // back into the message pump.
+    void
+    resume(const std::shared_ptr<transport_type>& ptr);
 };
 
 void
@@ -68,7 +85,7 @@ session_t::pull_action_t::operator()(const std::shared_ptr<transport_type> ptr)
 
 void
 session_t::pull_action_t::finalize(const std::error_code& ec) {
-    if(ec) {
+    if(ec && ec != asio::error::operation_aborted) {
         if(ec != asio::error::eof) {
             COCAINE_LOG_ERROR(session->log, "client disconnected: [%d] %s", ec.value(), ec.message());
         } else {
@@ -78,15 +95,48 @@ session_t::pull_action_t::finalize(const std::error_code& ec) {
         return session->detach(ec);
     }
 
-#if defined(__clang__)
+#if defined(COCAINE_HAS_FEATURE_ATOMIC_SHARED_PTR)
     if(const auto ptr = std::atomic_load(&session->transport)) {
 #else
     if(const auto ptr = *session->transport.synchronize()) {
 #endif
+        if(ec) {
+            // The pending read has been cancelled by migrate(), so no message has been read.
+            return resume(ptr);
+        }
+
+        if(session->compression_threshold && !session->compression_enabled &&
+           message.meta<compression_header>())
+        {
+            // The remote peer is able to decode compressed frames, so start sending them.
+            ptr->writer->compress(session->compression_threshold);
+            session->compression_enabled = true;
+        }
+
+        if(session->table_capacity && !session->table_resized &&
+           message.meta<hpack::table_size_header>())
+        {
+            // The remote peer is able to apply table size updates, so send the configured one.
+            ptr->writer->resize_table(*session->table_capacity);
+            session->table_resized = true;
+        }
+
+        if(session->liveness && !session->liveness->supported && message.meta<heartbeat_header>()) {
+            // The remote peer replies to pings, so it can be checked for liveness.
+            session->liveness->supported = true;
+        }
+
+        if(ptr->reader->version() > ptr->writer->version()) {
+            // The remote peer has switched to version 2 frames, so reply with them as well.
+            ptr->writer->upgrade();
+        }
+
+        std::error_code handle_ec;
+
         try {
             // NOTE: In case the underlying slot has miserably failed to handle its exceptions, the
             // client will be disconnected to prevent any further damage to the service and himself.
-            session->handle(message);
+            session->handle(message, handle_ec);
             message.clear();
         } catch(const std::system_error& e) {
             COCAINE_LOG_ERROR(session->log, "uncaught invocation exception: %s", error::to_string(e));
@@ -96,13 +146,43 @@ session_t::pull_action_t::finalize(const std::error_code& ec) {
             return session->detach(error::uncaught_error);
         }
 
-        // Cycle the transport back into the message pump.
-        operator()(std::move(ptr));
+        if(handle_ec) {
+            COCAINE_LOG_ERROR(session->log, "protocol violation in channel %llu: [%d] %s",
+                message.span(), handle_ec.value(), handle_ec.message());
+            return session->detach(handle_ec);
+        }
+
+        session->handled++;
+
+        resume(ptr);
     } else {
         COCAINE_LOG_DEBUG(session->log, "ignoring invocation due to detached session");
     }
 }
 
+void
+session_t::pull_action_t::resume(const std::shared_ptr<transport_type>& ptr) {
+    if(session->migration && !session->fenced && ptr->writer->idle()) {
+        // There's no read in flight and nothing left to write, so it's safe to move the session.
+        const auto next = session->transfer(ptr);
+
+        if(!next) {
+            return;
+        }
+
+        if(next != ptr) {
+            // Continue the message pump in the new session thread.
+            return next->socket->get_io_service().post(std::bind(&pull_action_t::operator(),
+                shared_from_this(),
+                next
+            ));
+        }
+    }
+
+    // Cycle the transport back into the message pump.
+    operator()(ptr);
+}
+
 class session_t::push_action_t:
     public enable_shared_from_this<push_action_t>
 {
@@ -111,10 +191,14 @@ class session_t::push_action_t:
     // Keeps the session alive until all the operations are complete.
     const std::shared_ptr<session_t> session;
 
+    // Whether the message has been forwarded from the previous reactor after the session was moved.
+    bool forwarded;
+
 public:
     push_action_t(encoder_t::message_type&& message, const std::shared_ptr<session_t>& session_):
         message(std::move(message)),
-        session(session_)
+        session(session_),
+        forwarded(false)
     { }
 
     void
@@ -127,6 +211,34 @@ private:
 
 void
 session_t::push_action_t::operator()(const std::shared_ptr<transport_type> ptr) {
+    if(!ptr->socket->is_open()) {
+        // The session has been moved to another reactor after this message was sent, so forward it
+        // there. Forwarded messages go ahead of the ones held back by the new reactor.
+#if defined(COCAINE_HAS_FEATURE_ATOMIC_SHARED_PTR)
+        if(const auto current = std::atomic_load(&session->transport)) {
+#else
+        if(const auto current = *session->transport.synchronize()) {
+#endif
+            forwarded = true;
+
+            current->socket->get_io_service().dispatch(trace_t::bind(&push_action_t::operator(),
+                shared_from_this(),
+                current
+            ));
+        }
+
+        return;
+    }
+
+    if(session->fenced && !forwarded) {
+        return session->backlog.emplace_back(trace_t::bind(&push_action_t::operator(),
+            shared_from_this(),
+            ptr
+        ));
+    }
+
+    session->written++;
+
     if(!trace_t::current().empty()) {
         if(trace_t::current().pushed()) {
             COCAINE_LOG_INFO(session->log, "cs");
@@ -155,88 +267,128 @@ session_t::push_action_t::finalize(const std::error_code& ec) {
     return session->detach(ec);
 }
 
-class session_t::channel_t
-{
-public:
-    channel_t(const dispatch_ptr_t& dispatch_, const upstream_ptr_t& upstream_):
-        dispatch(dispatch_),
-        upstream(upstream_)
-    { }
+// Transports are deleted by whichever thread drops the last reference, which is the last message or
+// channel in flight to the old reactor when the session has been moved to another one. So the hook,
+// set by transfer(), lets that thread release the session in the new reactor, with no polling.
+
+struct session_t::deleter_t {
+    std::function<void()> hook;
 
-    dispatch_ptr_t dispatch;
-    upstream_ptr_t upstream;
+    void
+    operator()(transport_type* ptr) const {
+        delete ptr;
+
+        if(hook) {
+            hook();
+        }
+    }
 };
 
 // Session
 
 session_t::session_t(std::unique_ptr<logging::log_t> log_, std::unique_ptr<transport_type> transport_, const dispatch_ptr_t& prototype_):
     log(std::move(log_)),
-    transport(std::shared_ptr<transport_type>(std::move(transport_))),
+    transport(std::shared_ptr<transport_type>(transport_.release(), deleter_t())),
     prototype(prototype_),
-    max_channel_id(0)
-{ }
+    channels(new channel_table_t()),
+    max_channel_id(0),
+    compression_threshold(0),
+    compression_enabled(false),
+    table_resized(false),
+    handled(0),
+    written(0),
+    fenced(false)
+{
+#if defined(COCAINE_HAS_FEATURE_ATOMIC_SHARED_PTR)
+    const auto ptr = transport;
+#else
+    const auto ptr = *transport.synchronize();
+#endif
+
+    // Let the remote peer know that it can resize the session's incoming header table.
+    ptr->writer->advertise(hpack::headers::make_header<hpack::table_size_header>());
+}
+
+session_t::~session_t() {
+    // Empty.
+}
 
 // Operations
 
 void
-session_t::handle(const decoder_t::message_type& message) {
-    const channel_map_t::key_type channel_id = message.span();
+session_t::handle(const decoder_t::message_type& message, std::error_code& ec) {
+    const uint64_t channel_id = message.span();
     boost::optional<trace_t> incoming_trace;
 
-    const auto channel = channels.apply([&](channel_map_t& mapping) -> std::shared_ptr<channel_t> {
-        channel_map_t::const_iterator lb, ub;
+    if(channel_id == 0) {
+        return control(message, ec);
+    }
 
-        std::tie(lb, ub) = mapping.equal_range(channel_id);
+    auto channel = channels->find(channel_id);
 
-        if(lb == ub) {
-            if(channel_id <= max_channel_id) {
+    if(!channel) {
+        uint64_t max_id = max_channel_id;
+
+        do {
+            if(channel_id <= max_id) {
                 // NOTE: Checking whether channel number is always higher than the previous channel
                 // number is similar to an infinite TIME_WAIT timeout for TCP sockets. It might be
                 // not the best approach, but since we have 2^64 possible channels it's good enough.
-                throw std::system_error(error::revoked_channel, std::to_string(channel_id));
+                ec = error::revoked_channel;
+                return;
             }
+        } while(!max_channel_id.compare_exchange_weak(max_id, channel_id));
+
+        channel = &channels->insert(channel_id,
+            prototype,
+            // Do not store trace if we handling server side.
+            std::allocate_shared<basic_upstream_t>(pooled<basic_upstream_t>(), shared_from_this(), channel_id,
+                boost::none)
+        );
+    }
 
-            std::tie(lb, std::ignore) = mapping.insert({channel_id, std::make_shared<channel_t>(
-                prototype,
-                // Do not store trace if we handling server side.
-                std::make_shared<basic_upstream_t>(shared_from_this(), channel_id, boost::none)
-            )});
+    // NOTE: The channel is copied here, because the table might be modified during the dispatch
+    // processing, e.g. when the service forks a new channel.
+    const dispatch_ptr_t dispatch = channel->dispatch;
+    const upstream_ptr_t upstream = channel->upstream;
 
-            max_channel_id = channel_id;
-        }
-        if(lb->second->upstream->client_trace) {
-            incoming_trace = lb->second->upstream->client_trace;
-        } else {
-            auto trace_header = message.meta<hpack::headers::trace_id<>>();
-            auto span_header = message.meta<hpack::headers::span_id<>>();
-            auto parent_header = message.meta<hpack::headers::parent_id<>>();
-            if(trace_header && span_header && parent_header) {
-                incoming_trace = trace_t(
-                    trace_header->get_value().convert<uint64_t>(),
-                    span_header->get_value().convert<uint64_t>(),
-                    parent_header->get_value().convert<uint64_t>(),
-                    std::get<0>(lb->second->dispatch->root().at(message.type()))
-                );
-            }
-        }
+    if(!dispatch) {
+        ec = error::unbound_dispatch;
+        return;
+    }
 
-        // NOTE: The virtual channel pointer is copied here to avoid data races.
-        return lb->second;
-    });
+    if(upstream->client_trace) {
+        incoming_trace = upstream->client_trace;
+    } else {
+        auto trace_header = message.meta<hpack::headers::trace_id<>>();
+        auto span_header = message.meta<hpack::headers::span_id<>>();
+        auto parent_header = message.meta<hpack::headers::parent_id<>>();
+        if(trace_header && span_header && parent_header) {
+            const auto slot = dispatch->root().find(message.type());
+
+            if(slot == dispatch->root().end()) {
+                ec = error::slot_not_found;
+                return;
+            }
 
-    if(!channel->dispatch) {
-        throw std::system_error(error::unbound_dispatch);
+            incoming_trace = trace_t(
+                trace_header->get_value().convert<uint64_t>(),
+                span_header->get_value().convert<uint64_t>(),
+                parent_header->get_value().convert<uint64_t>(),
+                std::get<0>(slot->second)
+            );
+        }
     }
 
     trace_t::restore_scope_t trace_scope(incoming_trace);
 
     COCAINE_LOG_DEBUG(log, "invocation type %llu: '%s' in channel %llu, dispatch: '%s'",
         message.type(),
-        channel->dispatch->root().count(message.type()) ?
-            std::get<0>(channel->dispatch->root().at(message.type()))
+        dispatch->root().count(message.type()) ?
+            std::get<0>(dispatch->root().at(message.type()))
           : "<undefined>",
         channel_id,
-        channel->dispatch->name());
+        dispatch->name());
 
     if(!trace_t::current().empty()) {
         if(trace_t::current().pushed()) {
@@ -247,64 +399,487 @@ session_t::handle(const decoder_t::message_type& message) {
         }
     }
 
-    if((channel->dispatch = channel->dispatch->process(message, channel->upstream)
-        .get_value_or(channel->dispatch)) == nullptr)
-    {
+    const auto transition = dispatch->process(message, upstream, ec).get_value_or(dispatch);
+
+    if(ec || transition == dispatch) {
+        return;
+    }
+
+    // NOTE: No-op if the channel is no longer in the table, e.g., was discarded during detach(),
+    // which was called during the dispatch::process().
+    if(!channels->update(channel_id, transition)) {
+        return;
+    }
+
+    if(transition == nullptr) {
         // NOTE: If the client has sent us the last message according to our dispatch graph, revoke
-        // the channel. No-op if the channel is no longer in the mapping, e.g., was discarded during
-        // session::detach(), which was called during the dispatch::process().
-        if(!channel.unique()) revoke(channel_id);
+        // the channel.
+        revoke(channel_id);
     }
 }
 
 void
-session_t::revoke(uint64_t channel_id) {
-    channels.apply([&](channel_map_t& mapping) {
-        auto it = mapping.find(channel_id);
-
-        if(it == mapping.end()) {
-            COCAINE_LOG_WARNING(log, "ignoring revoke request for channel %d", channel_id);
-            return;
+session_t::control(const decoder_t::message_type& message, std::error_code& ec) {
+    switch(message.type()) {
+    case event_traits<io::control::ping>::id:
+        if(liveness) {
+            // Both the ping and the pong.
+            liveness->control += 2;
         }
 
-        if(it->second->dispatch) {
-            COCAINE_LOG_ERROR(log, "revoking channel %d, dispatch: '%s'", channel_id,
-                it->second->dispatch->name());
-            it->second->dispatch->discard(std::error_code());
-        } else {
-            COCAINE_LOG_DEBUG(log, "revoking channel %d", channel_id);
+        push(encoded<io::control::pong>(0));
+        break;
+    case event_traits<io::control::pong>::id:
+        if(liveness) {
+            liveness->control++;
         }
 
-        mapping.erase(it);
-    });
+        break;
+    default:
+        ec = error::slot_not_found;
+    }
+}
+
+void
+session_t::revoke(uint64_t channel_id) {
+    const auto channel = channels->erase(channel_id);
+
+    if(!channel) {
+        COCAINE_LOG_WARNING(log, "ignoring revoke request for channel %d", channel_id);
+        return;
+    }
+
+    const dispatch_ptr_t& dispatch = channel->dispatch;
+
+    if(dispatch) {
+        COCAINE_LOG_ERROR(log, "revoking channel %d, dispatch: '%s'", channel_id, dispatch->name());
+        dispatch->discard(std::error_code());
+    } else {
+        COCAINE_LOG_DEBUG(log, "revoking channel %d", channel_id);
+    }
+}
+
+void
+basic_upstream_t::revoke() {
+    session->forget(channel_id);
 }
 
 upstream_ptr_t
 session_t::fork(const dispatch_ptr_t& dispatch) {
-    return channels.apply([&](channel_map_t& mapping) -> upstream_ptr_t {
-        const auto channel_id = ++max_channel_id;
-        auto trace = trace_t::current();
-        trace.push(dispatch->name());
-        const auto downstream = std::make_shared<basic_upstream_t>(shared_from_this(), channel_id, trace);
-
-        COCAINE_LOG_DEBUG(log, "forking new channel %d, dispatch: '%s'", channel_id,
-            dispatch ? dispatch->name() : "<none>");
-
-        if(dispatch) {
-            // NOTE: For mute slots, creating a new channel will essentially leak memory, since no
-            // response will ever be sent back, therefore the channel will never be revoked at all.
-            mapping.insert({channel_id, std::make_shared<channel_t>(dispatch, downstream)});
+    const auto channel_id = ++max_channel_id;
+    auto trace = trace_t::current();
+    trace.push(dispatch->name());
+    const auto downstream = std::allocate_shared<basic_upstream_t>(pooled<basic_upstream_t>(),
+        shared_from_this(), channel_id, trace);
+
+    COCAINE_LOG_DEBUG(log, "forking new channel %d, dispatch: '%s'", channel_id,
+        dispatch ? dispatch->name() : "<none>");
+
+    if(!dispatch) {
+        // NOTE: For mute slots, creating a new channel will essentially leak memory, since no
+        // response will ever be sent back, therefore the channel will never be revoked at all.
+        return downstream;
+    }
+
+#if defined(COCAINE_HAS_FEATURE_ATOMIC_SHARED_PTR)
+    if(const auto ptr = std::atomic_load(&transport)) {
+#else
+    if(const auto ptr = *transport.synchronize()) {
+#endif
+        // NOTE: The channel is inserted before any message is sent with the upstream, because pushes
+        // are dispatched to the same reactor.
+        ptr->socket->get_io_service().dispatch(std::bind(&session_t::insert,
+            shared_from_this(),
+            ptr,
+            channel_id,
+            dispatch,
+            downstream
+        ));
+    }
+
+    return downstream;
+}
+
+void
+session_t::insert(const std::shared_ptr<transport_type>& ptr, uint64_t channel_id,
+                  const dispatch_ptr_t& dispatch, const upstream_ptr_t& upstream)
+{
+#if defined(COCAINE_HAS_FEATURE_ATOMIC_SHARED_PTR)
+    const auto current = std::atomic_load(&transport);
+#else
+    const auto current = *transport.synchronize();
+#endif
+
+    if(!current) {
+        // The session has been detached after the channel was forked, and its channels have been
+        // discarded already.
+        return dispatch->discard(error::not_connected);
+    }
+
+    if(current != ptr) {
+        // The session has been moved to another reactor after the channel was forked, and the new
+        // session thread owns the channels now.
+        return current->socket->get_io_service().dispatch(std::bind(&session_t::insert,
+            shared_from_this(),
+            current,
+            channel_id,
+            dispatch,
+            upstream
+        ));
+    }
+
+    channels->insert(channel_id, dispatch, upstream);
+}
+
+void
+session_t::forget(uint64_t channel_id) {
+#if defined(COCAINE_HAS_FEATURE_ATOMIC_SHARED_PTR)
+    if(const auto ptr = std::atomic_load(&transport)) {
+#else
+    if(const auto ptr = *transport.synchronize()) {
+#endif
+        ptr->socket->get_io_service().dispatch(std::bind(&session_t::erase,
+            shared_from_this(),
+            ptr,
+            channel_id
+        ));
+    }
+}
+
+void
+session_t::erase(const std::shared_ptr<transport_type>& ptr, uint64_t channel_id) {
+#if defined(COCAINE_HAS_FEATURE_ATOMIC_SHARED_PTR)
+    const auto current = std::atomic_load(&transport);
+#else
+    const auto current = *transport.synchronize();
+#endif
+
+    if(current && current != ptr) {
+        // The session has been moved to another reactor, see insert().
+        return current->socket->get_io_service().dispatch(std::bind(&session_t::erase,
+            shared_from_this(),
+            current,
+            channel_id
+        ));
+    }
+
+    if(channels->erase(channel_id)) {
+        COCAINE_LOG_DEBUG(log, "forgetting channel %d", channel_id);
+    }
+}
+
+void
+session_t::discard(const std::error_code& ec) {
+    const auto released = channels->release();
+
+    size_t count = 0;
+
+    for(auto it = released.begin(); it != released.end(); ++it) {
+        if(it->id && it->dispatch) count++;
+    }
+
+    if(count == 0) {
+        return;
+    } else {
+        COCAINE_LOG_DEBUG(log, "discarding %d channel dispatch(es)", count);
+    }
+
+    for(auto it = released.begin(); it != released.end(); ++it) {
+        if(it->id && it->dispatch) it->dispatch->discard(ec);
+    }
+}
+
+// Migration
+
+auto
+session_t::transfer(const std::shared_ptr<transport_type>& ptr) -> std::shared_ptr<transport_type> {
+    const auto request = std::move(migration);
+
+    std::error_code ec;
+
+    // Local endpoint address of the socket to be cloned.
+    const auto endpoint = ptr->socket->local_endpoint(ec);
+
+    if(ec) {
+        COCAINE_LOG_WARNING(log, "unable to migrate session: [%d] %s", ec.value(), ec.message());
+        return ptr;
+    }
+
+    int fd;
+
+    if((fd = ::dup(ptr->socket->native_handle())) == -1) {
+        COCAINE_LOG_WARNING(log, "unable to migrate session: [%d] %s", errno, std::strerror(errno));
+        return ptr;
+    }
+
+    std::shared_ptr<transport_type> next;
+
+    try {
+        // Copy the socket into the new reactor, the streams are moved along with their state.
+        next = std::shared_ptr<transport_type>(new transport_type(
+            std::make_unique<protocol_type::socket>(*request->target, endpoint.protocol(), fd),
+            *ptr
+        ), deleter_t());
+    } catch(const std::system_error& e) {
+        COCAINE_LOG_WARNING(log, "unable to migrate session: %s", error::to_string(e));
+        return ptr;
+    }
+
+    if(!request->handle(fd)) {
+        COCAINE_LOG_DEBUG(log, "session migration has been refused");
+
+        // NOTE: The new socket shares the connection with the old one, so it's closed instead of
+        // being shut down, and the streams are moved back to the old socket.
+        next->socket->close(ec);
+
+        ptr->reader->rebind(ptr->socket);
+        ptr->writer->rebind(ptr->socket);
+
+        return ptr;
+    }
+
+    // Messages sent via the new reactor are held back until the ones still in flight to the old one
+    // are forwarded, see deleter_t above.
+    fenced = true;
+
+#if defined(COCAINE_HAS_FEATURE_ATOMIC_SHARED_PTR)
+    auto expected = ptr;
+
+    if(!std::atomic_compare_exchange_strong(&transport, &expected, next)) {
+#else
+    if(!transport.apply([&](std::shared_ptr<transport_type>& current) -> bool {
+        if(current != ptr) {
+            return false;
         }
 
-        return downstream;
-    });
+        current = next;
+        return true;
+    })) {
+#endif
+        // The session has been detached in the meantime, so the new socket goes down with it.
+        fenced = false;
+        return nullptr;
+    }
+
+    // NOTE: The old socket shares the connection with the new one, so it must be closed instead of
+    // being shut down. Closed sockets also mark the messages still in flight to the old reactor.
+    ptr->socket->close(ec);
+
+    COCAINE_LOG_DEBUG(log, "migrated session to another reactor");
+
+    // NOTE: Messages and channels still in flight to the old reactor hold the old transport until
+    // they are forwarded, so once it's deleted, everything sent to the old reactor is queued in the new
+    // one ahead of the release.
+    const auto target = request->target;
+    const auto self = shared_from_this();
+
+    std::get_deleter<deleter_t>(ptr)->hook = [target, self] {
+        target->post(std::bind(&session_t::release, self));
+    };
+
+    if(liveness) {
+        // The liveness checks are resumed by the new reactor, once the session is released there.
+        liveness->timer = std::make_unique<wheel_timer_t>(*request->target);
+    }
+
+    return next;
+}
+
+void
+session_t::release() {
+    std::deque<std::function<void()>> held;
+
+    fenced = false;
+    held.swap(backlog);
+
+    for(auto it = held.begin(); it != held.end(); ++it) {
+        (*it)();
+    }
+
+    if(liveness) {
+        watch();
+    }
+}
+
+void
+session_t::migrate(const std::shared_ptr<asio::io_service>& target,
+                   std::function<bool(int)> handle)
+{
+    migration.reset(new migration_t{target, std::move(handle)});
+
+#if defined(COCAINE_HAS_FEATURE_ATOMIC_SHARED_PTR)
+    if(const auto ptr = std::atomic_load(&transport)) {
+#else
+    if(const auto ptr = *transport.synchronize()) {
+#endif
+        if(!fenced && ptr->writer->idle()) {
+            // NOTE: Cancelling the read cancels pending writes as well, so it's only done when there
+            // are none. Otherwise, the session is moved after the next message.
+            ptr->reader->cancel();
+        }
+    }
+}
+
+void
+session_t::stay() {
+    migration.reset();
+}
+
+// Liveness
+
+void
+session_t::watch() {
+    liveness->timer->expires_from_now(boost::posix_time::milliseconds(liveness->period));
+
+    liveness->timer->async_wait(std::bind(&session_t::check,
+        shared_from_this(),
+        std::placeholders::_1
+    ));
+}
+
+void
+session_t::check(const std::error_code& ec) {
+    if(ec == asio::error::operation_aborted) {
+        return;
+    }
+
+#if defined(COCAINE_HAS_FEATURE_ATOMIC_SHARED_PTR)
+    if(!std::atomic_load(&transport)) {
+#else
+    if(!*transport.synchronize()) {
+#endif
+        // The session has been detached, so there's nothing left to watch.
+        return;
+    }
+
+    const auto verdict = liveness->check(handled, written, channels->size());
+
+    if(verdict == error::idle_timeout) {
+        COCAINE_LOG_INFO(log, "detaching session after %llu ms of inactivity", liveness->idle);
+        return detach(verdict);
+    }
+
+    if(verdict) {
+        COCAINE_LOG_WARNING(log, "detaching session, remote peer has been silent for %llu ms",
+            liveness->silent);
+        return detach(verdict);
+    }
+
+    if(liveness->ping()) {
+        try {
+            push(encoded<io::control::ping>(0));
+        } catch(const std::system_error& e) {
+            // The session has been detached in the meantime.
+            return;
+        }
+    }
+
+    watch();
 }
 
 // Channel I/O
 
+void
+session_t::compress(size_t threshold) {
+#if defined(COCAINE_HAS_FEATURE_ATOMIC_SHARED_PTR)
+    if(const auto ptr = std::atomic_load(&transport)) {
+#else
+    if(const auto ptr = *transport.synchronize()) {
+#endif
+        compression_threshold = threshold;
+
+        // Let the remote peer know that it can send compressed frames too.
+        ptr->writer->advertise(hpack::headers::make_header<compression_header>());
+        ptr->reader->decompress();
+    } else {
+        throw std::system_error(error::not_connected);
+    }
+}
+
+void
+session_t::header_table(size_t capacity) {
+    if(capacity > hpack::header_table_t::max_data_capacity) {
+        throw std::system_error(std::make_error_code(std::errc::invalid_argument),
+            "header table capacity exceeds the maximum allowed");
+    }
+
+    table_capacity = capacity;
+}
+
+void
+session_t::limit(size_t size) {
+#if defined(COCAINE_HAS_FEATURE_ATOMIC_SHARED_PTR)
+    if(const auto ptr = std::atomic_load(&transport)) {
+#else
+    if(const auto ptr = *transport.synchronize()) {
+#endif
+        ptr->reader->limit(size);
+    } else {
+        throw std::system_error(error::not_connected);
+    }
+}
+
+void
+session_t::schedule(size_t messages, size_t bytes) {
+#if defined(COCAINE_HAS_FEATURE_ATOMIC_SHARED_PTR)
+    if(const auto ptr = std::atomic_load(&transport)) {
+#else
+    if(const auto ptr = *transport.synchronize()) {
+#endif
+        ptr->reader->schedule(messages, bytes);
+    } else {
+        throw std::system_error(error::not_connected);
+    }
+}
+
+void
+session_t::keepalive(size_t timeout, size_t heartbeat) {
+#if defined(COCAINE_HAS_FEATURE_ATOMIC_SHARED_PTR)
+    if(const auto ptr = std::atomic_load(&transport)) {
+#else
+    if(const auto ptr = *transport.synchronize()) {
+#endif
+        const uint64_t none = std::numeric_limits<uint64_t>::max();
+
+        // Idle sessions are detached within a quarter of the timeout after it has passed.
+        const uint64_t period = std::min(
+            timeout   ? std::max<uint64_t>(timeout * 1000 / 4, 1) : none,
+            heartbeat ? heartbeat * 1000 : none
+        );
+
+        if(period == none) {
+            return;
+        }
+
+        liveness.reset(new liveness_t(timeout * 1000, heartbeat * 1000, period,
+            std::make_unique<wheel_timer_t>(ptr->socket->get_io_service())
+        ));
+
+        if(heartbeat) {
+            // Let the remote peer know that it can ping the session too.
+            ptr->writer->advertise(hpack::headers::make_header<heartbeat_header>());
+        }
+    } else {
+        throw std::system_error(error::not_connected);
+    }
+}
+
+void
+session_t::upgrade() {
+#if defined(COCAINE_HAS_FEATURE_ATOMIC_SHARED_PTR)
+    if(const auto ptr = std::atomic_load(&transport)) {
+#else
+    if(const auto ptr = *transport.synchronize()) {
+#endif
+        ptr->writer->upgrade();
+    } else {
+        throw std::system_error(error::not_connected);
+    }
+}
+
 void
 session_t::pull() {
-#if defined(__clang__)
+#if defined(COCAINE_HAS_FEATURE_ATOMIC_SHARED_PTR)
     if(const auto ptr = std::atomic_load(&transport)) {
 #else
     if(const auto ptr = *transport.synchronize()) {
@@ -314,6 +889,12 @@ session_t::pull() {
             std::make_shared<pull_action_t>(shared_from_this()),
             ptr
         ));
+
+        if(liveness) {
+            ptr->socket->get_io_service().dispatch(std::bind(&session_t::watch,
+                shared_from_this()
+            ));
+        }
     } else {
         throw std::system_error(error::not_connected);
     }
@@ -321,14 +902,19 @@ session_t::pull() {
 
 void
 session_t::push(encoder_t::message_type&& message) {
-#if defined(__clang__)
+#if defined(COCAINE_HAS_FEATURE_ATOMIC_SHARED_PTR)
     if(const auto ptr = std::atomic_load(&transport)) {
 #else
     if(const auto ptr = *transport.synchronize()) {
 #endif
+        const auto action = std::allocate_shared<push_action_t>(pooled<push_action_t>(),
+            std::move(message),
+            shared_from_this()
+        );
+
         // Use dispatch() instead of a direct call for thread safety.
         ptr->socket->get_io_service().dispatch(trace_t::bind(&push_action_t::operator(),
-            std::make_shared<push_action_t>(std::move(message), shared_from_this()),
+            action,
             ptr
         ));
     } else {
@@ -338,51 +924,65 @@ session_t::push(encoder_t::message_type&& message) {
 
 void
 session_t::detach(const std::error_code& ec) {
-#if defined(__clang__)
+#if defined(COCAINE_HAS_FEATURE_ATOMIC_SHARED_PTR)
     if(auto swapped = std::atomic_exchange(&transport, std::shared_ptr<transport_type>())) {
 #else
     if(auto swapped = std::move(*transport.synchronize())) {
 #endif
+        auto& reactor = swapped->socket->get_io_service();
+
         swapped = nullptr;
         COCAINE_LOG_DEBUG(log, "detached session from the transport");
+
+        // Use dispatch() instead of a direct call, since channels are owned by the session thread.
+        // NOTE: If the reactor has already stopped, e.g. when its engine is being destroyed, the
+        // engine drains it on shutdown, so the channels are discarded anyway.
+        reactor.dispatch(std::bind(&session_t::discard, shared_from_this(), ec));
     } else {
         COCAINE_LOG_WARNING(log, "ignoring detach request for session");
-        return;
     }
-
-    channels.apply([&](channel_map_t& mapping) {
-        if(mapping.empty()) {
-            return;
-        } else {
-            COCAINE_LOG_DEBUG(log, "discarding %d channel dispatch(es)", mapping.size());
-        }
-
-        for(auto it = mapping.begin(); it != mapping.end(); ++it) {
-            if(it->second->dispatch) it->second->dispatch->discard(ec);
-        }
-
-        mapping.clear();
-    });
 }
 
 // Information
 
 std::map<uint64_t, std::string>
 session_t::active_channels() const {
-    return channels.apply([](const channel_map_t& mapping) -> std::map<uint64_t, std::string> {
-        std::map<uint64_t, std::string> result;
+    std::map<uint64_t, std::string> result;
 
-        for(auto it = mapping.begin(); it != mapping.end(); ++it) {
-            result[it->first] = it->second->dispatch ? it->second->dispatch->name() : "<none>";
-        }
+    const auto& slots = channels->channels();
+
+    for(auto it = slots.begin(); it != slots.end(); ++it) {
+        if(it->id) result[it->id] = it->dispatch ? it->dispatch->name() : "<none>";
+    }
+
+    return result;
+}
+
+uint64_t
+session_t::messages() const {
+    return handled;
+}
+
+bool
+session_t::movable() const {
+    if(migration || fenced) {
+        return false;
+    }
+
+#if defined(COCAINE_HAS_FEATURE_ATOMIC_SHARED_PTR)
+    if(const auto ptr = std::atomic_load(&transport)) {
+#else
+    if(const auto ptr = *transport.synchronize()) {
+#endif
+        return ptr->writer->idle();
+    }
 
-        return result;
-    });
+    return false;
 }
 
 std::size_t
 session_t::memory_pressure() const {
-#if defined(__clang__)
+#if defined(COCAINE_HAS_FEATURE_ATOMIC_SHARED_PTR)
     if(const auto ptr = std::atomic_load(&transport)) {
 #else
     if(const auto ptr = *transport.synchronize()) {
@@ -402,7 +1002,7 @@ session_t::endpoint_type
 session_t::remote_endpoint() const {
     endpoint_type endpoint;
 
-#if defined(__clang__)
+#if defined(COCAINE_HAS_FEATURE_ATOMIC_SHARED_PTR)
     if(const auto ptr = std::atomic_load(&transport)) {
 #else
     if(const auto ptr = *transport.synchronize()) {
@@ -23,16 +23,57 @@
 #include "cocaine/context.hpp"
 #include "cocaine/logging.hpp"
 
+#include <cerrno>
 #include <numeric>
 
 #include <boost/filesystem/fstream.hpp>
 #include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/convenience.hpp>
 
+#include <sys/stat.h>
+#include <time.h>
+
 using namespace cocaine::storage;
 
 namespace fs = boost::filesystem;
 
+namespace {
+
+// Directory changes made within this many nanoseconds after it has been indexed might share the
+// same modification time, given the timestamp granularity of the filesystem. Some filesystems only
+// store whole seconds.
+const uint64_t kTimestampGranularity = 1000000000;
+
+// Directory modification time in nanoseconds, or zero if there's no such directory.
+uint64_t
+modified(const fs::path& path) {
+    struct stat info;
+
+    if(::stat(path.c_str(), &info) != 0) {
+        if(errno == ENOENT) return 0;
+        throw std::system_error(errno, std::system_category(), path.string());
+    }
+
+#if defined(__APPLE__)
+    return info.st_mtimespec.tv_sec * 1000000000ull + info.st_mtimespec.tv_nsec;
+#else
+    return info.st_mtim.tv_sec * 1000000000ull + info.st_mtim.tv_nsec;
+#endif
+}
+
+// Returns the modification time if it can be used to validate the index, or zero if the directory
+// has been modified so recently that yet another change might go unnoticed.
+uint64_t
+trusted(uint64_t mtime) {
+    struct timespec now;
+
+    ::clock_gettime(CLOCK_REALTIME, &now);
+
+    return now.tv_sec * 1000000000ull + now.tv_nsec > mtime + kTimestampGranularity ? mtime : 0;
+}
+
+} // namespace
+
 files_t::files_t(context_t& context, const std::string& name, const dynamic_t& args):
     category_type(context, name, args),
     m_log(context.log(name)),
@@ -82,6 +123,7 @@ files_t::write(const std::string& collection, const std::string& key, const std:
 
     const fs::path store_path(m_parent_path / collection);
     const auto store_status = fs::status(store_path);
+    const auto mtime = modified(store_path);
 
     if(!fs::exists(store_status)) {
         COCAINE_LOG_INFO(m_log, "creating collection")(
@@ -132,6 +174,8 @@ files_t::write(const std::string& collection, const std::string& key, const std:
 
     stream.write(blob.c_str(), blob.size());
     stream.close();
+
+    update(collection, key, true, mtime);
 }
 
 void
@@ -149,7 +193,11 @@ files_t::remove(const std::string& collection, const std::string& key) {
         "path", file_path
     );
 
+    const auto mtime = modified(m_parent_path / collection);
+
     fs::remove(file_path);
+
+    update(collection, key, false, mtime);
 }
 
 namespace {
@@ -227,3 +275,89 @@ files_t::find(const std::string& collection, const std::vector<std::string>& tag
 
     return std::accumulate(result.begin(), result.end(), initial, intersect());
 }
+
+std::vector<std::string>
+files_t::list(const std::string& collection, const std::string& prefix,
+              const std::string& start_after, size_t limit)
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    const fs::path store_path(m_parent_path / collection);
+
+    if(!fs::is_directory(store_path)) {
+        return std::vector<std::string>();
+    }
+
+    const auto mtime = modified(store_path);
+
+    auto index = m_indices.find(collection);
+
+    if(index == m_indices.end() || !index->second.mtime || index->second.mtime != mtime) {
+        COCAINE_LOG_DEBUG(m_log, "indexing collection")(
+            "collection", collection,
+            "path", store_path
+        );
+
+        std::set<std::string> keys;
+
+        // NOTE: Tags are subdirectories of the collection, so only the regular files are keys.
+        for(fs::directory_iterator it(store_path), end; it != end; ++it) {
+            if(!fs::is_regular_file(it->status())) {
+                continue;
+            }
+
+#if BOOST_VERSION >= 104600
+            keys.insert(keys.end(), it->path().filename().string());
+#else
+            keys.insert(keys.end(), it->path().filename());
+#endif
+        }
+
+        index = m_indices.insert({collection, index_t()}).first;
+
+        index->second.mtime = trusted(mtime);
+        index->second.keys.swap(keys);
+    }
+
+    const auto& keys = index->second.keys;
+
+    auto it = start_after < prefix ? keys.lower_bound(prefix) : keys.upper_bound(start_after);
+
+    std::vector<std::string> result;
+
+    for(; it != keys.end() && (!limit || result.size() < limit); ++it) {
+        if(it->compare(0, prefix.size(), prefix) != 0) {
+            break;
+        }
+
+        result.push_back(*it);
+    }
+
+    return result;
+}
+
+void
+files_t::update(const std::string& collection, const std::string& key, bool exists,
+                uint64_t mtime)
+{
+    auto index = m_indices.find(collection);
+
+    if(index == m_indices.end()) {
+        return;
+    }
+
+    if(!index->second.mtime || index->second.mtime != mtime) {
+        // The index is stale already, and the new modification time would hide that.
+        m_indices.erase(index);
+        return;
+    }
+
+    if(exists) {
+        index->second.keys.insert(key);
+    } else {
+        index->second.keys.erase(key);
+    }
+
+    // NOTE: The modification above has been made by the storage itself, so the index stays valid.
+    index->second.mtime = trusted(modified(m_parent_path / collection));
+}
@@ -0,0 +1,575 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/detail/storage/raft.hpp"
+
+#include "cocaine/api/client.hpp"
+
+#include "cocaine/context.hpp"
+
+#include "cocaine/detail/chamber.hpp"
+
+#include "cocaine/dynamic.hpp"
+
+#include "cocaine/idl/locator.hpp"
+#include "cocaine/idl/raft.hpp"
+
+#include "cocaine/logging.hpp"
+
+#include "cocaine/traits/map.hpp"
+#include "cocaine/traits/tuple.hpp"
+#include "cocaine/traits/vector.hpp"
+
+#include <algorithm>
+
+using namespace cocaine;
+using namespace cocaine::storage;
+
+using namespace asio;
+using namespace asio::ip;
+
+namespace ph = std::placeholders;
+
+namespace {
+
+// Node state is advanced at least this often, in milliseconds.
+const uint64_t kTickInterval = 10;
+
+// Stored objects are blobs along with their tags.
+typedef std::tuple<std::string, std::vector<std::string>> object_type;
+typedef std::map<std::string, std::map<std::string, object_type>> state_type;
+
+enum operation_t: int { write_operation = 1, remove_operation };
+
+// Operation, collection, key and the object, which is empty for removals.
+typedef std::tuple<int, std::string, std::string, object_type> command_type;
+
+template<class T>
+std::string
+pack(const T& source) {
+    std::ostringstream buffer;
+    msgpack::packer<std::ostringstream> packer(buffer);
+
+    io::type_traits<T>::pack(packer, source);
+
+    return buffer.str();
+}
+
+template<class T>
+T
+unpack(const std::string& source) {
+    T result;
+    msgpack::unpacked unpacked;
+
+    msgpack::unpack(&unpacked, source.data(), source.size());
+    io::type_traits<T>::unpack(unpacked.get(), result);
+
+    return result;
+}
+
+template<class... Args>
+std::exception_ptr
+make_error(std::errc code, Args&&... args) {
+    return std::make_exception_ptr(std::system_error(std::make_error_code(code),
+        std::forward<Args>(args)...));
+}
+
+} // namespace
+
+// Raft storage internals
+
+class raft_t::machine_t:
+    public raft::machine_t
+{
+    raft_t *const parent;
+
+    // Collection which changes are pushed to the Locator.
+    const std::string refresh;
+
+    // Writes waiting for their entries to be applied, keyed by the entry index. Only accessed from
+    // the Raft reactor.
+    std::multimap<uint64_t, std::pair<uint64_t, std::shared_ptr<std::promise<void>>>> pending;
+
+public:
+    // Read by the storage clients from their own threads.
+    synchronized<state_type> state;
+
+    machine_t(raft_t* parent_, const std::string& refresh_):
+        parent(parent_),
+        refresh(refresh_)
+    { }
+
+    virtual
+    void
+    apply(uint64_t index, uint64_t term, const std::string& command) {
+        if(!command.empty()) {
+            execute(unpack<command_type>(command));
+        }
+
+        settle(index, term);
+    }
+
+    virtual
+    std::string
+    snapshot() const {
+        return pack(*state.synchronize());
+    }
+
+    virtual
+    void
+    restore(uint64_t index, const std::string& snapshot) {
+        auto restored = unpack<state_type>(snapshot);
+        std::vector<std::string> changed;
+
+        state.apply([&](state_type& mapping) {
+            // Both the removed and the updated objects have to be refreshed.
+            for(auto it = mapping[refresh].begin(); it != mapping[refresh].end(); ++it) {
+                changed.push_back(it->first);
+            }
+
+            for(auto it = restored[refresh].begin(); it != restored[refresh].end(); ++it) {
+                changed.push_back(it->first);
+            }
+
+            mapping = std::move(restored);
+        });
+
+        notify(changed);
+
+        // Whether the pending entries have been committed is unknown, as they are buried in the
+        // snapshot now.
+        settle(index, 0);
+    }
+
+    void
+    wait(uint64_t index, uint64_t term, const std::shared_ptr<std::promise<void>>& promise) {
+        pending.insert({index, std::make_pair(term, promise)});
+    }
+
+private:
+    void
+    execute(const command_type& command) {
+        const auto& collection = std::get<1>(command);
+        const auto& key = std::get<2>(command);
+
+        state.apply([&](state_type& mapping) {
+            switch(std::get<0>(command)) {
+            case write_operation:
+                mapping[collection][key] = std::get<3>(command);
+                break;
+            case remove_operation:
+                mapping[collection].erase(key);
+                break;
+            }
+        });
+
+        if(collection == refresh) {
+            notify({key});
+        }
+    }
+
+    // Completes the writes waiting for the entries up to the index. Zero term means that it's not
+    // known which entries are there.
+    void
+    settle(uint64_t index, uint64_t term) {
+        while(!pending.empty() && pending.begin()->first <= index) {
+            const auto it = pending.begin();
+
+            if(it->first == index && it->second.first == term) {
+                it->second.second->set_value();
+            } else if(term) {
+                it->second.second->set_exception(make_error(std::errc::operation_canceled,
+                    "command has been superseded by another leader"));
+            } else {
+                it->second.second->set_exception(make_error(std::errc::operation_canceled,
+                    "command outcome is unknown"));
+            }
+
+            pending.erase(it);
+        }
+    }
+
+    void
+    notify(const std::vector<std::string>& keys) {
+        if(keys.empty()) {
+            return;
+        }
+
+        // NOTE: The Locator might not be running yet, in which case it reads everything on its own
+        // when started, so errors are ignored.
+        api::client<io::locator_tag>(parent->m_connector, "locator").invoke<io::locator::refresh>(
+            [](const std::error_code&) { }, keys);
+    }
+};
+
+class raft_t::transport_t:
+    public raft::transport_t
+{
+    typedef std::tuple<uint64_t, bool> vote_result_type;
+    typedef std::tuple<uint64_t, bool, uint64_t> append_result_type;
+    typedef std::tuple<uint64_t, uint64_t> propose_result_type;
+
+    raft_t *const parent;
+
+    // Replies not received within this many milliseconds are considered lost.
+    const boost::posix_time::time_duration timeout;
+
+    std::map<std::string, api::client<io::raft_tag>> peers;
+
+public:
+    transport_t(raft_t* parent_, const std::map<std::string, std::vector<tcp::endpoint>>& endpoints,
+                uint64_t timeout_)
+    :
+        parent(parent_),
+        timeout(boost::posix_time::milliseconds(timeout_))
+    {
+        for(auto it = endpoints.begin(); it != endpoints.end(); ++it) {
+            // NOTE: Every peer gets a name of its own, so that its endpoints are not mixed up with
+            // the ones of the other nodes by the connector.
+            const auto name = "raft:" + it->first;
+
+            parent->m_connector->pin(name, io::protocol<io::raft_tag>::version::value, it->second);
+            peers.insert({it->first, api::client<io::raft_tag>(parent->m_connector, name)});
+        }
+    }
+
+    virtual
+    void
+    vote(const std::string& peer, const raft::vote_request_t& request) {
+        const auto asio = parent->m_asio;
+        const auto node = parent->m_node.get();
+
+        peers.at(peer).invoke_for<io::raft::vote>(timeout,
+            [=](const std::error_code& ec, const vote_result_type& result)
+        {
+            if(ec) return;
+
+            asio->post([=] {
+                node->on_vote_reply(peer, raft::vote_reply_t{
+                    std::get<0>(result),
+                    std::get<1>(result)
+                });
+            });
+        }, request.term, request.candidate, request.last_index, request.last_term);
+    }
+
+    virtual
+    void
+    append(const std::string& peer, const raft::append_request_t& request) {
+        const auto asio = parent->m_asio;
+        const auto node = parent->m_node.get();
+
+        std::vector<std::tuple<uint64_t, std::string>> entries;
+
+        entries.reserve(request.entries.size());
+
+        for(auto it = request.entries.begin(); it != request.entries.end(); ++it) {
+            entries.emplace_back(it->term, it->command);
+        }
+
+        peers.at(peer).invoke_for<io::raft::append>(timeout,
+            [=](const std::error_code& ec, const append_result_type& result)
+        {
+            if(ec) return;
+
+            asio->post([=] {
+                node->on_append_reply(peer, raft::append_reply_t{
+                    std::get<0>(result),
+                    std::get<1>(result),
+                    std::get<2>(result)
+                });
+            });
+        }, request.term, request.leader, request.prev_index, request.prev_term, entries,
+           request.commit);
+    }
+
+    virtual
+    void
+    install(const std::string& peer, const raft::install_request_t& request) {
+        const auto asio = parent->m_asio;
+        const auto node = parent->m_node.get();
+
+        peers.at(peer).invoke_for<io::raft::install>(timeout,
+            [=](const std::error_code& ec, uint64_t term)
+        {
+            if(ec) return;
+
+            asio->post([=] {
+                node->on_install_reply(peer, raft::install_reply_t{term});
+            });
+        }, request.term, request.leader, request.index, request.last_term, request.snapshot);
+    }
+
+    void
+    forward(const std::string& peer, const std::string& command,
+            const std::shared_ptr<std::promise<void>>& promise)
+    {
+        const auto asio = parent->m_asio;
+        const auto self = parent;
+
+        peers.at(peer).invoke_for<io::raft::propose>(timeout,
+            [=](const std::error_code& ec, const propose_result_type& result)
+        {
+            if(ec) {
+                return promise->set_exception(std::make_exception_ptr(std::system_error(ec,
+                    "unable to forward the command to the leader")));
+            }
+
+            asio->post([=] {
+                self->wait(std::get<0>(result), std::get<1>(result), promise);
+            });
+        }, command);
+    }
+};
+
+raft_t::raft_t(context_t& context, const std::string& name, const dynamic_t& args):
+    category_type(context, name, args),
+    m_log(context.log(name)),
+    m_asio(std::make_shared<io_service>()),
+    m_timer(*m_asio),
+    m_connector(std::make_shared<api::connector_t>(context, *m_asio)),
+    m_timeout(args.as_object().at("timeout", 5000u).as_uint())
+{
+    const auto& config = args.as_object();
+    const auto id = config.at("id").as_string();
+
+    raft::node_t::options_t options;
+
+    options.election   = config.at("election", 1000u).as_uint();
+    options.heartbeat  = config.at("heartbeat", 100u).as_uint();
+    options.batch      = config.at("batch", 256u).as_uint();
+    options.compaction = config.at("compaction", 4096u).as_uint();
+
+    if(options.heartbeat < kTickInterval || options.heartbeat >= options.election) {
+        throw cocaine::error_t("raft heartbeat interval must be between %d ms and election timeout",
+            kTickInterval);
+    }
+
+    // Peers are specified as {"id": ["host", port]}, the same way endpoints are serialized. Every
+    // node might use the same list, this node is skipped.
+    const auto peers_config = config.at("peers", dynamic_t::empty_object).as_object();
+
+    std::vector<std::string> peers;
+    std::map<std::string, std::vector<tcp::endpoint>> endpoints;
+
+    for(auto it = peers_config.begin(); it != peers_config.end(); ++it) {
+        if(it->first == id) {
+            continue;
+        }
+
+        const auto& endpoint = it->second.as_array();
+
+        if(endpoint.size() != 2) {
+            throw cocaine::error_t("raft peer '%s' endpoint must be a [host, port] pair",
+                it->first);
+        }
+
+        peers.push_back(it->first);
+        endpoints[it->first].emplace_back(address::from_string(endpoint[0].as_string()),
+            endpoint[1].as_uint());
+    }
+
+    m_journal   = std::make_unique<raft::journal_t>(config.at("path", "").as_string());
+    m_machine   = std::make_unique<machine_t>(this, config.at("refresh", "groups").as_string());
+    m_transport = std::make_unique<transport_t>(this, endpoints, options.election);
+    m_node      = std::make_unique<raft::node_t>(id, peers, options, *m_journal, *m_machine,
+        *m_transport);
+
+    COCAINE_LOG_INFO(m_log, "starting raft node '%s' with %d peer(s) at term %d", id, peers.size(),
+        m_journal->term());
+
+    m_ticked = std::chrono::steady_clock::now();
+
+    m_timer.expires_from_now(boost::posix_time::milliseconds(kTickInterval));
+    m_timer.async_wait(std::bind(&raft_t::on_tick, this, ph::_1));
+
+    m_chamber = std::make_unique<io::chamber_t>(name, m_asio);
+}
+
+raft_t::~raft_t() {
+    // Pending timers and replies are dropped along with the reactor.
+    m_asio->stop();
+    m_chamber = nullptr;
+}
+
+std::string
+raft_t::read(const std::string& collection, const std::string& key) {
+    return m_machine->state.apply([&](const state_type& mapping) -> std::string {
+        const auto it = mapping.find(collection);
+
+        if(it == mapping.end() || !it->second.count(key)) {
+            throw std::system_error(std::make_error_code(std::errc::no_such_file_or_directory),
+                collection + "/" + key);
+        }
+
+        return std::get<0>(it->second.at(key));
+    });
+}
+
+void
+raft_t::write(const std::string& collection, const std::string& key, const std::string& blob,
+              const std::vector<std::string>& tags)
+{
+    COCAINE_LOG_DEBUG(m_log, "writing object '%s'", key)("collection", collection);
+
+    commit(pack(command_type(write_operation, collection, key, object_type(blob, tags))));
+}
+
+void
+raft_t::remove(const std::string& collection, const std::string& key) {
+    COCAINE_LOG_DEBUG(m_log, "removing object '%s'", key)("collection", collection);
+
+    commit(pack(command_type(remove_operation, collection, key, object_type())));
+}
+
+std::vector<std::string>
+raft_t::find(const std::string& collection, const std::vector<std::string>& tags) {
+    std::vector<std::string> result;
+
+    if(tags.empty()) {
+        return result;
+    }
+
+    m_machine->state.apply([&](const state_type& mapping) {
+        const auto it = mapping.find(collection);
+
+        if(it == mapping.end()) {
+            return;
+        }
+
+        for(auto object = it->second.begin(); object != it->second.end(); ++object) {
+            const auto& object_tags = std::get<1>(object->second);
+
+            const bool tagged = std::all_of(tags.begin(), tags.end(), [&](const std::string& tag) {
+                return std::find(object_tags.begin(), object_tags.end(), tag) != object_tags.end();
+            });
+
+            if(tagged) result.push_back(object->first);
+        }
+    });
+
+    return result;
+}
+
+std::vector<std::string>
+raft_t::list(const std::string& collection, const std::string& prefix,
+             const std::string& start_after, size_t limit)
+{
+    std::vector<std::string> result;
+
+    m_machine->state.apply([&](const state_type& mapping) {
+        const auto it = mapping.find(collection);
+
+        if(it == mapping.end()) {
+            return;
+        }
+
+        const auto& objects = it->second;
+
+        auto object = start_after < prefix ? objects.lower_bound(prefix)
+                                           : objects.upper_bound(start_after);
+
+        for(; object != objects.end() && (!limit || result.size() < limit); ++object) {
+            if(object->first.compare(0, prefix.size(), prefix) != 0) {
+                break;
+            }
+
+            result.push_back(object->first);
+        }
+    });
+
+    return result;
+}
+
+void
+raft_t::invoke(std::function<void(raft::node_t&)> function) {
+    const auto node = m_node.get();
+
+    m_asio->post([=] {
+        function(*node);
+    });
+}
+
+void
+raft_t::on_tick(const std::error_code& ec) {
+    if(ec == asio::error::operation_aborted) {
+        return;
+    }
+
+    const auto leader = m_node->leader();
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - m_ticked);
+
+    // NOTE: The remainder is carried over to the next tick, so that the node clock doesn't drift.
+    m_ticked += elapsed;
+    m_node->tick(elapsed.count());
+
+    if(m_node->leader() != leader && !m_node->leader().empty()) {
+        COCAINE_LOG_INFO(m_log, "raft leader is '%s' at term %d", m_node->leader(), m_node->term());
+    }
+
+    m_timer.expires_from_now(boost::posix_time::milliseconds(kTickInterval));
+    m_timer.async_wait(std::bind(&raft_t::on_tick, this, ph::_1));
+}
+
+void
+raft_t::commit(const std::string& command) {
+    const auto promise = std::make_shared<std::promise<void>>();
+    auto future = promise->get_future();
+
+    m_asio->post(std::bind(&raft_t::propose, this, command, promise));
+
+    if(future.wait_for(std::chrono::milliseconds(m_timeout)) != std::future_status::ready) {
+        throw std::system_error(std::make_error_code(std::errc::timed_out),
+            "unable to commit the command");
+    }
+
+    future.get();
+}
+
+void
+raft_t::propose(const std::string& command, const std::shared_ptr<std::promise<void>>& promise) {
+    if(const auto index = m_node->propose(command)) {
+        return wait(index, m_node->term(), promise);
+    }
+
+    if(m_node->leader().empty()) {
+        return promise->set_exception(make_error(std::errc::resource_unavailable_try_again,
+            "raft leader is not elected"));
+    }
+
+    m_transport->forward(m_node->leader(), command, promise);
+}
+
+void
+raft_t::wait(uint64_t index, uint64_t term, const std::shared_ptr<std::promise<void>>& promise) {
+    if(index > m_node->applied()) {
+        return m_machine->wait(index, term, promise);
+    }
+
+    // The entry has already been applied, e.g. the follower has learned about it before the
+    // leader's reply has arrived.
+    if(index >= m_journal->first() && m_journal->term(index) == term) {
+        promise->set_value();
+    } else {
+        promise->set_exception(make_error(std::errc::operation_canceled,
+            "command outcome is unknown"));
+    }
+}
@@ -0,0 +1,278 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/timing_wheel.hpp"
+
+#include <limits>
+
+using namespace cocaine::io;
+
+namespace ph = std::placeholders;
+
+asio::io_service::id timing_wheel_t::id;
+
+timing_wheel_t::timing_wheel_t(asio::io_service& asio):
+    asio::io_service::service(asio),
+    m_epoch(std::chrono::steady_clock::now()),
+    m_next(0),
+    m_timer(asio),
+    m_armed(std::numeric_limits<uint64_t>::max())
+{
+    m_slots.fill(nullptr);
+    m_occupied.fill(0);
+}
+
+uint64_t
+timing_wheel_t::now() const {
+    const uint64_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - m_epoch
+    ).count();
+
+    return std::max(elapsed, m_next);
+}
+
+void
+timing_wheel_t::shutdown_service() {
+    std::vector<handler_type> handlers;
+
+    // NOTE: Handlers are destroyed only after every entry is unlinked, because destroying them might
+    // destroy the timers owning other entries as well.
+    for(auto it = m_slots.begin(); it != m_slots.end(); ++it) {
+        while(*it) {
+            entry_t& entry = **it;
+
+            handlers.push_back(std::move(entry.handler));
+            unlink(entry);
+        }
+    }
+
+    std::error_code ec;
+
+    m_timer.cancel(ec);
+    handlers.clear();
+}
+
+void
+timing_wheel_t::link(entry_t& entry) {
+    if(m_armed == std::numeric_limits<uint64_t>::max()) {
+        // The wheel is empty, so fast-forward it instead of catching up later.
+        m_next = std::max(m_next, now());
+    }
+
+    entry.deadline = std::max(entry.deadline, m_next);
+
+    const uint64_t delta = entry.deadline - m_next;
+
+    unsigned int level = 0;
+
+    while(level + 1 < kLevelCount && delta >> (kLevelBits * (level + 1))) {
+        level++;
+    }
+
+    uint64_t expiry = entry.deadline;
+
+    if(delta >> (kLevelBits * kLevelCount)) {
+        // Too far away, so put it into the farthest slot to be cascaded down the levels again.
+        expiry = m_next + (uint64_t(1) << (kLevelBits * kLevelCount)) - 1;
+    }
+
+    const unsigned int shift = kLevelBits * level;
+    const unsigned int slot  = level * kSlotCount + ((expiry >> shift) & kSlotMask);
+
+    entry.prev = nullptr;
+    entry.next = m_slots[slot];
+    entry.slot = slot;
+
+    if(entry.next) {
+        entry.next->prev = &entry;
+    }
+
+    m_slots[slot] = &entry;
+    m_occupied[slot / 64] |= uint64_t(1) << (slot % 64);
+
+    // Entries of the upper levels are processed when their slot is cascaded.
+    const uint64_t tick = (expiry >> shift) << shift;
+
+    if(tick < m_armed) {
+        arm(tick);
+    }
+}
+
+void
+timing_wheel_t::unlink(entry_t& entry) {
+    BOOST_ASSERT(entry.slot != kUnlinked);
+
+    if(entry.prev) {
+        entry.prev->next = entry.next;
+    } else {
+        m_slots[entry.slot] = entry.next;
+    }
+
+    if(entry.next) {
+        entry.next->prev = entry.prev;
+    }
+
+    if(!m_slots[entry.slot] && entry.slot != kExpiring) {
+        m_occupied[entry.slot / 64] &= ~(uint64_t(1) << (entry.slot % 64));
+    }
+
+    entry.slot = kUnlinked;
+}
+
+void
+timing_wheel_t::advance(uint64_t target) {
+    while(m_next <= target) {
+        // Skip straight to the next tick which has some slot to expire or to cascade, so that empty
+        // stretches of the wheel are skipped in one step, regardless of their length.
+        const uint64_t tick = due();
+
+        if(tick > target) {
+            m_next = target + 1;
+            break;
+        }
+
+        // NOTE: Cascaded entries are linked relative to the tick being processed.
+        m_next = tick;
+
+        if((tick & kSlotMask) == 0) {
+            cascade(1, tick);
+        }
+
+        const unsigned int slot = tick & kSlotMask;
+
+        m_slots[kExpiring] = m_slots[slot];
+        m_slots[slot] = nullptr;
+        m_occupied[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+
+        for(entry_t* it = m_slots[kExpiring]; it; it = it->next) {
+            it->slot = kExpiring;
+        }
+
+        m_next = tick + 1;
+
+        // Handlers are free to start and cancel other timers, including the ones expiring right now.
+        while(m_slots[kExpiring]) {
+            entry_t& entry = *m_slots[kExpiring];
+
+            unlink(entry);
+
+            const handler_type handler = std::move(entry.handler);
+
+            entry.handler = nullptr;
+            handler(std::error_code());
+        }
+    }
+}
+
+void
+timing_wheel_t::cascade(unsigned int level, uint64_t tick) {
+    const unsigned int index = (tick >> (kLevelBits * level)) & kSlotMask;
+
+    if(index == 0 && level + 1 < kLevelCount) {
+        cascade(level + 1, tick);
+    }
+
+    const unsigned int slot = level * kSlotCount + index;
+
+    entry_t* it = m_slots[slot];
+
+    m_slots[slot] = nullptr;
+    m_occupied[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+
+    while(it) {
+        entry_t& entry = *it;
+
+        it = it->next;
+        link(entry);
+    }
+}
+
+unsigned int
+timing_wheel_t::find(unsigned int level, unsigned int from) const {
+    for(unsigned int index = from; index < kSlotCount; index = (index | 63) + 1) {
+        const unsigned int slot = level * kSlotCount + index;
+        const uint64_t word = m_occupied[slot / 64] >> (slot % 64);
+
+        if(word) {
+            return index + __builtin_ctzll(word);
+        }
+    }
+
+    return kSlotCount;
+}
+
+uint64_t
+timing_wheel_t::due() const {
+    uint64_t result = std::numeric_limits<uint64_t>::max();
+
+    for(unsigned int level = 0; level < kLevelCount; ++level) {
+        const unsigned int shift = kLevelBits * level;
+
+        // The first tick at which this level is going to be processed, in this level's units.
+        const uint64_t first = (m_next + (uint64_t(1) << shift) - 1) >> shift;
+        const unsigned int origin = first & kSlotMask;
+
+        unsigned int index = find(level, origin);
+        uint64_t units;
+
+        if(index < kSlotCount) {
+            units = first + (index - origin);
+        } else if((index = find(level, 0)) < origin) {
+            units = first + (kSlotCount - origin) + index;
+        } else {
+            continue;
+        }
+
+        result = std::min(result, units << shift);
+    }
+
+    return result;
+}
+
+void
+timing_wheel_t::arm(uint64_t tick) {
+    const uint64_t current = now();
+
+    m_armed = tick;
+
+    m_timer.expires_from_now(boost::posix_time::milliseconds(tick > current ? tick - current : 0));
+    m_timer.async_wait(std::bind(&timing_wheel_t::on_timer, this, ph::_1));
+}
+
+void
+timing_wheel_t::on_timer(const std::error_code& ec) {
+    if(ec == asio::error::operation_aborted) {
+        return;
+    }
+
+    // NOTE: Prevents the timer from being re-armed by every timeout started by the handlers, it's
+    // re-armed once all the expired ticks are processed.
+    m_armed = 0;
+
+    advance(now());
+
+    const uint64_t tick = due();
+
+    if(tick != std::numeric_limits<uint64_t>::max()) {
+        arm(tick);
+    } else {
+        m_armed = tick;
+    }
+}
@@ -23,7 +23,6 @@
 #include "cocaine/errors.hpp"
 
 #include <random>
-#include <sstream>
 
 #include <boost/thread/tss.hpp>
 
@@ -138,9 +137,16 @@ trace_t::generate_id() {
 
 std::string
 trace_t::to_hex_string(uint64_t value) {
-    std::ostringstream oss;
-    oss << std::hex << value;
-    return oss.str();
+    static const char digits[] = "0123456789abcdef";
+
+    char buffer[16];
+    char* it = buffer + sizeof(buffer);
+
+    do {
+        *--it = digits[value & 0xF];
+    } while(value >>= 4);
+
+    return std::string(it, buffer + sizeof(buffer));
 }
 
 trace_t::restore_scope_t::restore_scope_t(const boost::optional<trace_t>& new_trace) :
@@ -1,26 +1,26 @@
 #include "cocaine/common.hpp"
 
-#include "cocaine/api/connect.hpp"
-#include "cocaine/api/resolve.hpp"
-#include "cocaine/api/service.hpp"
+#include "cocaine/api/client.hpp"
 
 #include "cocaine/context.hpp"
+#include "cocaine/context/config.hpp"
 
-#include "cocaine/detail/actor.hpp"
-#include "cocaine/detail/chamber.hpp"
-#include "cocaine/detail/engine.hpp"
-
+#include "cocaine/format.hpp"
 #include "cocaine/logging.hpp"
+#include "cocaine/memory.hpp"
 
+#include "cocaine/rpc/actor.hpp"
 #include "cocaine/rpc/dispatch.hpp"
 
+#include <future>
+#include <iostream>
 #include <random>
 
 #include <celero/Celero.h>
 
-#include <asio/connect.hpp>
 #include <asio/io_service.hpp>
-#include <asio/ip/tcp.hpp>
+
+#include <boost/thread/thread.hpp>
 
 namespace cocaine { namespace io {
 
@@ -29,20 +29,6 @@ namespace cocaine { namespace io {
 struct test_tag;
 
 struct test {
-    struct mute_slot {
-        typedef test_tag tag;
-
-        static const char* alias() {
-            return "mute_slot";
-        }
-
-        typedef boost::mpl::list<
-            std::string
-        > argument_type;
-
-        typedef void upstream_type;
-    };
-
     struct void_slot {
         typedef test_tag tag;
 
@@ -79,7 +65,6 @@ struct protocol<test_tag> {
     > version;
 
     typedef boost::mpl::list<
-        test::mute_slot,
         test::void_slot,
         test::echo_slot
     > messages;
@@ -97,16 +82,10 @@ struct test_service_t:
     {
         using namespace std::placeholders;
 
-        on<io::test::mute_slot>(std::bind(&test_service_t::on_mute_slot, this, _1));
         on<io::test::void_slot>(std::bind(&test_service_t::on_void_slot, this, _1));
         on<io::test::echo_slot>(std::bind(&test_service_t::on_echo_slot, this, _1));
     }
 
-    void
-    on_mute_slot(const std::string& COCAINE_UNUSED_(input)) {
-        return;
-    }
-
     void
     on_void_slot(const std::string& COCAINE_UNUSED_(input)) {
         return;
@@ -142,77 +121,142 @@ globals() {
 struct test_fixture_t:
     public celero::TestFixture
 {
+    std::unique_ptr<cocaine::logging::logger_t> logger;
     std::unique_ptr<cocaine::context_t> context;
     std::unique_ptr<asio::io_service> reactor;
+    std::unique_ptr<asio::io_service::work> work;
     std::unique_ptr<boost::thread> chamber;
 
-    cocaine::api::client<cocaine::io::test_tag> service;
+    std::unique_ptr<cocaine::api::client<cocaine::io::test_tag>> service;
+
+    // Block pool counters of the benchmark thread and of the client's reactor thread, which sends the
+    // invocations and handles the replies.
+    typedef std::pair<cocaine::io::pool_stats_t, cocaine::io::pool_stats_t> stats_type;
+
+    stats_type stats;
+    uint64_t requests;
 
 public:
     virtual
     void
     setUp(int64_t) {
-        context.reset(new cocaine::context_t(cocaine::config_t("cocaine-benchmark.conf"), "core"));
+        using namespace cocaine;
+
+        logger.reset(new logging::logger_t(
+            blackhole::repository_t::instance().create<logging::logger_t>("root", logging::error)
+        ));
+
+        context.reset(new context_t(
+            config_t("cocaine-benchmark.conf"),
+            std::make_unique<logging::log_t>(*logger, blackhole::attribute::set_t())
+        ));
+
         reactor.reset(new asio::io_service());
+        work.reset(new asio::io_service::work(*reactor));
 
-        context->insert("benchmark", std::make_unique<cocaine::actor_t>(
+        context->insert("benchmark", std::make_unique<actor_t>(
            *context,
             std::make_shared<asio::io_service>(),
-            std::make_unique<cocaine::test_service_t>()
+            std::make_unique<test_service_t>()
         ));
 
-        auto endpoints = context->locate("benchmark").get().endpoints();
-        auto socket = std::make_unique<asio::ip::tcp::socket>(*reactor);
+        const auto connector = std::make_shared<api::connector_t>(*context, *reactor);
 
-        asio::connect(*socket, endpoints.begin(), endpoints.end());
+        // NOTE: Pinned, so that the benchmark doesn't depend on the Locator.
+        connector->pin("benchmark", io::protocol<io::test_tag>::version::value,
+            context->locate("benchmark")->endpoints());
 
-        service.connect(std::move(socket));
+        service.reset(new api::client<io::test_tag>(connector, "benchmark"));
         chamber.reset(new boost::thread([this]{ reactor->run(); }));
+
+        stats = snapshot();
+        requests = 0;
     }
 
     virtual
     void
     tearDown() {
+        const auto current = snapshot();
+
+        if(requests) {
+            std::cerr << cocaine::format(
+                "%d requests, heap allocations per request: %.2f in the benchmark thread, %.2f in the "
+                "reactor thread", requests,
+                static_cast<double>(current.first.heap - stats.first.heap) / requests,
+                static_cast<double>(current.second.heap - stats.second.heap) / requests
+            ) << std::endl;
+        }
+
+        service.reset();
+        work.reset();
         reactor->stop();
-        context->remove("benchmark");
         chamber->join();
+        context->remove("benchmark");
+    }
+
+    auto
+    snapshot() -> stats_type {
+        std::promise<cocaine::io::pool_stats_t> reactor_stats;
+
+        reactor->post([&] { reactor_stats.set_value(cocaine::io::pool_stats()); });
+
+        return stats_type(cocaine::io::pool_stats(), reactor_stats.get_future().get());
+    }
+
+    // Every invocation waits for its reply, so that the iterations measure complete round trips.
+
+    void
+    void_slot(const std::string& data) {
+        std::promise<void> done;
+
+        requests++;
+
+        service->invoke<cocaine::io::test::void_slot>([&](const std::error_code&) {
+            done.set_value();
+        }, data);
+
+        done.get_future().wait();
+    }
+
+    void
+    echo_slot(const std::string& data) {
+        std::promise<void> done;
+
+        requests++;
+
+        service->invoke<cocaine::io::test::echo_slot>([&](const std::error_code&, const std::string&) {
+            done.set_value();
+        }, data);
+
+        done.get_future().wait();
     }
 };
 
-BASELINE_F (ClientIoBenchmark1K,  MuteSlot, test_fixture_t, 10, 100000) {
-    service.invoke<cocaine::io::test::mute_slot>(nullptr, globals().data1K);
-}
+// NOTE: There's no benchmark for mute slots anymore, since the client needs a reply to complete an
+// invocation.
 
-BENCHMARK_F(ClientIoBenchmark1K,  VoidSlot, test_fixture_t, 10, 100000) {
-    service.invoke<cocaine::io::test::void_slot>(nullptr, globals().data1K);
+BASELINE_F (ClientIoBenchmark1K,  VoidSlot, test_fixture_t, 10, 100000) {
+    void_slot(globals().data1K);
 }
 
 BENCHMARK_F(ClientIoBenchmark1K,  EchoSlot, test_fixture_t, 10, 100000) {
-    service.invoke<cocaine::io::test::echo_slot>(nullptr, globals().data1K);
-}
-
-BASELINE_F (ClientIoBenchmark8K,  MuteSlot, test_fixture_t, 10, 100000) {
-    service.invoke<cocaine::io::test::mute_slot>(nullptr, globals().data8K);
+    echo_slot(globals().data1K);
 }
 
-BENCHMARK_F(ClientIoBenchmark8K,  VoidSlot, test_fixture_t, 10, 100000) {
-    service.invoke<cocaine::io::test::void_slot>(nullptr, globals().data8K);
+BASELINE_F (ClientIoBenchmark8K,  VoidSlot, test_fixture_t, 10, 100000) {
+    void_slot(globals().data8K);
 }
 
 BENCHMARK_F(ClientIoBenchmark8K,  EchoSlot, test_fixture_t, 10, 100000) {
-    service.invoke<cocaine::io::test::echo_slot>(nullptr, globals().data8K);
-}
-
-BASELINE_F (ClientIoBenchmark65K, MuteSlot, test_fixture_t, 10, 100000) {
-    service.invoke<cocaine::io::test::mute_slot>(nullptr, globals().data65K);
+    echo_slot(globals().data8K);
 }
 
-BENCHMARK_F(ClientIoBenchmark65K, VoidSlot, test_fixture_t, 10, 100000) {
-    service.invoke<cocaine::io::test::void_slot>(nullptr, globals().data65K);
+BASELINE_F (ClientIoBenchmark65K, VoidSlot, test_fixture_t, 10, 100000) {
+    void_slot(globals().data65K);
 }
 
 BENCHMARK_F(ClientIoBenchmark65K, EchoSlot, test_fixture_t, 10, 100000) {
-    service.invoke<cocaine::io::test::echo_slot>(nullptr, globals().data65K);
+    echo_slot(globals().data65K);
 }
 
 CELERO_MAIN
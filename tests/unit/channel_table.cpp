@@ -0,0 +1,214 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cocaine/detail/channel_table.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <map>
+#include <random>
+
+using namespace cocaine::io;
+
+namespace {
+
+// Slot of the channel in the table, or -1 if it's not there.
+int
+slot(const channel_table_t& table, uint64_t channel_id) {
+    const auto& slots = table.channels();
+
+    for(size_t i = 0; i < slots.size(); ++i) {
+        if(slots[i].id == channel_id) return static_cast<int>(i);
+    }
+
+    return -1;
+}
+
+} // namespace
+
+TEST(channel_table, insert_and_find) {
+    channel_table_t table;
+
+    EXPECT_FALSE(table.find(1));
+
+    EXPECT_EQ(1, table.insert(1, nullptr, nullptr).id);
+    EXPECT_EQ(2, table.insert(2, nullptr, nullptr).id);
+
+    ASSERT_TRUE(table.find(1));
+    EXPECT_EQ(1, table.find(1)->id);
+    EXPECT_EQ(2, table.find(2)->id);
+    EXPECT_FALSE(table.find(3));
+
+    EXPECT_EQ(2, table.size());
+}
+
+TEST(channel_table, erase) {
+    channel_table_t table;
+
+    table.insert(1, nullptr, nullptr);
+
+    EXPECT_FALSE(table.erase(2));
+
+    ASSERT_TRUE(table.erase(1));
+    EXPECT_FALSE(table.find(1));
+    EXPECT_FALSE(table.erase(1));
+
+    EXPECT_EQ(0, table.size());
+}
+
+TEST(channel_table, update) {
+    channel_table_t table;
+
+    table.insert(1, nullptr, nullptr);
+
+    EXPECT_TRUE(table.update(1, nullptr));
+    EXPECT_FALSE(table.update(2, nullptr));
+}
+
+TEST(channel_table, collisions_wrap_around) {
+    channel_table_t table;
+
+    // All of them hash into the last slot.
+    table.insert(15, nullptr, nullptr);
+    table.insert(31, nullptr, nullptr);
+    table.insert(47, nullptr, nullptr);
+
+    EXPECT_EQ(15, slot(table, 15));
+    EXPECT_EQ(0,  slot(table, 31));
+    EXPECT_EQ(1,  slot(table, 47));
+
+    ASSERT_TRUE(table.erase(15));
+
+    // Both are shifted back across the end of the table.
+    EXPECT_EQ(15, slot(table, 31));
+    EXPECT_EQ(0,  slot(table, 47));
+
+    EXPECT_TRUE(table.find(31));
+    EXPECT_TRUE(table.find(47));
+}
+
+TEST(channel_table, backward_shift_deletion) {
+    channel_table_t table;
+
+    table.insert(1,  nullptr, nullptr);
+    table.insert(17, nullptr, nullptr);
+    table.insert(2,  nullptr, nullptr);
+    table.insert(4,  nullptr, nullptr);
+
+    EXPECT_EQ(1, slot(table, 1));
+    EXPECT_EQ(2, slot(table, 17));
+    EXPECT_EQ(3, slot(table, 2));
+    EXPECT_EQ(4, slot(table, 4));
+
+    ASSERT_TRUE(table.erase(1));
+
+    // Displaced channels move closer to their home slots, the ones already there stay.
+    EXPECT_EQ(1, slot(table, 17));
+    EXPECT_EQ(2, slot(table, 2));
+    EXPECT_EQ(4, slot(table, 4));
+    EXPECT_EQ(-1, slot(table, 1));
+
+    const auto slots = table.channels();
+
+    EXPECT_EQ(0, slots[3].id);
+}
+
+TEST(channel_table, channels_in_home_slots_stay) {
+    channel_table_t table;
+
+    table.insert(1, nullptr, nullptr);
+    table.insert(2, nullptr, nullptr);
+
+    ASSERT_TRUE(table.erase(1));
+
+    EXPECT_EQ(-1, slot(table, 1));
+    EXPECT_EQ(2, slot(table, 2));
+}
+
+TEST(channel_table, grows) {
+    channel_table_t table;
+
+    for(uint64_t id = 1; id <= 1000; ++id) {
+        table.insert(id, nullptr, nullptr);
+    }
+
+    EXPECT_EQ(1000, table.size());
+    EXPECT_LE(2000, table.channels().size());
+
+    for(uint64_t id = 1; id <= 1000; ++id) {
+        EXPECT_TRUE(table.find(id));
+    }
+}
+
+TEST(channel_table, release) {
+    channel_table_t table;
+
+    table.insert(1, nullptr, nullptr);
+    table.insert(2, nullptr, nullptr);
+
+    const auto released = table.channels().size();
+    const auto slots = table.release();
+
+    EXPECT_EQ(released, slots.size());
+    EXPECT_EQ(2, std::count_if(slots.begin(), slots.end(), [](const channel_table_t::channel_t& c) {
+        return c.id != 0;
+    }));
+
+    EXPECT_EQ(0, table.size());
+    EXPECT_FALSE(table.find(1));
+
+    // The table is empty, but still usable.
+    table.insert(3, nullptr, nullptr);
+    EXPECT_TRUE(table.find(3));
+}
+
+TEST(channel_table, matches_map) {
+    channel_table_t table;
+    std::map<uint64_t, bool> model;
+
+    std::mt19937 generator(42);
+
+    uint64_t next = 1;
+
+    for(int i = 0; i < 20000; ++i) {
+        if(model.empty() || generator() % 3) {
+            // Channel ids are sequential, with gaps for the ones used by the other side.
+            next += 1 + generator() % 4;
+
+            table.insert(next, nullptr, nullptr);
+            model[next] = true;
+        } else {
+            auto it = model.begin();
+            std::advance(it, generator() % model.size());
+
+            ASSERT_TRUE(table.erase(it->first));
+            model.erase(it);
+        }
+
+        if(i % 1000 == 0) {
+            ASSERT_EQ(model.size(), table.size());
+
+            for(auto it = model.begin(); it != model.end(); ++it) {
+                ASSERT_TRUE(table.find(it->first));
+            }
+        }
+    }
+}
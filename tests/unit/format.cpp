@@ -0,0 +1,172 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cocaine/format.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <ostream>
+
+using cocaine::format;
+
+namespace {
+
+struct streamable_t {
+    int value;
+};
+
+std::ostream&
+operator<<(std::ostream& stream, const streamable_t& object) {
+    return stream << "streamable(" << object.value << ")";
+}
+
+} // namespace
+
+TEST(format, literal) {
+    EXPECT_EQ("", format(""));
+    EXPECT_EQ("no directives", format("no directives"));
+    EXPECT_EQ("100%", format("100%%"));
+    EXPECT_EQ("%d", format("%%d"));
+    EXPECT_EQ("%42%", format("%%%d%%", 42));
+    EXPECT_EQ(std::string("a\0b", 3), format(std::string("a\0b", 3)));
+}
+
+TEST(format, width_and_flags) {
+    EXPECT_EQ("   42", format("%5d", 42));
+    EXPECT_EQ("42   |", format("%-5d|", 42));
+    EXPECT_EQ("00042", format("%05d", 42));
+    EXPECT_EQ("+42", format("%+d", 42));
+    EXPECT_EQ(" 42", format("% d", 42));
+    EXPECT_EQ("0x2a", format("%#x", 42));
+    EXPECT_EQ("2A", format("%X", 42));
+    EXPECT_EQ("52", format("%o", 42));
+    EXPECT_EQ("   -7", format("%5d", -7));
+    EXPECT_EQ("  abc", format("%5s", "abc"));
+    EXPECT_EQ("abc  |", format("%-5s|", std::string("abc")));
+    EXPECT_EQ("abcdef", format("%3s", "abcdef"));
+}
+
+TEST(format, precision) {
+    EXPECT_EQ("3.14", format("%.2f", 3.14159));
+    EXPECT_EQ("     3.142", format("%10.3f", 3.14159));
+    EXPECT_EQ("3.142    |", format("%-9.3f|", 3.14159));
+    EXPECT_EQ("1.500000e+00", format("%e", 1.5));
+    EXPECT_EQ("0.5", format("%s", 0.5));
+    EXPECT_EQ("2.000", format("%.3f", 2));
+}
+
+TEST(format, length_modifiers_are_ignored) {
+    EXPECT_EQ("42", format("%lld", 42));
+    EXPECT_EQ("42", format("%hhu", 42u));
+    EXPECT_EQ("42", format("%zu", static_cast<size_t>(42)));
+    EXPECT_EQ("42", format("%ld", static_cast<int64_t>(42)));
+}
+
+TEST(format, integral) {
+    EXPECT_EQ("0", format("%d", 0));
+    EXPECT_EQ("-1", format("%d", -1));
+    EXPECT_EQ("18446744073709551615", format("%d", UINT64_MAX));
+    EXPECT_EQ("-9223372036854775808", format("%d", INT64_MIN));
+    EXPECT_EQ("9223372036854775807", format("%s", INT64_MAX));
+    EXPECT_EQ("65535", format("%d", static_cast<uint16_t>(65535)));
+    EXPECT_EQ("-32768", format("%u", static_cast<int16_t>(-32768)));
+}
+
+TEST(format, floating_point) {
+    EXPECT_EQ("0.25", format("%s", 0.25f));
+    EXPECT_EQ("1e+20", format("%d", 1e20));
+    EXPECT_EQ("0.125", format("%.3Lf", static_cast<long double>(0.125)));
+}
+
+TEST(format, boolean) {
+    EXPECT_EQ("1", format("%s", true));
+    EXPECT_EQ("0", format("%d", false));
+    EXPECT_EQ("   1", format("%4s", true));
+}
+
+TEST(format, characters) {
+    EXPECT_EQ("x", format("%c", 'x'));
+    EXPECT_EQ("x", format("%s", 'x'));
+    EXPECT_EQ("y", format("%s", static_cast<signed char>('y')));
+    EXPECT_EQ("z", format("%s", static_cast<unsigned char>('z')));
+    EXPECT_EQ("x  |", format("%-3c|", 'x'));
+}
+
+TEST(format, strings) {
+    char mutable_string[] = "mutable";
+    const char* null_string = nullptr;
+
+    EXPECT_EQ("literal", format("%s", "literal"));
+    EXPECT_EQ("mutable", format("%s", mutable_string));
+    EXPECT_EQ("mutable", format("%s", static_cast<char*>(mutable_string)));
+    EXPECT_EQ("<null>", format("%s", null_string));
+    EXPECT_EQ("string", format("%s", std::string("string")));
+    EXPECT_EQ("", format("%s", std::string()));
+    EXPECT_EQ("1 two 3", format("%d %s %d", 1, "two", 3));
+}
+
+TEST(format, streamable) {
+    EXPECT_EQ("streamable(5)", format("%s", streamable_t{5}));
+    EXPECT_EQ("  streamable(5)", format("%15s", streamable_t{5}));
+    EXPECT_EQ("streamable(5)  |", format("%-15s|", streamable_t{5}));
+}
+
+TEST(format, inline_buffer_overflow) {
+    const std::string large(2000, 'a');
+
+    EXPECT_EQ(large, format("%s", large));
+    EXPECT_EQ("<" + large + ">", format("<%s>", large));
+    EXPECT_EQ(std::string(1500, ' ') + "x", format("%1501s", "x"));
+    EXPECT_EQ("x" + std::string(1500, ' '), format("%-1501s", "x"));
+    EXPECT_EQ(std::string(1000, '0') + "1", format("%01001d", 1));
+
+    // Each argument pushes the message further past the inline storage.
+    std::string expected;
+
+    for(int i = 0; i < 4; ++i) {
+        expected += large.substr(0, 300) + "|";
+    }
+
+    const std::string chunk = large.substr(0, 300);
+
+    EXPECT_EQ(expected, format("%s|%s|%s|%s|", chunk, chunk, chunk, chunk));
+}
+
+TEST(format, argument_count_mismatch) {
+    EXPECT_EQ("<unable to format message - format-string referred to more arguments than were "
+              "passed>", format("%s %s", "one"));
+    EXPECT_EQ("<unable to format message - format-string referred to less arguments than were "
+              "passed>", format("%s", "one", "two"));
+    EXPECT_EQ("<unable to format message - format-string referred to less arguments than were "
+              "passed>", format("no directives", 1));
+    EXPECT_EQ("<unable to format message - format-string referred to more arguments than were "
+              "passed>", format("%d"));
+}
+
+TEST(format, ill_formed) {
+    const std::string error = "<unable to format message - format-string is ill-formed>";
+
+    EXPECT_EQ(error, format("%", 1));
+    EXPECT_EQ(error, format("%5", 1));
+    EXPECT_EQ(error, format("trailing %-", 1));
+    EXPECT_EQ(error, format("%5!", 1));
+    EXPECT_EQ(error, format("%000000000000000000000000000000d", 1));
+}
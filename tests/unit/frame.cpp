@@ -0,0 +1,223 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cocaine/common.hpp>
+#include <cocaine/errors.hpp>
+
+#include <cocaine/idl/streaming.hpp>
+
+#include <cocaine/rpc/asio/compression.hpp>
+#include <cocaine/rpc/asio/decoder.hpp>
+#include <cocaine/rpc/asio/encoder.hpp>
+
+#include <cocaine/traits/literal.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace cocaine;
+using namespace cocaine::io;
+
+namespace {
+
+typedef streaming<boost::mpl::list<std::string>::type> protocol_type;
+
+std::string
+flatten(const encoder_t::encoded_message_type& message) {
+    std::vector<asio::const_buffer> buffers;
+    std::string result;
+
+    message.buffers(std::back_inserter(buffers));
+
+    for(auto it = buffers.begin(); it != buffers.end(); ++it) {
+        result.append(asio::buffer_cast<const char*>(*it), asio::buffer_size(*it));
+    }
+
+    EXPECT_EQ(message.size(), result.size());
+
+    return result;
+}
+
+std::string
+encode(encoder_t& encoder, uint64_t channel_id, const std::string& value) {
+    return flatten(encoder.encode(encoded<protocol_type::chunk>(channel_id, value)));
+}
+
+std::string
+argument(const decoder_t::message_type& message) {
+    EXPECT_EQ(1, message.args().via.array.size);
+
+    return message.args().via.array.ptr[0].as<std::string>();
+}
+
+} // namespace
+
+TEST(frame_v2, round_trip) {
+    encoder_t encoder;
+    decoder_t decoder;
+
+    encoder.upgrade();
+
+    const auto data = encode(encoder, 42, "hello");
+
+    EXPECT_EQ(static_cast<unsigned char>(frame_v2::marker), static_cast<unsigned char>(data[0]));
+    EXPECT_EQ(static_cast<unsigned char>(frame_v2::version), static_cast<unsigned char>(data[1]));
+
+    decoder_t::message_type message;
+    std::error_code ec;
+
+    EXPECT_EQ(data.size(), decoder.decode(data.data(), data.size(), message, ec));
+    EXPECT_FALSE(ec);
+
+    EXPECT_EQ(2, decoder.version());
+    EXPECT_EQ(42, message.span());
+    EXPECT_EQ(event_traits<protocol_type::chunk>::id, message.type());
+    EXPECT_EQ("hello", argument(message));
+}
+
+TEST(frame_v2, preamble_is_sent_once) {
+    encoder_t encoder;
+    decoder_t decoder;
+
+    encoder.upgrade();
+
+    const auto first  = encode(encoder, 1, "first");
+    const auto second = encode(encoder, std::numeric_limits<uint64_t>::max(), "second");
+
+    EXPECT_EQ(first.size() - frame_v2::preamble_size, second.size() - 1);
+
+    decoder_t::message_type message;
+    std::error_code ec;
+
+    EXPECT_EQ(first.size(), decoder.decode(first.data(), first.size(), message, ec));
+    EXPECT_FALSE(ec);
+
+    EXPECT_EQ(second.size(), decoder.decode(second.data(), second.size(), message, ec));
+    EXPECT_FALSE(ec);
+
+    EXPECT_EQ(std::numeric_limits<uint64_t>::max(), message.span());
+    EXPECT_EQ("second", argument(message));
+}
+
+TEST(frame_v2, follows_version_1_frames) {
+    encoder_t encoder;
+    decoder_t decoder;
+
+    const auto plain = encode(encoder, 1, "plain");
+
+    encoder.upgrade();
+
+    const auto data = plain + encode(encoder, 2, "compact");
+
+    decoder_t::message_type message;
+    std::error_code ec;
+
+    const size_t offset = decoder.decode(data.data(), data.size(), message, ec);
+
+    EXPECT_EQ(plain.size(), offset);
+    EXPECT_EQ(1, decoder.version());
+    EXPECT_EQ("plain", argument(message));
+
+    EXPECT_EQ(data.size() - offset, decoder.decode(data.data() + offset, data.size() - offset,
+        message, ec));
+    EXPECT_FALSE(ec);
+
+    EXPECT_EQ(2, decoder.version());
+    EXPECT_EQ(2, message.span());
+    EXPECT_EQ("compact", argument(message));
+}
+
+TEST(frame_v2, keeps_headers) {
+    encoder_t encoder;
+    decoder_t decoder;
+
+    encoder.upgrade();
+    encoder.push_header(hpack::headers::make_header<compression_header>());
+
+    const auto data = encode(encoder, 1, "value");
+
+    decoder_t::message_type message;
+    std::error_code ec;
+
+    decoder.decode(data.data(), data.size(), message, ec);
+
+    ASSERT_FALSE(ec);
+    ASSERT_TRUE(message.meta<compression_header>());
+    EXPECT_TRUE(message.meta<compression_header>()->get_value() == compression_header::value());
+}
+
+TEST(frame_v2, keeps_referenced_payloads) {
+    encoder_t encoder;
+    decoder_t decoder;
+
+    encoder.upgrade();
+
+    // Large enough to be referenced by the encoded message instead of being copied.
+    const std::string value(65536, 'x');
+    const auto data = encode(encoder, 1, value);
+
+    decoder_t::message_type message;
+    std::error_code ec;
+
+    EXPECT_EQ(data.size(), decoder.decode(data.data(), data.size(), message, ec));
+    EXPECT_FALSE(ec);
+    EXPECT_EQ(value, argument(message));
+}
+
+TEST(frame_v2, incomplete_frames) {
+    encoder_t encoder;
+    decoder_t decoder;
+
+    encoder.upgrade();
+
+    const auto data = encode(encoder, 1, "value");
+
+    decoder_t::message_type message;
+
+    for(size_t size = 0; size < data.size(); ++size) {
+        std::error_code ec;
+
+        EXPECT_EQ(0, decoder.decode(data.data(), size, message, ec));
+        EXPECT_EQ(error::insufficient_bytes, ec);
+    }
+
+    EXPECT_EQ(data.size(), decoder.frame_size(data.data(), frame_v2::preamble_size +
+        frame_v2::header_size));
+}
+
+TEST(frame_v2, rejects_frames_over_limit) {
+    encoder_t encoder;
+    decoder_t decoder;
+
+    encoder.upgrade();
+
+    const auto data = encode(encoder, 1, std::string(1024, 'x'));
+    const size_t size = frame_v2::preamble_size + frame_v2::header_size;
+
+    decoder.limit(1024);
+
+    // Rejected as soon as the header is known, before the body is buffered.
+    EXPECT_EQ(0, decoder.frame_size(data.data(), size));
+
+    decoder_t::message_type message;
+    std::error_code ec;
+
+    EXPECT_EQ(0, decoder.decode(data.data(), size, message, ec));
+    EXPECT_EQ(error::frame_format_error, ec);
+}
@@ -180,6 +180,36 @@ TEST(header_table_t, empty) {
     ASSERT_TRUE(table.empty());
 }
 
+TEST(header_table_t, set_capacity) {
+    header_table_t table;
+    ASSERT_THROW(table.set_capacity(header_table_t::max_data_capacity + 1), std::system_error);
+
+    // Capacity can be changed before anything is stored.
+    table.set_capacity(128);
+    ASSERT_EQ(table.data_capacity(), 128);
+    auto h = headers::make_header<headers::span_id<>>();
+    size_t count = table.data_capacity() / h.http2_size();
+    for(size_t i = 0; i < count; i++) {
+        table.push(h);
+    }
+    ASSERT_EQ(table.size(), header_static_table_t::get_size() + count);
+
+    // Growing the table keeps the stored headers.
+    table.set_capacity(header_table_t::max_data_capacity);
+    ASSERT_EQ(table.size(), header_static_table_t::get_size() + count);
+    ASSERT_EQ(table[header_static_table_t::size], h);
+    table.push(h);
+    ASSERT_EQ(table.size(), header_static_table_t::get_size() + count + 1);
+
+    // Shrinking the table evicts headers which do not fit anymore.
+    table.set_capacity(h.http2_size());
+    ASSERT_EQ(table.size(), header_static_table_t::get_size() + 1);
+    table.set_capacity(0);
+    ASSERT_TRUE(table.empty());
+    table.push(h);
+    ASSERT_TRUE(table.empty());
+}
+
 TEST(http2_integer_size,) {
     unsigned char buffer[10];
     std::random_device rd;
@@ -191,3 +221,43 @@ TEST(http2_integer_size,) {
         }
     }
 }
+
+TEST(msgpack_traits, literal) {
+    header_table_t table;
+    auto h = headers::make_header<table_size_header>();
+
+    msgpack::sbuffer buffer;
+    msgpack::packer<msgpack::sbuffer> packer(buffer);
+    msgpack_traits::pack_literal(packer, h);
+    ASSERT_EQ(buffer.size(), msgpack_traits::size_literal(h));
+
+    msgpack::unpacked unpacked;
+    msgpack::unpack(&unpacked, buffer.data(), buffer.size());
+
+    // Literals are not stored in the receiver's table.
+    std::vector<header_t> headers;
+    ASSERT_TRUE(msgpack_traits::unpack_entry(unpacked.get(), table, headers));
+    ASSERT_EQ(headers.size(), 1);
+    ASSERT_EQ(headers[0], h);
+    ASSERT_TRUE(table.empty());
+}
+
+TEST(msgpack_traits, capacity_update) {
+    header_table_t encoder_table;
+    header_table_t decoder_table;
+
+    msgpack::sbuffer buffer;
+    msgpack::packer<msgpack::sbuffer> packer(buffer);
+    msgpack_traits::pack_capacity(packer, encoder_table, 256);
+    ASSERT_EQ(buffer.size(), msgpack_traits::size_capacity());
+    ASSERT_EQ(encoder_table.data_capacity(), 256);
+
+    msgpack::unpacked unpacked;
+    msgpack::unpack(&unpacked, buffer.data(), buffer.size());
+
+    // Size updates are applied to the receiver's table and produce no headers.
+    std::vector<header_t> headers;
+    ASSERT_TRUE(msgpack_traits::unpack_entry(unpacked.get(), decoder_table, headers));
+    ASSERT_TRUE(headers.empty());
+    ASSERT_EQ(decoder_table.data_capacity(), 256);
+}
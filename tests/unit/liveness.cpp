@@ -0,0 +1,162 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cocaine/detail/liveness.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace cocaine;
+using namespace cocaine::io;
+
+namespace {
+
+// Checks the liveness every period like sessions do, with the wheel being driven by hand.
+struct session_t {
+    asio::io_service asio;
+    timing_wheel_t& wheel;
+
+    liveness_t liveness;
+
+    uint64_t handled;
+    uint64_t written;
+    size_t channels;
+
+    std::error_code verdict;
+    size_t pings;
+
+    session_t(uint64_t timeout, uint64_t heartbeat, uint64_t period):
+        wheel(asio::use_service<timing_wheel_t>(asio)),
+        liveness(timeout, heartbeat, period, std::make_unique<wheel_timer_t>(asio)),
+        handled(0),
+        written(0),
+        channels(0),
+        pings(0)
+    {
+        watch();
+    }
+
+    void
+    watch() {
+        liveness.timer->expires_from_now(boost::posix_time::milliseconds(liveness.period));
+        liveness.timer->async_wait([this](const std::error_code& ec) {
+            ASSERT_FALSE(ec);
+
+            if((verdict = liveness.check(handled, written, channels))) {
+                return;
+            }
+
+            if(liveness.ping()) {
+                pings++;
+            }
+
+            watch();
+        });
+    }
+
+    // Advances the wheel by the given number of periods.
+    void
+    run(size_t periods) {
+        for(size_t i = 0; i < periods && !verdict; ++i) {
+            wheel.advance(wheel.now() + liveness.period);
+        }
+    }
+};
+
+} // namespace
+
+TEST(liveness, detaches_idle_sessions) {
+    session_t session(1000, 0, 250);
+
+    session.run(3);
+    EXPECT_FALSE(session.verdict);
+
+    session.run(1);
+    EXPECT_EQ(error::idle_timeout, session.verdict);
+}
+
+TEST(liveness, keeps_sessions_with_traffic) {
+    session_t session(1000, 0, 250);
+
+    for(size_t i = 0; i < 10; ++i) {
+        session.handled++;
+        session.run(2);
+    }
+
+    EXPECT_FALSE(session.verdict);
+}
+
+TEST(liveness, keeps_sessions_with_open_channels) {
+    session_t session(1000, 0, 250);
+
+    // A slow request, which has no traffic until it's complete.
+    session.handled++;
+    session.channels++;
+    session.run(20);
+
+    EXPECT_FALSE(session.verdict);
+
+    // The idle time is only accounted once the channel is closed.
+    session.written++;
+    session.channels--;
+    session.run(4);
+
+    EXPECT_FALSE(session.verdict);
+
+    session.run(1);
+
+    EXPECT_EQ(error::idle_timeout, session.verdict);
+}
+
+TEST(liveness, pings_silent_peers) {
+    session_t session(0, 1000, 1000);
+
+    // Peers which haven't advertised heartbeat support are never pinged.
+    session.run(5);
+    EXPECT_EQ(0, session.pings);
+
+    session.liveness.supported = true;
+    session.handled++;
+
+    session.run(1);
+    EXPECT_EQ(0, session.pings);
+
+    session.run(1);
+    EXPECT_EQ(1, session.pings);
+
+    // The pong doesn't count as activity.
+    session.handled++;
+    session.liveness.control++;
+
+    session.run(2);
+    EXPECT_FALSE(session.verdict);
+    EXPECT_EQ(2, session.pings);
+}
+
+TEST(liveness, detaches_sessions_with_silent_peers) {
+    session_t session(0, 1000, 1000);
+
+    session.liveness.supported = true;
+
+    session.run(1);
+    EXPECT_EQ(1, session.pings);
+
+    session.run(1);
+    EXPECT_EQ(error::heartbeat_timeout, session.verdict);
+}
@@ -0,0 +1,166 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cocaine/common.hpp>
+#include <cocaine/errors.hpp>
+#include <cocaine/memory.hpp>
+
+#include <cocaine/idl/streaming.hpp>
+
+#include <cocaine/rpc/asio/encoder.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+using namespace cocaine;
+using namespace cocaine::io;
+
+TEST(pooled, recycles_blocks) {
+    pooled<char> allocator;
+
+    // Warm up the pool, in case this thread hasn't used it yet.
+    allocator.deallocate(allocator.allocate(64), 64);
+
+    const auto before = pool_stats();
+
+    char* block = allocator.allocate(64);
+    allocator.deallocate(block, 64);
+
+    EXPECT_EQ(block, allocator.allocate(64));
+    allocator.deallocate(block, 64);
+
+    const auto after = pool_stats();
+
+    EXPECT_EQ(before.heap, after.heap);
+    EXPECT_EQ(before.cached + 2, after.cached);
+}
+
+TEST(pooled, shares_size_classes) {
+    pooled<char> allocator;
+
+    char* block = allocator.allocate(33);
+    allocator.deallocate(block, 33);
+
+    // Both sizes round up to the same 64 byte block, including its header.
+    EXPECT_EQ(block, allocator.allocate(48));
+    allocator.deallocate(block, 48);
+}
+
+TEST(pooled, gives_blocks_back_to_allocating_thread) {
+    pooled<char> allocator;
+
+    allocator.deallocate(allocator.allocate(64), 64);
+
+    std::vector<char*> blocks;
+
+    for(int i = 0; i < 10; ++i) {
+        blocks.push_back(allocator.allocate(64));
+    }
+
+    const auto before = pool_stats();
+
+    // Freed by another thread, e.g. a reactor thread freeing a payload of a service thread.
+    std::thread([&] {
+        for(auto it = blocks.begin(); it != blocks.end(); ++it) {
+            allocator.deallocate(*it, 64);
+        }
+    }).join();
+
+    for(int i = 0; i < 10; ++i) {
+        char* block = allocator.allocate(64);
+
+        EXPECT_NE(blocks.end(), std::find(blocks.begin(), blocks.end(), block));
+        blocks[i] = block;
+    }
+
+    EXPECT_EQ(before.heap, pool_stats().heap);
+    EXPECT_EQ(before.cached + 10, pool_stats().cached);
+
+    for(auto it = blocks.begin(); it != blocks.end(); ++it) {
+        allocator.deallocate(*it, 64);
+    }
+}
+
+TEST(pooled, outlives_allocating_thread) {
+    pooled<char> allocator;
+
+    char* block = nullptr;
+
+    std::thread([&] { block = allocator.allocate(64); }).join();
+
+    // The cache of the exited thread takes the block back, and is handed over to the next thread.
+    allocator.deallocate(block, 64);
+
+    std::thread([&] {
+        char* recycled = allocator.allocate(64);
+
+        EXPECT_EQ(block, recycled);
+        EXPECT_EQ(0, pool_stats().heap);
+
+        allocator.deallocate(recycled, 64);
+    }).join();
+}
+
+TEST(pooled, leaves_large_blocks_to_heap) {
+    pooled<char> allocator;
+
+    // Allocation counters are only kept once the thread has used the pool.
+    allocator.deallocate(allocator.allocate(16), 16);
+
+    const auto before = pool_stats();
+
+    for(int i = 0; i < 10; ++i) {
+        allocator.deallocate(allocator.allocate(65536), 65536);
+    }
+
+    EXPECT_EQ(before.heap + 10, pool_stats().heap);
+    EXPECT_EQ(before.cached, pool_stats().cached);
+}
+
+TEST(pooled, warm_messages_avoid_heap) {
+    typedef streaming<boost::mpl::list<std::string>::type> protocol_type;
+
+    encoder_t encoder;
+
+    const std::string value(1024, 'x');
+
+    const auto encode = [&](uint64_t channel_id) -> size_t {
+        return encoder.encode(encoded<protocol_type::chunk>(channel_id, value)).size();
+    };
+
+    // The first messages fill the pool with the blocks for payloads and buffers.
+    for(uint64_t i = 1; i <= 10; ++i) {
+        encode(i);
+    }
+
+    const auto before = pool_stats();
+
+    for(uint64_t i = 11; i <= 110; ++i) {
+        ASSERT_LT(value.size(), encode(i));
+    }
+
+    const auto after = pool_stats();
+
+    EXPECT_EQ(before.heap, after.heap);
+    EXPECT_LE(before.cached + 200, after.cached);
+}
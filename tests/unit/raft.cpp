@@ -0,0 +1,413 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cocaine/detail/raft/journal.hpp>
+#include <cocaine/detail/raft/node.hpp>
+
+#include "temporary.hpp"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <memory>
+
+using namespace cocaine::raft;
+using namespace cocaine::unit;
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+// In-process cluster with in-memory journals. Messages are queued and delivered on step(), nodes
+// can be isolated, in which case everything sent to or from them is lost.
+
+class cluster_t {
+    struct message_t {
+        std::string from;
+        std::string to;
+        std::function<void()> deliver;
+    };
+
+    struct machine_impl_t:
+        public machine_t
+    {
+        std::vector<std::string> applied;
+
+        virtual
+        void
+        apply(uint64_t, uint64_t, const std::string& command) {
+            if(!command.empty()) applied.push_back(command);
+        }
+
+        virtual
+        std::string
+        snapshot() const {
+            std::string result;
+
+            for(auto it = applied.begin(); it != applied.end(); ++it) {
+                result += *it + ";";
+            }
+
+            return result;
+        }
+
+        virtual
+        void
+        restore(uint64_t, const std::string& snapshot) {
+            applied.clear();
+
+            size_t begin = 0, end;
+
+            while((end = snapshot.find(';', begin)) != std::string::npos) {
+                applied.push_back(snapshot.substr(begin, end - begin));
+                begin = end + 1;
+            }
+        }
+    };
+
+    struct transport_impl_t:
+        public transport_t
+    {
+        cluster_t* cluster;
+        std::string id;
+
+        virtual
+        void
+        vote(const std::string& peer, const vote_request_t& request) {
+            cluster->send(id, peer, [=](node_t& from, node_t& to) {
+                from.on_vote_reply(to.id(), to.on_vote(request));
+            });
+        }
+
+        virtual
+        void
+        append(const std::string& peer, const append_request_t& request) {
+            cluster->send(id, peer, [=](node_t& from, node_t& to) {
+                from.on_append_reply(to.id(), to.on_append(request));
+            });
+        }
+
+        virtual
+        void
+        install(const std::string& peer, const install_request_t& request) {
+            cluster->send(id, peer, [=](node_t& from, node_t& to) {
+                from.on_install_reply(to.id(), to.on_install(request));
+            });
+        }
+    };
+
+    struct member_t {
+        journal_t journal;
+        machine_impl_t machine;
+        transport_impl_t transport;
+        std::unique_ptr<node_t> node;
+
+        member_t():
+            journal(std::string())
+        { }
+    };
+
+    std::map<std::string, std::unique_ptr<member_t>> m_members;
+    std::deque<message_t> m_queue;
+
+public:
+    std::set<std::string> isolated;
+
+    cluster_t(size_t size, const node_t::options_t& options) {
+        std::vector<std::string> ids;
+
+        for(size_t i = 0; i < size; ++i) {
+            ids.push_back(std::string(1, 'a' + i));
+        }
+
+        for(auto it = ids.begin(); it != ids.end(); ++it) {
+            std::vector<std::string> peers;
+            std::remove_copy(ids.begin(), ids.end(), std::back_inserter(peers), *it);
+
+            auto& member = m_members[*it];
+
+            member.reset(new member_t());
+            member->transport.cluster = this;
+            member->transport.id = *it;
+            member->node.reset(new node_t(*it, peers, options, member->journal, member->machine,
+                member->transport));
+        }
+    }
+
+    node_t&
+    node(const std::string& id) {
+        return *m_members.at(id)->node;
+    }
+
+    const std::vector<std::string>&
+    applied(const std::string& id) {
+        return m_members.at(id)->machine.applied;
+    }
+
+    const journal_t&
+    journal(const std::string& id) {
+        return m_members.at(id)->journal;
+    }
+
+    // Returns the leader, if there's exactly one among the connected nodes.
+    std::string
+    leader() {
+        std::string result;
+
+        for(auto it = m_members.begin(); it != m_members.end(); ++it) {
+            if(isolated.count(it->first) || it->second->node->role() != node_t::role_t::leader) {
+                continue;
+            }
+
+            if(!result.empty()) return std::string();
+
+            result = it->first;
+        }
+
+        return result;
+    }
+
+    // Advances the clock by the given number of milliseconds, delivering the messages in between.
+    void
+    run(uint64_t duration) {
+        for(uint64_t elapsed = 0; elapsed < duration; elapsed += 10) {
+            for(auto it = m_members.begin(); it != m_members.end(); ++it) {
+                it->second->node->tick(10);
+            }
+
+            while(!m_queue.empty()) {
+                const auto message = m_queue.front();
+                m_queue.pop_front();
+
+                if(!isolated.count(message.from) && !isolated.count(message.to)) {
+                    message.deliver();
+                }
+            }
+        }
+    }
+
+private:
+    void
+    send(const std::string& from, const std::string& to,
+         std::function<void(node_t&, node_t&)> action)
+    {
+        m_queue.push_back(message_t{from, to, [=] { action(node(from), node(to)); }});
+    }
+};
+
+const node_t::options_t options = {150, 50, 16, 0};
+
+} // namespace
+
+TEST(raft_node_t, single) {
+    cluster_t cluster(1, options);
+
+    cluster.run(400);
+
+    ASSERT_EQ("a", cluster.leader());
+    ASSERT_NE(0, cluster.node("a").propose("x"));
+
+    EXPECT_EQ(std::vector<std::string>({"x"}), cluster.applied("a"));
+}
+
+TEST(raft_node_t, replication) {
+    cluster_t cluster(3, options);
+
+    cluster.run(1000);
+
+    const auto leader = cluster.leader();
+
+    ASSERT_FALSE(leader.empty());
+    EXPECT_EQ(0, cluster.node(leader == "a" ? "b" : "a").propose("x"));
+
+    for(int i = 0; i < 10; ++i) {
+        ASSERT_NE(0, cluster.node(leader).propose(std::to_string(i)));
+    }
+
+    cluster.run(200);
+
+    for(auto id: {"a", "b", "c"}) {
+        EXPECT_EQ(10, cluster.applied(id).size());
+        EXPECT_EQ(leader, cluster.node(id).leader());
+    }
+}
+
+TEST(raft_node_t, failover) {
+    cluster_t cluster(3, options);
+
+    cluster.run(1000);
+
+    const auto leader = cluster.leader();
+
+    ASSERT_FALSE(leader.empty());
+    ASSERT_NE(0, cluster.node(leader).propose("x"));
+
+    cluster.run(200);
+    cluster.isolated.insert(leader);
+
+    // Entries proposed by the isolated leader are never committed.
+    cluster.node(leader).propose("lost");
+    cluster.run(1000);
+
+    const auto successor = cluster.leader();
+
+    ASSERT_FALSE(successor.empty());
+    ASSERT_NE(leader, successor);
+    ASSERT_NE(0, cluster.node(successor).propose("y"));
+
+    cluster.isolated.clear();
+    cluster.run(1000);
+
+    for(auto id: {"a", "b", "c"}) {
+        EXPECT_EQ(std::vector<std::string>({"x", "y"}), cluster.applied(id));
+    }
+}
+
+TEST(raft_node_t, snapshot) {
+    node_t::options_t compacting = options;
+
+    compacting.compaction = 4;
+
+    cluster_t cluster(3, compacting);
+
+    cluster.run(1000);
+
+    const auto leader = cluster.leader();
+    const auto lagging = std::string(leader == "a" ? "b" : "a");
+
+    ASSERT_FALSE(leader.empty());
+
+    cluster.isolated.insert(lagging);
+
+    for(int i = 0; i < 20; ++i) {
+        ASSERT_NE(0, cluster.node(leader).propose(std::to_string(i)));
+        cluster.run(50);
+    }
+
+    ASSERT_GT(cluster.journal(leader).snapshot_index(), 1);
+
+    cluster.isolated.clear();
+    cluster.run(1000);
+
+    EXPECT_EQ(cluster.applied(leader), cluster.applied(lagging));
+    EXPECT_EQ(20, cluster.applied(lagging).size());
+}
+
+namespace {
+
+std::vector<entry_t>
+entries(std::initializer_list<const char*> commands) {
+    std::vector<entry_t> result;
+
+    for(auto it = commands.begin(); it != commands.end(); ++it) {
+        result.push_back(entry_t{1, *it});
+    }
+
+    return result;
+}
+
+std::vector<std::string>
+commands(const journal_t& journal) {
+    std::vector<std::string> result;
+
+    for(uint64_t index = journal.first(); index <= journal.last(); ++index) {
+        result.push_back(journal.at(index).command);
+    }
+
+    return result;
+}
+
+} // namespace
+
+TEST(raft_journal_t, restores) {
+    temporary_path_t path("cocaine-raft");
+
+    {
+        journal_t journal(path.string());
+
+        journal.assign(3, "b");
+        journal.append(entries({"x", "y", "z"}));
+        journal.compact(1, 1, "x;");
+    }
+
+    journal_t journal(path.string());
+
+    EXPECT_EQ(3, journal.term());
+    EXPECT_EQ("b", journal.vote());
+    EXPECT_EQ(1, journal.snapshot_index());
+    EXPECT_EQ("x;", journal.snapshot());
+    EXPECT_EQ(std::vector<std::string>({"y", "z"}), commands(journal));
+}
+
+TEST(raft_journal_t, drops_torn_tail) {
+    temporary_path_t path("cocaine-raft");
+
+    {
+        journal_t journal(path.string());
+        journal.append(entries({"x", "y", "zzzz"}));
+    }
+
+    const auto log  = path.path() / "log";
+    const auto size = fs::file_size(log);
+
+    // The last record is made of its term, its size and the four bytes of its command. Tearing it
+    // anywhere, including within its header, must leave the preceding entries intact.
+    for(uint64_t torn = 1; torn < 2 * sizeof(uint64_t) + 4; ++torn) {
+        temporary_path_t copy("cocaine-raft");
+
+        fs::create_directories(copy.path());
+        fs::copy_file(log, copy.path() / "log");
+        fs::resize_file(copy.path() / "log", size - torn);
+
+        journal_t journal(copy.string());
+
+        EXPECT_EQ(std::vector<std::string>({"x", "y"}), commands(journal)) << "torn: " << torn;
+    }
+}
+
+TEST(raft_journal_t, appends_after_torn_tail) {
+    temporary_path_t path("cocaine-raft");
+
+    {
+        journal_t journal(path.string());
+        journal.append(entries({"x", "y"}));
+    }
+
+    fs::resize_file(path.path() / "log", fs::file_size(path.path() / "log") - 1);
+
+    {
+        journal_t journal(path.string());
+
+        ASSERT_EQ(1, journal.last());
+
+        // New entries must not be appended after the torn bytes, otherwise they'd be lost as well.
+        journal.append(entries({"z"}));
+    }
+
+    journal_t journal(path.string());
+
+    EXPECT_EQ(std::vector<std::string>({"x", "z"}), commands(journal));
+}
@@ -0,0 +1,336 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cocaine/api/client.hpp>
+#include <cocaine/api/storage.hpp>
+
+#include <cocaine/context.hpp>
+
+#include <cocaine/detail/storage/raft.hpp>
+
+#include <cocaine/format.hpp>
+
+#include <cocaine/idl/raft.hpp>
+
+#include <cocaine/logging.hpp>
+
+#include <cocaine/traits/tuple.hpp>
+#include <cocaine/traits/vector.hpp>
+
+#include "temporary.hpp"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <asio/io_service.hpp>
+#include <asio/ip/tcp.hpp>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include <chrono>
+#include <future>
+#include <thread>
+
+using namespace cocaine;
+
+using namespace asio;
+using namespace asio::ip;
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+// Waits for the condition to hold, e.g. for a write to be replicated, and fails the test otherwise.
+::testing::AssertionResult
+eventually(std::function<bool()> condition, unsigned int timeout = 10000) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+
+    while(std::chrono::steady_clock::now() < deadline) {
+        try {
+            if(condition()) return ::testing::AssertionSuccess();
+        } catch(const std::system_error&) {
+            // Not yet, e.g. the leader is not elected or the object is not replicated yet.
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    return ::testing::AssertionFailure() << "condition doesn't hold within " << timeout << " ms";
+}
+
+port_t
+unused_port() {
+    io_service asio;
+    tcp::acceptor acceptor(asio, tcp::endpoint(address_v4::loopback(), 0));
+
+    return acceptor.local_endpoint().port();
+}
+
+// Cluster of real nodes in the same process, talking to each other over the loopback interface.
+// Every node is a context of its own, running the Raft service on a pinned port with the Raft
+// storage behind it. There's no Locator, so the peers can only be reached via pinned endpoints.
+
+class cluster_t {
+    const unit::temporary_path_t m_path;
+
+    std::unique_ptr<logging::logger_t> m_logger;
+
+    std::map<std::string, port_t> m_ports;
+    std::map<std::string, std::unique_ptr<context_t>> m_nodes;
+
+public:
+    explicit
+    cluster_t(size_t size):
+        m_path("cocaine-raft")
+    {
+        // NOTE: The default Blackhole configuration, only errors are logged.
+        m_logger = std::make_unique<logging::logger_t>(
+            blackhole::repository_t::instance().create<logging::logger_t>("root", logging::error)
+        );
+
+        for(size_t i = 0; i < size; ++i) {
+            m_ports[std::string(1, 'a' + i)] = unused_port();
+        }
+
+        for(auto it = m_ports.begin(); it != m_ports.end(); ++it) {
+            start(it->first);
+        }
+    }
+
+   ~cluster_t() {
+        m_nodes.clear();
+    }
+
+    // Starts the node, reusing its journal if it has been running before.
+    void
+    start(const std::string& id) {
+        const auto runtime = m_path.path() / id;
+
+        fs::create_directories(runtime);
+
+        std::string peers;
+
+        for(auto it = m_ports.begin(); it != m_ports.end(); ++it) {
+            peers += cocaine::format("%s\"%s\": [\"127.0.0.1\", %d]", peers.empty() ? "" : ", ",
+                it->first, it->second);
+        }
+
+        fs::ofstream stream(runtime / "cocaine.conf");
+
+        stream << cocaine::format(
+            "{\"version\": 3,"
+            " \"paths\": {\"plugins\": \"%s\", \"runtime\": \"%s\"},"
+            " \"network\": {\"endpoint\": \"127.0.0.1\", \"pool\": 1, \"pinned\": {\"raft\": %d}},"
+            " \"services\": {\"raft\": {\"type\": \"raft\", \"args\": {\"backend\": \"raft\"}}},"
+            " \"storages\": {\"raft\": {\"type\": \"raft\", \"args\": {"
+                "\"id\": \"%s\", \"path\": \"%s\", \"election\": 300, \"heartbeat\": 50,"
+                " \"timeout\": 2000, \"peers\": {%s}}}}}",
+            (m_path.path() / "plugins").string(), runtime.string(), m_ports.at(id), id,
+            (runtime / "journal").string(), peers
+        );
+
+        stream.close();
+
+        m_nodes[id] = std::make_unique<context_t>(
+            config_t((runtime / "cocaine.conf").string()),
+            std::make_unique<logging::log_t>(*m_logger, blackhole::attribute::set_t())
+        );
+    }
+
+    void
+    stop(const std::string& id) {
+        m_nodes.erase(id);
+    }
+
+    context_t&
+    context(const std::string& id) {
+        return *m_nodes.at(id);
+    }
+
+    // Same instance as the one the node's Raft service is running.
+    std::shared_ptr<api::storage_t>
+    storage(const std::string& id) {
+        return api::storage(context(id), "raft");
+    }
+
+    tcp::endpoint
+    endpoint(const std::string& id) const {
+        return tcp::endpoint(address_v4::loopback(), m_ports.at(id));
+    }
+};
+
+// Reactor for the test clients.
+
+class reactor_t {
+    io_service m_asio;
+    std::unique_ptr<io_service::work> m_work;
+    std::thread m_thread;
+
+public:
+    reactor_t():
+        m_work(new io_service::work(m_asio)),
+        m_thread([this] { m_asio.run(); })
+    { }
+
+   ~reactor_t() {
+        m_work.reset();
+        m_thread.join();
+    }
+
+    io_service&
+    asio() {
+        return m_asio;
+    }
+};
+
+} // namespace
+
+TEST(raft_storage_t, replicates_writes) {
+    cluster_t cluster(3);
+
+    ASSERT_TRUE(eventually([&] {
+        cluster.storage("a")->write("test", "x", "1", {"tag"});
+        return true;
+    }));
+
+    for(auto id: {"a", "b", "c"}) {
+        EXPECT_TRUE(eventually([&] { return cluster.storage(id)->read("test", "x") == "1"; }))
+            << "node: " << id;
+        EXPECT_EQ(std::vector<std::string>({"x"}), cluster.storage(id)->find("test", {"tag"}));
+    }
+
+    cluster.storage("b")->remove("test", "x");
+
+    for(auto id: {"a", "b", "c"}) {
+        EXPECT_TRUE(eventually([&] {
+            return cluster.storage(id)->list("test", "", "", 0).empty();
+        })) << "node: " << id;
+    }
+}
+
+TEST(raft_storage_t, forwards_writes_from_followers) {
+    cluster_t cluster(3);
+
+    ASSERT_TRUE(eventually([&] {
+        cluster.storage("a")->write("test", "a", "a", {});
+        return true;
+    }));
+
+    // At least two of the nodes are followers, which forward the writes to the leader, and the
+    // writes return only when applied locally.
+    for(auto id: {"a", "b", "c"}) {
+        ASSERT_NO_THROW(cluster.storage(id)->write("test", id, id, {})) << "node: " << id;
+        EXPECT_EQ(id, cluster.storage(id)->read("test", id));
+    }
+
+    for(auto id: {"a", "b", "c"}) {
+        EXPECT_TRUE(eventually([&] {
+            return cluster.storage(id)->list("test", "", "", 0) ==
+                std::vector<std::string>({"a", "b", "c"});
+        })) << "node: " << id;
+    }
+}
+
+TEST(raft_storage_t, catches_up_after_restart) {
+    cluster_t cluster(3);
+
+    ASSERT_TRUE(eventually([&] {
+        cluster.storage("a")->write("test", "x", "1", {});
+        return true;
+    }));
+
+    cluster.stop("c");
+
+    // The remaining nodes are still the majority.
+    ASSERT_TRUE(eventually([&] {
+        cluster.storage("a")->write("test", "y", "2", {});
+        return true;
+    }));
+
+    cluster.start("c");
+
+    EXPECT_TRUE(eventually([&] {
+        return cluster.storage("c")->read("test", "x") == "1" &&
+               cluster.storage("c")->read("test", "y") == "2";
+    }));
+}
+
+TEST(raft_service_t, replies_to_pinned_clients) {
+    cluster_t cluster(1);
+    reactor_t reactor;
+
+    const auto connector = std::make_shared<api::connector_t>(cluster.context("a"), reactor.asio());
+
+    // Wait for the node to elect itself, so that the vote below is for a stale term.
+    ASSERT_TRUE(eventually([&] {
+        cluster.storage("a")->write("test", "x", "1", {});
+        return true;
+    }));
+
+    connector->pin("raft:a", io::protocol<io::raft_tag>::version::value, {cluster.endpoint("a")});
+
+    std::promise<std::tuple<uint64_t, bool>> promise;
+
+    // Votes for the stale terms are never granted, but the node replies with its current term.
+    api::client<io::raft_tag>(connector, "raft:a").invoke<io::raft::vote>(
+        [&](const std::error_code& ec, const std::tuple<uint64_t, bool>& result)
+    {
+        if(ec) {
+            promise.set_exception(std::make_exception_ptr(std::system_error(ec)));
+        } else {
+            promise.set_value(result);
+        }
+    }, uint64_t(0), std::string("b"), uint64_t(0), uint64_t(0));
+
+    auto future = promise.get_future();
+
+    ASSERT_EQ(std::future_status::ready, future.wait_for(std::chrono::seconds(5)));
+
+    const auto result = future.get();
+
+    EXPECT_GE(std::get<0>(result), 1u);
+    EXPECT_FALSE(std::get<1>(result));
+}
+
+TEST(connector_t, rejects_pinned_version_mismatch) {
+    cluster_t cluster(1);
+    reactor_t reactor;
+
+    const auto connector = std::make_shared<api::connector_t>(cluster.context("a"), reactor.asio());
+
+    const auto version = io::protocol<io::raft_tag>::version::value;
+
+    connector->pin("raft:a", version + 1, {cluster.endpoint("a")});
+
+    std::promise<std::error_code> promise;
+
+    api::client<io::raft_tag>(connector, "raft:a").invoke<io::raft::vote>(
+        [&](const std::error_code& ec, const std::tuple<uint64_t, bool>&)
+    {
+        promise.set_value(ec);
+    }, uint64_t(0), std::string("b"), uint64_t(0), uint64_t(0));
+
+    auto future = promise.get_future();
+
+    ASSERT_EQ(std::future_status::ready, future.wait_for(std::chrono::seconds(5)));
+    EXPECT_EQ(std::error_code(cocaine::error::version_mismatch), future.get());
+}
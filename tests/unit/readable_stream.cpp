@@ -0,0 +1,230 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cocaine/rpc/asio/compression.hpp>
+#include <cocaine/rpc/asio/decoder.hpp>
+#include <cocaine/rpc/asio/readable_stream.hpp>
+
+#include <gtest/gtest.h>
+
+#include <asio/local/connect_pair.hpp>
+#include <asio/local/stream_protocol.hpp>
+#include <asio/write.hpp>
+
+using namespace cocaine;
+using namespace cocaine::io;
+
+namespace {
+
+typedef asio::local::stream_protocol protocol_type;
+typedef readable_stream<protocol_type, decoder_t> stream_type;
+
+// Plain version 1 message with a single string argument.
+std::string
+message(size_t size) {
+    msgpack::sbuffer buffer;
+    msgpack::packer<msgpack::sbuffer> packer(buffer);
+
+    packer.pack_array(3);
+    packer.pack_uint64(1);
+    packer.pack_uint64(0);
+    packer.pack_array(1);
+    packer.pack(std::string(size, 'x'));
+
+    return std::string(buffer.data(), buffer.size());
+}
+
+std::string
+frame(const std::string& plain) {
+    deflater_t deflater;
+
+    std::vector<char> block;
+    std::error_code ec;
+
+    deflater.deflate(plain.data(), plain.size(), block, ec);
+    deflater.flush(block, ec);
+
+    std::string result(1, static_cast<char>(compressed_frame::marker));
+
+    for(int shift = 24; shift >= 0; shift -= 8) {
+        result.push_back(static_cast<char>(block.size() >> shift & 0xFF));
+    }
+
+    return result.append(block.begin(), block.end());
+}
+
+// Sends the data to a stream with the given limit and reads a single message from it. The remote
+// peer shuts the connection down afterwards, so incomplete messages end with an error as well.
+std::error_code
+read(const std::string& data, size_t limit, bool compressed) {
+    asio::io_service asio;
+
+    auto socket = std::make_shared<protocol_type::socket>(asio);
+    protocol_type::socket peer(asio);
+
+    asio::local::connect_pair(*socket, peer);
+    asio::write(peer, asio::buffer(data));
+
+    peer.close();
+
+    auto stream = std::make_shared<stream_type>(socket);
+
+    stream->limit(limit);
+
+    if(compressed) {
+        stream->decompress();
+    }
+
+    decoder_t::message_type message;
+    std::error_code result = error::insufficient_bytes;
+
+    stream->read(message, [&](const std::error_code& ec) {
+        result = ec;
+    });
+
+    asio.run();
+
+    return result;
+}
+
+struct traffic_t {
+    // Number of pipelined messages and the size of their payloads.
+    size_t count;
+    size_t size;
+};
+
+// Reads pipelined messages from two streams sharing the same reactor and returns the order they were
+// handled in, as a string of stream names.
+std::string
+interleave(traffic_t a, traffic_t b, size_t messages, size_t bytes) {
+    asio::io_service asio;
+
+    struct reader_t {
+        char name;
+        std::shared_ptr<stream_type> stream;
+        decoder_t::message_type message;
+        size_t left;
+    };
+
+    std::string order;
+    std::vector<std::unique_ptr<protocol_type::socket>> peers;
+    std::vector<std::unique_ptr<reader_t>> readers;
+
+    std::function<void(reader_t&, const std::error_code&)> handle;
+
+    handle = [&](reader_t& reader, const std::error_code& ec) {
+        ASSERT_FALSE(ec);
+
+        order.push_back(reader.name);
+
+        if(--reader.left) {
+            reader.stream->read(reader.message, std::bind(handle, std::ref(reader),
+                std::placeholders::_1));
+        }
+    };
+
+    for(const auto& traffic: {std::make_pair('a', a), std::make_pair('b', b)}) {
+        auto socket = std::make_shared<protocol_type::socket>(asio);
+
+        peers.emplace_back(new protocol_type::socket(asio));
+        asio::local::connect_pair(*socket, *peers.back());
+
+        std::string data;
+
+        for(size_t i = 0; i < traffic.second.count; ++i) {
+            data.append(message(traffic.second.size));
+        }
+
+        asio::write(*peers.back(), asio::buffer(data));
+
+        readers.emplace_back(new reader_t{traffic.first, std::make_shared<stream_type>(socket), {},
+            traffic.second.count});
+        readers.back()->stream->schedule(messages, bytes);
+    }
+
+    for(auto& reader: readers) {
+        reader->stream->read(reader->message, std::bind(handle, std::ref(*reader),
+            std::placeholders::_1));
+    }
+
+    asio.run();
+
+    return order;
+}
+
+} // namespace
+
+TEST(readable_stream, accepts_frames_within_limit) {
+    EXPECT_EQ(std::error_code(), read(message(1000), 1024, false));
+}
+
+TEST(readable_stream, ignores_limit_for_plain_frames) {
+    // Plain frames don't tell their size upfront, so they are only buffered as they arrive.
+    EXPECT_EQ(std::error_code(), read(message(2000), 1024, false));
+}
+
+TEST(readable_stream, accepts_compressed_frames_within_limit) {
+    EXPECT_EQ(std::error_code(), read(frame(message(1000)), 1024, true));
+}
+
+TEST(readable_stream, rejects_compressed_frames_over_limit) {
+    std::string header(1, static_cast<char>(compressed_frame::marker));
+
+    // Claims a payload of 16MB, which is rejected before any of it is buffered.
+    header.append("\x01\x00\x00\x00", 4);
+
+    EXPECT_EQ(error::frame_format_error, read(header, 1024, true));
+}
+
+TEST(readable_stream, rejects_compressed_frames_inflating_over_limit) {
+    const auto data = frame(message(65536));
+
+    // The compressed frame itself fits the limit, but the message it inflates to doesn't.
+    ASSERT_LT(data.size(), 1024);
+
+    EXPECT_EQ(error::frame_format_error, read(data, 1024, true));
+}
+
+TEST(readable_stream, rejects_compressed_frames_unless_advertised) {
+    EXPECT_EQ(error::frame_format_error, read(frame(message(10)), 1024, false));
+}
+
+TEST(readable_stream, interleaves_sessions_message_by_message) {
+    const size_t unlimited = std::numeric_limits<size_t>::max();
+
+    // Pipelined messages of different sessions of the same reactor are handled in turns.
+    EXPECT_EQ("ababab", interleave({3, 10}, {3, 10}, 1, unlimited));
+}
+
+TEST(readable_stream, handles_messages_within_quantum_at_once) {
+    const size_t unlimited = std::numeric_limits<size_t>::max();
+
+    // A larger quantum trades fairness for fewer reactor round trips.
+    EXPECT_EQ("aabbab", interleave({3, 10}, {3, 10}, 2, unlimited));
+}
+
+TEST(readable_stream, shares_turns_by_bytes) {
+    // Small messages are 15 bytes long and large ones are 106 bytes long, so with 60 bytes per turn
+    // the large ones need two turns each, while the small ones are handled two per turn.
+    EXPECT_EQ("bbabbbba", interleave({2, 100}, {6, 10}, 2, 60));
+
+    // Without the byte quantum, large messages are handled as many per turn as small ones.
+    EXPECT_EQ("aabbbbbb", interleave({2, 100}, {6, 10}, 2, std::numeric_limits<size_t>::max()));
+}
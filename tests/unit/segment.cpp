@@ -0,0 +1,168 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cocaine/detail/runtime/segment.hpp>
+
+#include "temporary.hpp"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include <cstddef>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace cocaine::logging;
+using namespace cocaine::unit;
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+std::vector<std::string>
+records(const std::string& path, uint32_t* dropped = nullptr) {
+    std::vector<std::string> result;
+
+    const auto count = segment::read(path, [&](const char* data, size_t size) {
+        result.emplace_back(data, size);
+    });
+
+    if(dropped) {
+        *dropped = count;
+    }
+
+    return result;
+}
+
+// Overwrites a part of the file with zeroes.
+void
+zero(const std::string& file, off_t offset, size_t size) {
+    const std::string zeroes(size, '\0');
+    const int fd = ::open(file.c_str(), O_WRONLY);
+
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(static_cast<ssize_t>(size), ::pwrite(fd, zeroes.data(), size, offset));
+
+    ::close(fd);
+}
+
+} // namespace
+
+TEST(segment_writer_t, writes_records_in_order) {
+    temporary_path_t path("cocaine-segment");
+    segment_writer_t writer(path.string(), 4096, 2);
+
+    for(auto record: {"a", "bb", "ccc"}) {
+        ASSERT_TRUE(writer.write(record, std::strlen(record)));
+    }
+
+    uint32_t dropped;
+
+    EXPECT_EQ(std::vector<std::string>({"a", "bb", "ccc"}),
+        records((path.path() / "0000000000000001.seg").string(), &dropped));
+    EXPECT_EQ(0, dropped);
+}
+
+TEST(segment_writer_t, skips_unfilled_reservations_once_sealed) {
+    temporary_path_t path("cocaine-segment");
+    const auto file = (path.path() / "0000000000000001.seg").string();
+
+    {
+        segment_writer_t writer(path.string(), 4096, 2);
+
+        for(auto record: {"a", "bb", "ccc"}) {
+            ASSERT_TRUE(writer.write(record, std::strlen(record)));
+        }
+
+        // Zero the second record out, as if its writer has died right after reserving the space.
+        // It follows the segment header and the first record.
+        zero(file, sizeof(segment::header_t) + 16, sizeof(segment::record_t) + 8);
+
+        // The segment is still live, so the reservation might be being filled in right now.
+        EXPECT_EQ(std::vector<std::string>({"a"}), records(file));
+    }
+
+    EXPECT_EQ(std::vector<std::string>({"a", "ccc"}), records(file));
+}
+
+TEST(segment_writer_t, seals_segments_of_previous_runs) {
+    temporary_path_t path("cocaine-segment");
+    const auto file = (path.path() / "0000000000000001.seg").string();
+
+    {
+        segment_writer_t writer(path.string(), 4096, 2);
+
+        for(auto record: {"a", "bb", "ccc"}) {
+            ASSERT_TRUE(writer.write(record, std::strlen(record)));
+        }
+    }
+
+    // Unseal the segment and zero the second record out, as if the writer has crashed.
+    zero(file, offsetof(segment::header_t, sealed), sizeof(uint32_t));
+    zero(file, sizeof(segment::header_t) + 16, sizeof(segment::record_t) + 8);
+
+    EXPECT_EQ(std::vector<std::string>({"a"}), records(file));
+
+    segment_writer_t writer(path.string(), 4096, 2);
+
+    EXPECT_EQ(std::vector<std::string>({"a", "ccc"}), records(file));
+}
+
+TEST(segment_writer_t, rotates_segments) {
+    temporary_path_t path("cocaine-segment");
+    segment_writer_t writer(path.string(), 64, 2);
+
+    // Every segment fits two of them after the header.
+    for(int i = 0; i < 20; ++i) {
+        ASSERT_TRUE(writer.write("record", 6));
+    }
+
+    EXPECT_EQ(0, writer.dropped());
+
+    EXPECT_FALSE(fs::exists(path.path() / "0000000000000008.seg"));
+    EXPECT_EQ(std::vector<std::string>({"record", "record"}),
+        records((path.path() / "0000000000000009.seg").string()));
+    EXPECT_EQ(std::vector<std::string>({"record", "record"}),
+        records((path.path() / "000000000000000a.seg").string()));
+}
+
+TEST(segment_writer_t, counts_dropped_records) {
+    temporary_path_t path("cocaine-segment");
+    segment_writer_t writer(path.string(), 64, 2);
+
+    const std::string large(64, 'x');
+
+    EXPECT_FALSE(writer.write(large.data(), large.size()));
+    EXPECT_FALSE(writer.write("", 0));
+    EXPECT_TRUE(writer.write("a", 1));
+
+    EXPECT_EQ(2, writer.dropped());
+
+    uint32_t dropped;
+
+    EXPECT_EQ(std::vector<std::string>({"a"}),
+        records((path.path() / "0000000000000001.seg").string(), &dropped));
+    EXPECT_EQ(2, dropped);
+}
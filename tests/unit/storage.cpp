@@ -0,0 +1,182 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cocaine/api/storage.hpp>
+
+#include <cocaine/context.hpp>
+
+#include <cocaine/format.hpp>
+
+#include <cocaine/logging.hpp>
+
+#include "temporary.hpp"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+
+using namespace cocaine;
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+// Context with the files storage as the "core" backend, in a temporary directory.
+
+class environment_t {
+    const unit::temporary_path_t m_path;
+
+    std::unique_ptr<logging::logger_t> m_logger;
+    std::unique_ptr<context_t> m_context;
+
+public:
+    environment_t():
+        m_path("cocaine-storage")
+    {
+        fs::create_directories(m_path.path() / "runtime");
+
+        fs::ofstream stream(m_path.path() / "cocaine.conf");
+
+        stream << cocaine::format(
+            "{\"version\": 3,"
+            " \"paths\": {\"plugins\": \"%s\", \"runtime\": \"%s\"},"
+            " \"network\": {\"pool\": 1},"
+            " \"storages\": {\"core\": {\"type\": \"files\", \"args\": {\"path\": \"%s\"}}}}",
+            (m_path.path() / "plugins").string(), (m_path.path() / "runtime").string(),
+            (m_path.path() / "storage").string()
+        );
+
+        stream.close();
+
+        // NOTE: The default Blackhole configuration, only errors are logged.
+        m_logger = std::make_unique<logging::logger_t>(
+            blackhole::repository_t::instance().create<logging::logger_t>("root", logging::error)
+        );
+
+        m_context = std::make_unique<context_t>(
+            config_t((m_path.path() / "cocaine.conf").string()),
+            std::make_unique<logging::log_t>(*m_logger, blackhole::attribute::set_t())
+        );
+    }
+
+   ~environment_t() {
+        m_context = nullptr;
+    }
+
+    std::shared_ptr<api::storage_t>
+    storage() {
+        return api::storage(*m_context, "core");
+    }
+
+    // Writes the object directly, behind the storage's back.
+    void
+    inject(const std::string& collection, const std::string& key) {
+        fs::ofstream(m_path.path() / "storage" / collection / key) << key;
+    }
+};
+
+typedef std::vector<std::string> keys_t;
+
+} // namespace
+
+TEST(files_t, lists_keys_in_order) {
+    environment_t environment;
+
+    const auto storage = environment.storage();
+
+    for(auto key: {"b2", "a1", "c", "b1", "a2"}) {
+        storage->write("test", key, key, {"tag"});
+    }
+
+    // Tags are stored as subdirectories of the collection, and must not be listed as keys.
+    EXPECT_EQ(keys_t({"a1", "a2", "b1", "b2", "c"}), storage->list("test", "", "", 0));
+    EXPECT_EQ(keys_t({"b1", "b2"}), storage->list("test", "b", "", 0));
+    EXPECT_EQ(keys_t({"b2"}), storage->list("test", "b", "b1", 0));
+    EXPECT_EQ(keys_t(), storage->list("test", "d", "", 0));
+    EXPECT_EQ(keys_t(), storage->list("missing", "", "", 0));
+
+    storage->remove("test", "b1");
+
+    EXPECT_EQ(keys_t({"a1", "a2", "b2", "c"}), storage->list("test", "", "", 0));
+}
+
+TEST(files_t, paginates) {
+    environment_t environment;
+
+    const auto storage = environment.storage();
+
+    keys_t expected;
+
+    for(int i = 0; i < 10; ++i) {
+        expected.push_back(std::to_string(i));
+        storage->write("test", expected.back(), expected.back(), {});
+    }
+
+    keys_t result;
+    std::string last;
+
+    for(keys_t page; !(page = storage->list("test", "", last, 3)).empty(); last = page.back()) {
+        ASSERT_LE(page.size(), 3u);
+        result.insert(result.end(), page.begin(), page.end());
+    }
+
+    EXPECT_EQ(expected, result);
+}
+
+TEST(files_t, picks_up_external_changes) {
+    environment_t environment;
+
+    const auto storage = environment.storage();
+
+    storage->write("test", "a", "a", {});
+
+    ASSERT_EQ(keys_t({"a"}), storage->list("test", "", "", 0));
+
+    // NOTE: Changes made right after the collection has been indexed might share its modification
+    // time, so they must be picked up regardless.
+    environment.inject("test", "b");
+
+    EXPECT_EQ(keys_t({"a", "b"}), storage->list("test", "", "", 0));
+}
+
+TEST(files_t, drops_stale_index_on_write) {
+    environment_t environment;
+
+    const auto storage = environment.storage();
+
+    storage->write("test", "a", "a", {});
+
+    ASSERT_EQ(keys_t({"a"}), storage->list("test", "", "", 0));
+
+    // The write would refresh the index modification time, hiding the injected object, unless the
+    // index is dropped as stale.
+    environment.inject("test", "b");
+    storage->write("test", "c", "c", {});
+
+    EXPECT_EQ(keys_t({"a", "b", "c"}), storage->list("test", "", "", 0));
+
+    environment.inject("test", "d");
+    storage->remove("test", "a");
+
+    EXPECT_EQ(keys_t({"b", "c", "d"}), storage->list("test", "", "", 0));
+}
@@ -0,0 +1,69 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COCAINE_UNIT_TEMPORARY_HPP
+#define COCAINE_UNIT_TEMPORARY_HPP
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include <string>
+
+namespace cocaine { namespace unit {
+
+// Unique path in the system temporary directory, removed along with its contents when the test is
+// done. The directory itself is left for the code under test to create.
+
+class temporary_path_t {
+    const boost::filesystem::path m_path;
+
+public:
+    explicit
+    temporary_path_t(const std::string& prefix):
+        m_path(boost::filesystem::temp_directory_path() /
+               boost::filesystem::unique_path(prefix + "-%%%%-%%%%-%%%%"))
+    { }
+
+   ~temporary_path_t() {
+        boost::system::error_code ec;
+
+        // NOTE: Destructors must not throw, and a leftover directory shouldn't fail the test.
+        boost::filesystem::remove_all(m_path, ec);
+    }
+
+    temporary_path_t(const temporary_path_t&) = delete;
+
+    temporary_path_t&
+    operator=(const temporary_path_t&) = delete;
+
+    const boost::filesystem::path&
+    path() const {
+        return m_path;
+    }
+
+    std::string
+    string() const {
+        return m_path.string();
+    }
+};
+
+}} // namespace cocaine::unit
+
+#endif
@@ -0,0 +1,184 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cocaine/timing_wheel.hpp>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using namespace cocaine::io;
+
+namespace {
+
+typedef boost::posix_time::milliseconds ms;
+
+// Drives the reactor's wheel by hand, so that the tests don't depend on the real time passing.
+struct wheel_t {
+    asio::io_service asio;
+    timing_wheel_t& wheel;
+
+    std::vector<std::unique_ptr<wheel_timer_t>> timers;
+    std::string fired;
+
+    wheel_t():
+        wheel(asio::use_service<timing_wheel_t>(asio))
+    { }
+
+    // Starts a timer, which appends the name to the list of fired timers on expiration. Returns the
+    // earliest and the latest possible deadline, because the wheel's clock is running meanwhile.
+    std::pair<uint64_t, uint64_t>
+    start(char name, uint64_t timeout) {
+        timers.emplace_back(new wheel_timer_t(asio));
+
+        const uint64_t lower = wheel.now() + timeout;
+
+        timers.back()->expires_from_now(ms(timeout));
+        timers.back()->async_wait([this, name](const std::error_code& ec) {
+            fired.push_back(ec ? '!' : name);
+        });
+
+        return std::make_pair(lower, wheel.now() + timeout);
+    }
+
+    // Checks that a timer with the given deadline range fires neither early nor late.
+    void
+    expect(char name, const std::pair<uint64_t, uint64_t>& deadline) {
+        const auto count = fired.size();
+
+        wheel.advance(deadline.first - 1);
+        EXPECT_EQ(count, fired.size()) << "timer '" << name << "' has fired too early";
+
+        wheel.advance(deadline.second);
+        ASSERT_EQ(count + 1, fired.size()) << "timer '" << name << "' has not fired in time";
+        EXPECT_EQ(name, fired.back());
+    }
+};
+
+} // namespace
+
+TEST(timing_wheel, expires_in_deadline_order) {
+    wheel_t wheel;
+
+    wheel.start('c', 30);
+    wheel.start('a', 10);
+    wheel.start('d', 40);
+    const auto deadline = wheel.start('b', 20);
+
+    wheel.wheel.advance(deadline.second + 100);
+
+    EXPECT_EQ("abcd", wheel.fired);
+}
+
+TEST(timing_wheel, cancels_during_expiry) {
+    wheel_t wheel;
+
+    // Two timers expiring at the same tick, one of which is cancelled by the other.
+    for(size_t i = 0; i < 2; ++i) {
+        wheel.timers.emplace_back(new wheel_timer_t(wheel.asio));
+    }
+
+    for(size_t i = 0; i < 2; ++i) {
+        wheel.timers[i]->expires_from_now(ms(10));
+        wheel.timers[i]->async_wait([&wheel, i](const std::error_code& ec) {
+            if(ec) {
+                wheel.fired.push_back('!');
+                return;
+            }
+
+            wheel.fired.push_back('a');
+
+            // Whichever of them fires first cancels the other one.
+            EXPECT_EQ(1, wheel.timers[1 - i]->cancel());
+        });
+    }
+
+    wheel.wheel.advance(wheel.wheel.now() + 100);
+
+    EXPECT_EQ("a", wheel.fired);
+
+    // Cancelled waits are completed via the reactor, like with the regular timers.
+    wheel.asio.run();
+
+    EXPECT_EQ("a!", wheel.fired);
+}
+
+TEST(timing_wheel, restarts_from_handler) {
+    wheel_t wheel;
+
+    wheel.timers.emplace_back(new wheel_timer_t(wheel.asio));
+
+    int count = 0;
+    std::function<void(const std::error_code&)> handler;
+
+    handler = [&](const std::error_code& ec) {
+        ASSERT_FALSE(ec);
+
+        if(++count < 3) {
+            // Restarted right away, but fires only on a later tick.
+            wheel.timers[0]->expires_from_now(ms(0));
+            wheel.timers[0]->async_wait(handler);
+        }
+    };
+
+    const uint64_t now = wheel.wheel.now();
+
+    wheel.timers[0]->expires_from_now(ms(0));
+    wheel.timers[0]->async_wait(handler);
+
+    wheel.wheel.advance(now + 1);
+    EXPECT_LE(count, 2);
+
+    wheel.wheel.advance(wheel.wheel.now() + 10);
+    EXPECT_EQ(3, count);
+}
+
+TEST(timing_wheel, cascades_across_level_boundaries) {
+    wheel_t wheel;
+
+    // Timeouts on both sides of the first and the second level boundaries.
+    const auto a = wheel.start('a', 255);
+    const auto b = wheel.start('b', 257);
+    const auto c = wheel.start('c', 65535);
+    const auto d = wheel.start('d', 65537);
+    const auto e = wheel.start('e', 65536 * 3 + 1000);
+
+    wheel.expect('a', a);
+    wheel.expect('b', b);
+    wheel.expect('c', c);
+    wheel.expect('d', d);
+    wheel.expect('e', e);
+
+    EXPECT_EQ("abcde", wheel.fired);
+}
+
+TEST(timing_wheel, cascades_timeouts_longer_than_span) {
+    wheel_t wheel;
+
+    // The wheel spans 2^32 milliseconds, so these are cascaded down from the last level twice.
+    const auto a = wheel.start('a', (uint64_t(1) << 32) + 1000);
+    const auto b = wheel.start('b', (uint64_t(1) << 33) + 1000);
+
+    wheel.expect('a', a);
+    wheel.expect('b', b);
+
+    EXPECT_EQ("ab", wheel.fired);
+}
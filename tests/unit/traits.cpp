@@ -0,0 +1,308 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cocaine/common.hpp>
+
+#include <cocaine/traits/dynamic.hpp>
+#include <cocaine/traits/enum.hpp>
+#include <cocaine/traits/error_code.hpp>
+#include <cocaine/traits/literal.hpp>
+#include <cocaine/traits/map.hpp>
+#include <cocaine/traits/optional.hpp>
+#include <cocaine/traits/tuple.hpp>
+#include <cocaine/traits/vector.hpp>
+
+#include <gtest/gtest.h>
+
+#include <boost/mpl/list.hpp>
+
+#include <cstdint>
+#include <limits>
+
+using namespace cocaine;
+using namespace cocaine::io;
+
+namespace {
+
+template<class T, class U>
+std::string
+pack(const U& source) {
+    msgpack::sbuffer buffer;
+    msgpack::packer<msgpack::sbuffer> packer(buffer);
+
+    type_traits<T>::pack(packer, source);
+
+    return std::string(buffer.data(), buffer.size());
+}
+
+template<class T>
+T
+unpack(const std::string& source) {
+    msgpack::unpacked unpacked;
+    msgpack::unpack(&unpacked, source.data(), source.size());
+
+    T result;
+    type_traits<T>::unpack(unpacked.get(), result);
+
+    return result;
+}
+
+} // namespace
+
+TEST(raw, round_trip) {
+    const std::vector<uint64_t> integers = { 0, 1, 0xFFFFFFFFFFFFFFFFULL, 0x0102030405060708ULL };
+    const std::vector<double> doubles = { 0.0, -1.5, 3.14159, 1e300 };
+    const std::vector<int16_t> shorts = { -32768, -1, 0, 32767 };
+
+    EXPECT_EQ(integers, unpack<std::vector<uint64_t>>(pack<raw<std::vector<uint64_t>>>(integers)));
+    EXPECT_EQ(doubles, unpack<std::vector<double>>(pack<raw<std::vector<double>>>(doubles)));
+    EXPECT_EQ(shorts, unpack<std::vector<int16_t>>(pack<raw<std::vector<int16_t>>>(shorts)));
+}
+
+TEST(raw, packs_a_single_blob) {
+    const std::vector<uint32_t> source(100, 42);
+    const std::string packed = pack<raw<std::vector<uint32_t>>>(source);
+
+    // Raw header with a 16-bit length, followed by the values themselves.
+    ASSERT_EQ(3 + 400u, packed.size());
+    EXPECT_EQ('\xDA', packed[0]);
+    EXPECT_EQ('\x01', packed[1]);
+    EXPECT_EQ('\x90', packed[2]);
+}
+
+TEST(raw, little_endian) {
+    const std::vector<uint32_t> source = { 0x01020304 };
+    const std::string packed = pack<raw<std::vector<uint32_t>>>(source);
+
+    EXPECT_EQ(std::string("\xA4\x04\x03\x02\x01", 5), packed);
+}
+
+TEST(raw, empty) {
+    const std::string packed = pack<raw<std::vector<double>>>(std::vector<double>());
+
+    EXPECT_EQ(std::string("\xA0", 1), packed);
+    EXPECT_TRUE(unpack<std::vector<double>>(packed).empty());
+}
+
+TEST(raw, arrays_are_still_accepted) {
+    const std::vector<uint64_t> source = { 1, 2, 300, 70000 };
+
+    EXPECT_EQ(source, unpack<std::vector<uint64_t>>(pack<std::vector<uint64_t>>(source)));
+}
+
+TEST(raw, rejects_truncated_values) {
+    // Five bytes can't hold a whole number of 32-bit values.
+    EXPECT_THROW(unpack<std::vector<uint32_t>>(std::string("\xA5\x01\x02\x03\x04\x05", 6)),
+                 msgpack::type_error);
+}
+
+TEST(raw, rejects_non_arithmetic_vectors) {
+    EXPECT_THROW(unpack<std::vector<std::string>>(std::string("\xA4\x01\x02\x03\x04", 5)),
+                 msgpack::type_error);
+}
+
+TEST(raw, argument_tag) {
+    typedef boost::mpl::list<std::string, raw<std::vector<float>>>::type tagged_type;
+    typedef boost::mpl::list<std::string, std::vector<float>>::type plain_type;
+
+    const std::vector<float> source = { 1.0f, -0.5f, 1024.0f };
+
+    msgpack::sbuffer buffer;
+    msgpack::packer<msgpack::sbuffer> packer(buffer);
+
+    type_traits<tagged_type>::pack(packer, std::string("values"), source);
+
+    msgpack::unpacked unpacked;
+    msgpack::unpack(&unpacked, buffer.data(), buffer.size());
+
+    ASSERT_EQ(msgpack::type::RAW, unpacked.get().via.array.ptr[1].type);
+
+    std::string name;
+    std::vector<float> result;
+
+    type_traits<plain_type>::unpack(unpacked.get(), name, result);
+
+    EXPECT_EQ("values", name);
+    EXPECT_EQ(source, result);
+}
+
+// Packed sizes
+
+namespace {
+
+enum plain_enum_t { kSmall = 1, kLarge = 100000 };
+enum class scoped_enum_t: int16_t { negative = -1000, positive = 1000 };
+
+template<class T, class U>
+void
+expect_packed_size(const U& source) {
+    EXPECT_EQ(pack<T>(source).size(), packed_size<T>(source));
+}
+
+template<class T>
+void
+expect_integer_sizes() {
+    const int64_t values[] = {
+        0, 1, 127, 128, 255, 256, 65535, 65536, 4294967295LL, 4294967296LL, -1, -32, -33, -128,
+        -129, -32768, -32769, -2147483648LL, -2147483649LL
+    };
+
+    for(auto it = std::begin(values); it != std::end(values); ++it) {
+        const T value = static_cast<T>(*it);
+
+        if(static_cast<int64_t>(value) != *it) {
+            continue;
+        }
+
+        SCOPED_TRACE(*it);
+        expect_packed_size<T>(value);
+    }
+
+    expect_packed_size<T>(std::numeric_limits<T>::min());
+    expect_packed_size<T>(std::numeric_limits<T>::max());
+}
+
+} // namespace
+
+TEST(packed_size, integers) {
+    expect_integer_sizes<signed char>();
+    expect_integer_sizes<unsigned char>();
+    expect_integer_sizes<int16_t>();
+    expect_integer_sizes<uint16_t>();
+    expect_integer_sizes<int32_t>();
+    expect_integer_sizes<uint32_t>();
+    expect_integer_sizes<int64_t>();
+    expect_integer_sizes<uint64_t>();
+
+    // Values are converted to the declared type first.
+    EXPECT_EQ(pack<uint64_t>(static_cast<uint64_t>(-1)).size(), packed_size<uint64_t>(-1));
+}
+
+TEST(packed_size, other_arithmetic) {
+    expect_packed_size<bool>(true);
+    expect_packed_size<bool>(false);
+    expect_packed_size<float>(1.5f);
+    expect_packed_size<double>(-1e300);
+}
+
+TEST(packed_size, enums) {
+    expect_packed_size<plain_enum_t>(kSmall);
+    expect_packed_size<plain_enum_t>(kLarge);
+    expect_packed_size<scoped_enum_t>(scoped_enum_t::negative);
+    expect_packed_size<scoped_enum_t>(scoped_enum_t::positive);
+}
+
+TEST(packed_size, strings) {
+    expect_packed_size<std::string>(std::string());
+    expect_packed_size<std::string>(std::string(31, 'x'));
+    expect_packed_size<std::string>(std::string(32, 'x'));
+    expect_packed_size<std::string>(std::string(65535, 'x'));
+    expect_packed_size<std::string>(std::string(65536, 'x'));
+    expect_packed_size<char[6]>("hello");
+}
+
+TEST(packed_size, vectors) {
+    std::vector<int64_t> integers;
+
+    for(int64_t i = -70000; i < 70000; i += 999) {
+        integers.push_back(i * i * (i % 2 ? -1 : 1));
+    }
+
+    expect_packed_size<std::vector<int64_t>>(integers);
+    expect_packed_size<std::vector<int64_t>>(std::vector<int64_t>());
+    expect_packed_size<std::vector<double>>(std::vector<double>(20, 0.5));
+    expect_packed_size<std::vector<float>>(std::vector<float>(70000, 0.5f));
+    expect_packed_size<std::vector<bool>>(std::vector<bool>(17, true));
+
+    const std::vector<std::string> strings = { "a", std::string(40, 'b') };
+    const std::vector<plain_enum_t> enums = { kSmall, kLarge };
+    const std::vector<std::vector<int>> nested(3, { 1, 1000 });
+
+    expect_packed_size<std::vector<std::string>>(strings);
+    expect_packed_size<std::vector<plain_enum_t>>(enums);
+    expect_packed_size<std::vector<std::vector<int>>>(nested);
+}
+
+TEST(packed_size, raw_vectors) {
+    expect_packed_size<raw<std::vector<uint32_t>>>(std::vector<uint32_t>());
+    expect_packed_size<raw<std::vector<uint32_t>>>(std::vector<uint32_t>(7, 1));
+    expect_packed_size<raw<std::vector<double>>>(std::vector<double>(10000, 1.0));
+}
+
+TEST(packed_size, maps) {
+    std::map<std::string, uint64_t> map;
+
+    expect_packed_size<std::map<std::string, uint64_t>>(map);
+
+    for(uint64_t i = 0; i < 20; ++i) {
+        map[std::string(i * 3, 'k')] = i << (i * 3);
+    }
+
+    expect_packed_size<std::map<std::string, uint64_t>>(map);
+}
+
+TEST(packed_size, optionals) {
+    expect_packed_size<boost::optional<std::string>>(boost::optional<std::string>());
+    expect_packed_size<boost::optional<std::string>>(boost::optional<std::string>("value"));
+    expect_packed_size<boost::optional<int>>(boost::optional<int>(-1000));
+}
+
+TEST(packed_size, tuples) {
+    typedef std::tuple<std::string, int, std::vector<double>> tuple_type;
+    typedef std::pair<uint16_t, std::string> pair_type;
+
+    expect_packed_size<tuple_type>(tuple_type("name", -5, std::vector<double>(3, 1.0)));
+    expect_packed_size<pair_type>(pair_type(65535, "value"));
+    expect_packed_size<std::tuple<>>(std::tuple<>());
+}
+
+TEST(packed_size, sequences) {
+    typedef boost::mpl::list<std::string, optional<uint64_t>, raw<std::vector<int32_t>>>::type
+            sequence_type;
+
+    const std::vector<int32_t> values(5, -1);
+
+    msgpack::sbuffer buffer;
+    msgpack::packer<msgpack::sbuffer> packer(buffer);
+
+    type_traits<sequence_type>::pack(packer, std::string("key"), 100000, values);
+
+    EXPECT_EQ(buffer.size(), type_traits<sequence_type>::size(std::string("key"), 100000, values));
+}
+
+TEST(packed_size, dynamic) {
+    dynamic_t::object_t object;
+
+    object["null"] = dynamic_t();
+    object["bool"] = true;
+    object["int"] = -100000;
+    object["uint"] = 4294967296ULL;
+    object["double"] = 0.25;
+    object["string"] = std::string(100, 's');
+    object["array"] = dynamic_t::array_t(20, dynamic_t(-1));
+
+    expect_packed_size<dynamic_t>(dynamic_t(object));
+    expect_packed_size<dynamic_t>(dynamic_t(dynamic_t::array_t()));
+}
+
+TEST(packed_size, error_codes) {
+    expect_packed_size<std::error_code>(std::error_code());
+    expect_packed_size<std::error_code>(std::make_error_code(std::errc::not_enough_memory));
+}
@@ -0,0 +1,179 @@
+/*
+    Copyright (c) 2011-2014 Andrey Sibiryov <me@kobology.ru>
+    Copyright (c) 2011-2014 Other contributors as noted in the AUTHORS file.
+
+    This file is part of Cocaine.
+
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cocaine/errors.hpp>
+
+#include <cocaine/idl/streaming.hpp>
+
+#include <cocaine/rpc/asio/transport.hpp>
+
+#include <cocaine/traits/literal.hpp>
+
+#include <gtest/gtest.h>
+
+#include <asio/local/connect_pair.hpp>
+#include <asio/local/stream_protocol.hpp>
+#include <asio/write.hpp>
+
+#include <unistd.h>
+
+using namespace cocaine;
+using namespace cocaine::io;
+
+namespace {
+
+typedef streaming<boost::mpl::list<std::string>::type> protocol_type;
+typedef transport<asio::local::stream_protocol> transport_type;
+
+std::string
+encode(const std::string& value) {
+    encoder_t encoder;
+    std::vector<asio::const_buffer> buffers;
+    std::string result;
+
+    const auto message = encoder.encode(encoded<protocol_type::chunk>(1, value));
+
+    message.buffers(std::back_inserter(buffers));
+
+    for(auto it = buffers.begin(); it != buffers.end(); ++it) {
+        result.append(asio::buffer_cast<const char*>(*it), asio::buffer_size(*it));
+    }
+
+    return result;
+}
+
+// Reads a single message on the transport's reactor and returns its argument.
+std::string
+read(const std::shared_ptr<transport_type>& ptr) {
+    decoder_t::message_type message;
+    std::error_code result = error::insufficient_bytes;
+
+    ptr->reader->read(message, [&](const std::error_code& ec) {
+        result = ec;
+    });
+
+    ptr->socket->get_io_service().run();
+    ptr->socket->get_io_service().reset();
+
+    EXPECT_EQ(std::error_code(), result);
+
+    return result ? std::string() : message.args().via.array.ptr[0].as<std::string>();
+}
+
+void
+write(const std::shared_ptr<transport_type>& ptr, const std::string& value) {
+    std::error_code result = error::insufficient_bytes;
+
+    ptr->writer->write(encoded<protocol_type::chunk>(1, value), [&](const std::error_code& ec) {
+        result = ec;
+    });
+
+    ptr->socket->get_io_service().run();
+    ptr->socket->get_io_service().reset();
+
+    EXPECT_EQ(std::error_code(), result);
+}
+
+// Moves the transport to another reactor the same way sessions are migrated.
+std::shared_ptr<transport_type>
+migrate(const std::shared_ptr<transport_type>& ptr, asio::io_service& target) {
+    const int fd = ::dup(ptr->socket->native_handle());
+
+    auto next = std::make_shared<transport_type>(
+        std::make_unique<transport_type::socket_type>(target, asio::local::stream_protocol(), fd),
+        *ptr
+    );
+
+    std::error_code ec;
+
+    // The old socket shares the connection with the new one, so it's closed, not shut down.
+    ptr->socket->close(ec);
+
+    return next;
+}
+
+struct connection_t {
+    asio::io_service source;
+    asio::io_service target;
+    asio::io_service remote;
+
+    std::shared_ptr<transport_type> local;
+    std::shared_ptr<transport_type> peer;
+
+    connection_t() {
+        auto socket = std::make_unique<transport_type::socket_type>(source);
+        auto other  = std::make_unique<transport_type::socket_type>(remote);
+
+        asio::local::connect_pair(*socket, *other);
+
+        local = std::make_shared<transport_type>(std::move(socket));
+        peer  = std::make_shared<transport_type>(std::move(other));
+    }
+};
+
+} // namespace
+
+TEST(transport, keeps_message_order_across_reactors) {
+    connection_t connection;
+
+    const auto data = encode("1") + encode("2");
+
+    asio::write(*connection.peer->socket, asio::buffer(data));
+
+    // The second message is buffered by the first read, and must survive the move.
+    EXPECT_EQ("1", read(connection.local));
+
+    write(connection.local, "a");
+
+    const auto moved = migrate(connection.local, connection.target);
+
+    asio::write(*connection.peer->socket, asio::buffer(encode("3")));
+
+    EXPECT_EQ("2", read(moved));
+    EXPECT_EQ("3", read(moved));
+
+    write(moved, "b");
+
+    EXPECT_EQ("a", read(connection.peer));
+    EXPECT_EQ("b", read(connection.peer));
+}
+
+TEST(transport, resumes_cancelled_reads_across_reactors) {
+    connection_t connection;
+
+    decoder_t::message_type message;
+    std::error_code result;
+
+    connection.local->reader->read(message, [&](const std::error_code& ec) {
+        result = ec;
+    });
+
+    // Unlike reads aborted by closing the socket, cancelled ones are completed.
+    connection.local->reader->cancel();
+    connection.source.run();
+
+    EXPECT_EQ(asio::error::operation_aborted, result);
+
+    const auto moved = migrate(connection.local, connection.target);
+
+    asio::write(*connection.peer->socket, asio::buffer(encode("1")));
+
+    EXPECT_EQ("1", read(moved));
+}